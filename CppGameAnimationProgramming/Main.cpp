@@ -1,14 +1,117 @@
+#include <cstdlib>
 #include <memory>
+#include <string>
 #include "Window.h"
 #include "Logger.h"
+#include "Profiler.h"
+#include "JobSystem.h"
 
 int main(int argc, char* argv[]) {
+	Logger::init();
+	// --trace <file>: record profiler zones and write them as Chrome trace JSON on exit
+	// --headless: render offscreen without GLFW, --frames <n>: stop after n frames
+	// --screenshot <file.png>: write the last frame as PNG (headless only)
+	// --present-mode <vsync|low-latency|lowest-latency>, --fps-limit <n>: frame pacing, 0 paces FIFO to the display
+	// --alpha-test: draw with the alpha tested shader variant
+	// --instances <n>: draw the model n times, culled on the GPU
+	// --environment <n>: background grid of n x n quads, culled per meshlet on the GPU
+	// --float-vertices: full precision vertex buffers instead of the quantized layout
+	// --cpu-draws: cull the instances on the CPU and record one draw each, in parallel
+	// --texture-budget <MiB>: memory for streamed texture mips, finer mips are evicted above it
+	std::string traceFileName;
+	std::string screenshotFileName;
+	bool headless = false;
+	unsigned int frameCount = 0;
+	VkPresentPolicy presentPolicy = VkPresentPolicy::LowLatency;
+	float frameRateLimit = 0.0f;
+	uint32_t shaderFeatures = 0;
+	unsigned int instanceCount = 0;
+	unsigned int environmentSize = 0;
+	VkVertexFormat vertexFormat = VkVertexFormat::Quantized;
+	bool cpuDrawList = false;
+	unsigned int textureBudget = 0;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--trace" && i + 1 < argc) {
+			traceFileName = argv[++i];
+		}
+		else if (arg == "--headless") {
+			headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc) {
+			frameCount = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--screenshot" && i + 1 < argc) {
+			screenshotFileName = argv[++i];
+		}
+		else if (arg == "--present-mode" && i + 1 < argc) {
+			std::string mode = argv[++i];
+			if (mode == "vsync") {
+				presentPolicy = VkPresentPolicy::VSync;
+			}
+			else if (mode == "low-latency") {
+				presentPolicy = VkPresentPolicy::LowLatency;
+			}
+			else if (mode == "lowest-latency") {
+				presentPolicy = VkPresentPolicy::LowestLatency;
+			}
+			else {
+				LOG(General, 1, "%s: unknown present mode '%s', using low-latency\n", __FUNCTION__, mode.c_str());
+			}
+		}
+		else if (arg == "--fps-limit" && i + 1 < argc) {
+			frameRateLimit = std::strtof(argv[++i], nullptr);
+		}
+		else if (arg == "--alpha-test") {
+			shaderFeatures |= VkShaderFeatures::ALPHA_TEST;
+		}
+		else if (arg == "--instances" && i + 1 < argc) {
+			instanceCount = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--environment" && i + 1 < argc) {
+			environmentSize = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--float-vertices") {
+			vertexFormat = VkVertexFormat::Float;
+		}
+		else if (arg == "--cpu-draws") {
+			cpuDrawList = true;
+		}
+		else if (arg == "--texture-budget" && i + 1 < argc) {
+			textureBudget = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+	}
+	if (!traceFileName.empty()) {
+		Profiler::setEnabled(true);
+		Profiler::setThreadName("main");
+	}
+	JobSystem::init();
+
 	std::unique_ptr<Window> w = std::make_unique<Window>();
-	if (!w->init(640, 480, "Test Window")) {
-		Logger::log(1, "%s error: Window init error\n", __FUNCTION__);
+	w->setPresentPolicy(presentPolicy, frameRateLimit);
+	w->setShaderFeatures(shaderFeatures);
+	w->setVertexFormat(vertexFormat);
+	w->setCpuDrawList(cpuDrawList);
+	if (textureBudget > 0) {
+		w->setTextureBudget(static_cast<VkDeviceSize>(textureBudget) * 1024 * 1024);
+	}
+	w->setInstanceCount(instanceCount);
+	w->setEnvironmentSize(environmentSize);
+	if (!w->init(640, 480, "Test Window", headless)) {
+		LOG(General, 1, "%s error: Window init error\n", __FUNCTION__);
+		JobSystem::cleanup();
 		return -1;
 	}
-	w->mainLoop();
+	w->mainLoop(frameCount);
+	int exitCode = 0;
+	if (!screenshotFileName.empty() && !w->saveScreenshot(screenshotFileName)) {
+		exitCode = -1;
+	}
 	w->cleanup();
-	return 0;
+	JobSystem::cleanup();
+	if (!traceFileName.empty()) {
+		Profiler::writeChromeTrace(traceFileName);
+	}
+	Logger::cleanup();
+	return exitCode;
 }
\ No newline at end of file
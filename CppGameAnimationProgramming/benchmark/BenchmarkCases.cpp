@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb_image.h>
+#include "BenchmarkCases.h"
+#include "Model.h"
+#include "Shader.h"
+#include "ShaderCompiler.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Bvh.h"
+#include "VertexFormat.h"
+
+namespace {
+	VkMesh createGridMesh(size_t quadsPerSide) {
+		VkMesh mesh;
+		mesh.vertices.reserve(quadsPerSide * quadsPerSide * 6);
+		float step = 1.0f / quadsPerSide;
+		for (size_t y = 0; y < quadsPerSide; ++y) {
+			for (size_t x = 0; x < quadsPerSide; ++x) {
+				glm::vec2 corner(x * step, y * step);
+				glm::vec2 offsets[] = { { 0, 0 }, { 1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } };
+				for (const glm::vec2& offset : offsets) {
+					glm::vec2 uv = corner + offset * step;
+					mesh.vertices.push_back({ glm::vec3(uv * 2.0f - 1.0f, 0.5f), uv });
+				}
+			}
+		}
+		return mesh;
+	}
+
+	// Shared corner vertices, the layout an exported environment mesh has
+	VkMesh createIndexedGridMesh(uint32_t quadsPerSide) {
+		VkMesh mesh;
+		uint32_t side = quadsPerSide + 1;
+		mesh.vertices.resize(side * side);
+		for (uint32_t i = 0; i < side * side; ++i) {
+			glm::vec2 uv = glm::vec2(i % side, i / side) / static_cast<float>(quadsPerSide);
+			mesh.vertices.at(i) = { glm::vec3(uv * 2.0f - 1.0f, 0.5f), uv };
+		}
+		mesh.indices.reserve(quadsPerSide * quadsPerSide * 6);
+		for (uint32_t y = 0; y < quadsPerSide; ++y) {
+			for (uint32_t x = 0; x < quadsPerSide; ++x) {
+				uint32_t corner = y * side + x;
+				mesh.indices.insert(mesh.indices.end(), { corner, corner + side + 1, corner + side, corner, corner + 1, corner + side + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	// Character sized boxes scattered over a 1 km square
+	std::vector<Aabb> createInstanceBounds(size_t count) {
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::vector<Aabb> bounds(count);
+		for (Aabb& box : bounds) {
+			glm::vec3 center(position(random), 0.0f, position(random));
+			box.min = center - glm::vec3(0.5f, 0.0f, 0.5f);
+			box.max = center + glm::vec3(0.5f, 2.0f, 0.5f);
+		}
+		return bounds;
+	}
+
+	Frustum createSceneFrustum() {
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(100.0f, 0.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		return Frustum::fromViewProjection(projection * view);
+	}
+}
+
+void addRendererBenchmarks(BenchmarkRunner& runner, VkRenderer* renderer) {
+	std::shared_ptr<Model> model = std::make_shared<Model>();
+	model->init();
+	runner.addCase("mesh_upload/model_quad", [renderer, model]() {
+		return renderer && renderer->uploadData(model->getVertexData());
+	});
+
+	// 64 x 64 quads, 24576 vertices
+	std::shared_ptr<VkMesh> grid = std::make_shared<VkMesh>(createGridMesh(64));
+	runner.addCase("mesh_upload/grid_24576", [renderer, grid]() {
+		return renderer && renderer->uploadData(*grid);
+	});
+
+	// 100 x 100 model quads drawn one by one, the main pass is recorded on every job system thread
+	std::shared_ptr<bool> sceneReady = std::make_shared<bool>(false);
+	runner.addCase("frame_cpu_draws/10k", [renderer, model, sceneReady]() {
+		if (!renderer) {
+			return false;
+		}
+		if (!*sceneReady) {
+			std::vector<VkInstanceData> instances(10000);
+			for (size_t i = 0; i < instances.size(); ++i) {
+				glm::vec2 position = glm::vec2(i % 100 + 0.5f, i / 100 + 0.5f) * 0.02f - 1.0f;
+				instances.at(i).positionScale = glm::vec4(position, 0.0f, 0.018f);
+			}
+			renderer->uploadData(model->getVertexData());
+			renderer->setInstances(instances);
+			renderer->setCpuDrawList(true);
+			*sceneReady = true;
+		}
+		return renderer->draw();
+	});
+}
+
+void addAssetBenchmarks(BenchmarkRunner& runner) {
+	runner.addCase("texture_decode/crate.png", []() {
+		int width;
+		int height;
+		int channels;
+		unsigned char* pixels = stbi_load("textures/crate.png", &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels) {
+			return false;
+		}
+		stbi_image_free(pixels);
+		return true;
+	});
+
+	// Cache hit path: hashing source and includes plus reading the stored SPIR-V
+	runner.addCase("shader_load/basic.vert", []() {
+		std::vector<uint32_t> spirv;
+		return ShaderCompiler::loadSpirv("shader/basic.vert", {}, spirv);
+	});
+	runner.addCase("shader_load/basic.frag", []() {
+		std::vector<uint32_t> spirv;
+		return ShaderCompiler::loadSpirv("shader/basic.frag", {}, spirv);
+	});
+	// 256 x 256 quads, 131072 triangles
+	std::shared_ptr<VkMesh> environment = std::make_shared<VkMesh>(createIndexedGridMesh(256));
+	runner.addCase("meshlet_build/grid_131072", [environment]() {
+		VkMeshletMesh meshletMesh;
+		return MeshletBuilder::build(*environment, meshletMesh);
+	});
+	runner.addCase("vertex_encode/quantized_66049", [environment]() {
+		std::vector<uint8_t> data;
+		glm::vec4 positionDequantization;
+		VertexFormat::encode(VkVertexFormat::Quantized, environment->vertices, data, positionDequantization);
+		return data.size() == environment->vertices.size() * sizeof(VkQuantizedVertex);
+	});
+	// 128 x 128 quads on a wavy surface, flat areas would collapse for free
+	std::shared_ptr<VkMesh> terrain = std::make_shared<VkMesh>(createIndexedGridMesh(128));
+	for (VkVertex& vertex : terrain->vertices) {
+		vertex.position.z = 0.05f * std::sin(vertex.uv.x * 12.0f) * std::cos(vertex.uv.y * 9.0f);
+	}
+	runner.addCase("mesh_lods/grid_32768", [terrain]() {
+		VkMesh mesh = *terrain;
+		return MeshSimplifier::generateLods(mesh);
+	});
+	// Triangles in random order like an unprocessed export, the optimizer has to rebuild the whole order
+	std::shared_ptr<VkMesh> scrambled = std::make_shared<VkMesh>(*terrain);
+	std::vector<uint32_t> triangleOrder(scrambled->indices.size() / 3);
+	for (size_t i = 0; i < triangleOrder.size(); ++i) {
+		triangleOrder.at(i) = static_cast<uint32_t>(i);
+	}
+	std::shuffle(triangleOrder.begin(), triangleOrder.end(), std::mt19937(7));
+	for (size_t i = 0; i < triangleOrder.size(); ++i) {
+		for (size_t corner = 0; corner < 3; ++corner) {
+			scrambled->indices.at(i * 3 + corner) = terrain->indices.at(triangleOrder.at(i) * 3 + corner);
+		}
+	}
+	runner.addCase("mesh_optimize/grid_32768", [scrambled]() {
+		VkMesh mesh = *scrambled;
+		return MeshOptimizer::optimize(mesh);
+	});
+	runner.addCase("shader_compile/basic.vert", []() {
+		std::vector<uint32_t> spirv;
+		return ShaderCompiler::compile("shader/basic.vert", {}, spirv);
+	});
+	runner.addCase("shader_compile/basic.frag", []() {
+		std::vector<uint32_t> spirv;
+		return ShaderCompiler::compile("shader/basic.frag", {}, spirv);
+	});
+}
+
+void addSceneBenchmarks(BenchmarkRunner& runner) {
+	std::shared_ptr<std::vector<Aabb>> bounds = std::make_shared<std::vector<Aabb>>(createInstanceBounds(100000));
+	runner.addCase("bvh_build/100k", [bounds]() {
+		Bvh bvh;
+		bvh.build(*bounds);
+		return true;
+	});
+
+	std::shared_ptr<Bvh> bvh = std::make_shared<Bvh>();
+	bvh->build(*bounds);
+	Frustum frustum = createSceneFrustum();
+	std::shared_ptr<std::vector<uint32_t>> visible = std::make_shared<std::vector<uint32_t>>();
+	runner.addCase("bvh_cull/100k", [bvh, frustum, visible]() {
+		visible->clear();
+		bvh->cull(frustum, *visible);
+		return true;
+	});
+	runner.addCase("bvh_cull_parallel/100k", [bvh, frustum, visible]() {
+		visible->clear();
+		bvh->cullParallel(frustum, *visible);
+		return true;
+	});
+
+	// Every 100th instance walks a step, the tree is refitted like once per frame
+	runner.addCase("bvh_refit/100k_1k_moving", [bvh, bounds]() {
+		for (size_t i = 0; i < bounds->size(); i += 100) {
+			Aabb& box = bounds->at(i);
+			box.min.x += 0.01f;
+			box.max.x += 0.01f;
+			bvh->updateBounds(static_cast<uint32_t>(i), box);
+		}
+		bvh->refit();
+		return true;
+	});
+}
\ No newline at end of file
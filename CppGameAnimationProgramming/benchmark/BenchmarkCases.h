@@ -0,0 +1,8 @@
+#pragma once
+#include "BenchmarkRunner.h"
+#include "VkRenderer.h"
+
+/* renderer may be nullptr when no Vulkan device is available, its cases are skipped then */
+void addRendererBenchmarks(BenchmarkRunner& runner, VkRenderer* renderer);
+void addAssetBenchmarks(BenchmarkRunner& runner);
+void addSceneBenchmarks(BenchmarkRunner& runner);
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "BenchmarkRunner.h"
+#include "BenchmarkCases.h"
+#include "Logger.h"
+#include "JobSystem.h"
+
+/*
+ * Benchmark [--filter <text>] [--samples <n>] [--out <results.json>] [--baseline <baseline.json>] [--threshold <fraction>]
+ * Benchmark --compare <results.json> <baseline.json> [--threshold <fraction>]
+ * Exit code 1 when a case regressed against the baseline, 2 on errors.
+ */
+int main(int argc, char* argv[]) {
+	Logger::init();
+	BenchmarkSettings settings;
+	std::string outFileName = "benchmark_results.json";
+	std::string baselineFileName;
+	std::string compareFileName;
+	double threshold = 0.05;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc) {
+			settings.filter = argv[++i];
+		}
+		else if (arg == "--samples" && i + 1 < argc) {
+			settings.minSamples = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--out" && i + 1 < argc) {
+			outFileName = argv[++i];
+		}
+		else if (arg == "--baseline" && i + 1 < argc) {
+			baselineFileName = argv[++i];
+		}
+		else if (arg == "--threshold" && i + 1 < argc) {
+			threshold = std::strtod(argv[++i], nullptr);
+		}
+		else if (arg == "--compare" && i + 2 < argc) {
+			compareFileName = argv[++i];
+			baselineFileName = argv[++i];
+		}
+		else {
+			LOG(General, 1, "%s error: unknown argument '%s'\n", __FUNCTION__, arg.c_str());
+			Logger::cleanup();
+			return 2;
+		}
+	}
+
+	std::vector<BenchmarkResult> results;
+	if (!compareFileName.empty()) {
+		if (!BenchmarkRunner::readJson(compareFileName, results)) {
+			Logger::cleanup();
+			return 2;
+		}
+	}
+	else {
+		JobSystem::init();
+		// Declaration check of the renderer init steps, needs no device
+		if (!VkRenderer::checkInitGraph()) {
+			LOG(General, 1, "%s error: renderer init graph is invalid\n", __FUNCTION__);
+			JobSystem::cleanup();
+			Logger::cleanup();
+			return 2;
+		}
+		// Mesh upload needs a device, the headless renderer also runs without a GPU on lavapipe
+		std::unique_ptr<VkRenderer> renderer = std::make_unique<VkRenderer>(nullptr);
+		bool rendererReady = renderer->init(640, 480);
+		if (!rendererReady) {
+			LOG(General, 1, "%s: no Vulkan device, renderer cases are skipped\n", __FUNCTION__);
+		}
+
+		BenchmarkRunner runner;
+		addRendererBenchmarks(runner, rendererReady ? renderer.get() : nullptr);
+		addAssetBenchmarks(runner);
+		addSceneBenchmarks(runner);
+		results = runner.run(settings);
+		if (rendererReady) {
+			renderer->cleanup();
+		}
+		JobSystem::cleanup();
+		if (!BenchmarkRunner::writeJson(outFileName, results)) {
+			Logger::cleanup();
+			return 2;
+		}
+	}
+
+	int exitCode = 0;
+	if (!baselineFileName.empty()) {
+		std::vector<BenchmarkResult> baseline;
+		if (!BenchmarkRunner::readJson(baselineFileName, baseline)) {
+			exitCode = 2;
+		}
+		else if (BenchmarkRunner::compare(results, baseline, threshold) > 0) {
+			exitCode = 1;
+		}
+	}
+	Logger::cleanup();
+	return exitCode;
+}
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include "BenchmarkRunner.h"
+#include "Logger.h"
+
+namespace {
+	double percentile(const std::vector<double>& sorted, double fraction) {
+		// Linear interpolation between the closest ranks
+		double position = fraction * (sorted.size() - 1);
+		size_t lower = static_cast<size_t>(position);
+		size_t upper = std::min(lower + 1, sorted.size() - 1);
+		return sorted.at(lower) + (sorted.at(upper) - sorted.at(lower)) * (position - lower);
+	}
+
+	/* just enough JSON for the files written by writeJson: objects, arrays, strings and numbers */
+	class JsonReader {
+	public:
+		explicit JsonReader(const std::string& text) : mText(text) {}
+
+		bool readResults(std::vector<BenchmarkResult>& results) {
+			return readObject([&](const std::string& key) {
+				if (key != "benchmarks") {
+					return skipValue();
+				}
+				return readArray([&]() {
+					BenchmarkResult result;
+					bool ok = readObject([&](const std::string& field) {
+						if (field == "name") {
+							return readString(result.name);
+						}
+						std::map<std::string, double*> numbers = {
+							{ "min_ns", &result.minimum }, { "mean_ns", &result.mean }, { "median_ns", &result.median },
+							{ "p90_ns", &result.p90 }, { "p99_ns", &result.p99 }, { "max_ns", &result.maximum }, { "stddev_ns", &result.stddev } };
+						double value = 0.0;
+						if (numbers.count(field)) {
+							return readNumber(*numbers.at(field));
+						}
+						if (field == "samples" || field == "iterations_per_sample") {
+							if (!readNumber(value)) {
+								return false;
+							}
+							(field == "samples" ? result.samples : result.iterationsPerSample) = static_cast<size_t>(value);
+							return true;
+						}
+						return skipValue();
+					});
+					results.push_back(result);
+					return ok;
+				});
+			});
+		}
+
+	private:
+		const std::string& mText;
+		size_t mPos = 0;
+
+		bool consume(char expected) {
+			while (mPos < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPos]))) {
+				++mPos;
+			}
+			if (mPos < mText.size() && mText[mPos] == expected) {
+				++mPos;
+				return true;
+			}
+			return false;
+		}
+
+		char peek() {
+			while (mPos < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPos]))) {
+				++mPos;
+			}
+			return mPos < mText.size() ? mText[mPos] : '\0';
+		}
+
+		bool readObject(const std::function<bool(const std::string&)>& onField) {
+			if (!consume('{')) {
+				return false;
+			}
+			if (consume('}')) {
+				return true;
+			}
+			do {
+				std::string key;
+				if (!readString(key) || !consume(':') || !onField(key)) {
+					return false;
+				}
+			} while (consume(','));
+			return consume('}');
+		}
+
+		bool readArray(const std::function<bool()>& onElement) {
+			if (!consume('[')) {
+				return false;
+			}
+			if (consume(']')) {
+				return true;
+			}
+			do {
+				if (!onElement()) {
+					return false;
+				}
+			} while (consume(','));
+			return consume(']');
+		}
+
+		bool readString(std::string& value) {
+			if (!consume('"')) {
+				return false;
+			}
+			value.clear();
+			while (mPos < mText.size() && mText[mPos] != '"') {
+				if (mText[mPos] == '\\' && mPos + 1 < mText.size()) {
+					++mPos;
+				}
+				value += mText[mPos++];
+			}
+			return consume('"');
+		}
+
+		bool readNumber(double& value) {
+			peek();
+			const char* start = mText.c_str() + mPos;
+			char* end = nullptr;
+			value = std::strtod(start, &end);
+			if (end == start) {
+				return false;
+			}
+			mPos += static_cast<size_t>(end - start);
+			return true;
+		}
+
+		bool skipValue() {
+			char next = peek();
+			if (next == '{') {
+				return readObject([&](const std::string&) { return skipValue(); });
+			}
+			if (next == '[') {
+				return readArray([&]() { return skipValue(); });
+			}
+			if (next == '"') {
+				std::string ignored;
+				return readString(ignored);
+			}
+			for (const char* literal : { "true", "false", "null" }) {
+				if (mText.compare(mPos, std::strlen(literal), literal) == 0) {
+					mPos += std::strlen(literal);
+					return true;
+				}
+			}
+			double ignored;
+			return readNumber(ignored);
+		}
+	};
+}
+
+void BenchmarkRunner::addCase(std::string name, std::function<bool()> function) {
+	mCases.emplace_back(name, function);
+}
+
+bool BenchmarkRunner::runSample(const std::function<bool()>& function, size_t iterations, double& nanoseconds) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i) {
+		if (!function()) {
+			return false;
+		}
+	}
+	nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	return true;
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::run(const BenchmarkSettings& settings) {
+	std::vector<BenchmarkResult> results;
+	for (const auto& benchmarkCase : mCases) {
+		const std::string& name = benchmarkCase.first;
+		if (name.find(settings.filter) == std::string::npos) {
+			continue;
+		}
+
+		// Double the batch until a sample is long enough for the clock resolution
+		size_t iterations = 1;
+		double sampleTime = 0.0;
+		bool ok = runSample(benchmarkCase.second, iterations, sampleTime);
+		while (ok && sampleTime < settings.minSampleTimeMs * 1.0e6 && iterations < (1u << 24)) {
+			iterations *= 2;
+			ok = runSample(benchmarkCase.second, iterations, sampleTime);
+		}
+		for (size_t i = 0; ok && i < settings.warmupSamples; ++i) {
+			ok = runSample(benchmarkCase.second, iterations, sampleTime);
+		}
+		if (!ok) {
+			LOG(General, 1, "%s: case '%s' skipped\n", __FUNCTION__, name.c_str());
+			continue;
+		}
+
+		std::vector<double> sampleTimes;
+		double totalTime = 0.0;
+		while (ok && sampleTimes.size() < settings.maxSamples &&
+			(sampleTimes.size() < settings.minSamples || totalTime < settings.targetCaseTimeMs * 1.0e6)) {
+			ok = runSample(benchmarkCase.second, iterations, sampleTime);
+			sampleTimes.push_back(sampleTime / iterations);
+			totalTime += sampleTime;
+		}
+		if (!ok) {
+			LOG(General, 1, "%s: case '%s' failed while sampling\n", __FUNCTION__, name.c_str());
+			continue;
+		}
+
+		BenchmarkResult result = summarize(name, sampleTimes, iterations);
+		LOG(General, 1, "%-40s median %12.1f ns  p90 %12.1f ns  p99 %12.1f ns  (%zu x %zu)\n", name.c_str(),
+			result.median, result.p90, result.p99, result.samples, result.iterationsPerSample);
+		results.push_back(result);
+	}
+	return results;
+}
+
+BenchmarkResult BenchmarkRunner::summarize(std::string name, std::vector<double>& sampleTimes, size_t iterationsPerSample) {
+	std::sort(sampleTimes.begin(), sampleTimes.end());
+	BenchmarkResult result;
+	result.name = name;
+	result.samples = sampleTimes.size();
+	result.iterationsPerSample = iterationsPerSample;
+	result.minimum = sampleTimes.front();
+	result.maximum = sampleTimes.back();
+	result.median = percentile(sampleTimes, 0.5);
+	result.p90 = percentile(sampleTimes, 0.9);
+	result.p99 = percentile(sampleTimes, 0.99);
+	double sum = 0.0;
+	for (double time : sampleTimes) {
+		sum += time;
+	}
+	result.mean = sum / sampleTimes.size();
+	double squares = 0.0;
+	for (double time : sampleTimes) {
+		squares += (time - result.mean) * (time - result.mean);
+	}
+	result.stddev = std::sqrt(squares / sampleTimes.size());
+	return result;
+}
+
+bool BenchmarkRunner::writeJson(std::string fileName, const std::vector<BenchmarkResult>& results) {
+	std::ofstream outFile(fileName);
+	if (!outFile.is_open()) {
+		LOG(Io, 1, "%s error: could not open '%s'\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+#ifdef NDEBUG
+	const char* buildType = "release";
+#else
+	const char* buildType = "debug";
+#endif
+	outFile << "{\n  \"build\": \"" << buildType << "\",\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult& result = results.at(i);
+		char line[512];
+		std::snprintf(line, sizeof(line), "%s\n    {\"name\": \"%s\", \"samples\": %zu, \"iterations_per_sample\": %zu, "
+			"\"min_ns\": %.1f, \"mean_ns\": %.1f, \"median_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f, \"stddev_ns\": %.1f}",
+			i == 0 ? "" : ",", result.name.c_str(), result.samples, result.iterationsPerSample, result.minimum, result.mean,
+			result.median, result.p90, result.p99, result.maximum, result.stddev);
+		outFile << line;
+	}
+	outFile << "\n  ]\n}\n";
+	outFile.close();
+	LOG(General, 1, "%s: wrote %zu results to '%s'\n", __FUNCTION__, results.size(), fileName.c_str());
+	return true;
+}
+
+bool BenchmarkRunner::readJson(std::string fileName, std::vector<BenchmarkResult>& results) {
+	std::ifstream inFile(fileName);
+	if (!inFile.is_open()) {
+		LOG(Io, 1, "%s error: could not open '%s'\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+	std::string text((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+	JsonReader reader(text);
+	if (!reader.readResults(results)) {
+		LOG(Io, 1, "%s error: '%s' is not a benchmark result file\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+size_t BenchmarkRunner::compare(const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkResult>& baseline, double threshold) {
+	size_t regressions = 0;
+	LOG(General, 1, "%-40s %14s %14s %9s  %s\n", "case", "baseline ns", "current ns", "change", "status");
+	for (const auto& result : results) {
+		auto base = std::find_if(baseline.begin(), baseline.end(), [&](const BenchmarkResult& entry) { return entry.name == result.name; });
+		if (base == baseline.end()) {
+			LOG(General, 1, "%-40s %14s %14.1f %9s  new\n", result.name.c_str(), "-", result.median, "-");
+			continue;
+		}
+		double change = base->median > 0.0 ? result.median / base->median - 1.0 : 0.0;
+		// Noise guard: even the fastest sample has to be slower than the baseline median
+		const char* status = "ok";
+		if (change > threshold && result.minimum > base->median) {
+			status = "REGRESSION";
+			++regressions;
+		}
+		else if (change < -threshold && result.p90 < base->median) {
+			status = "improved";
+		}
+		LOG(General, 1, "%-40s %14.1f %14.1f %+8.1f%%  %s\n", result.name.c_str(), base->median, result.median, change * 100.0, status);
+	}
+	for (const auto& base : baseline) {
+		if (std::none_of(results.begin(), results.end(), [&](const BenchmarkResult& entry) { return entry.name == base.name; })) {
+			LOG(General, 1, "%-40s %14.1f %14s %9s  missing\n", base.name.c_str(), base.median, "-", "-");
+		}
+	}
+	LOG(General, 1, "%s: %zu of %zu cases regressed by more than %.1f%%\n", __FUNCTION__, regressions, results.size(), threshold * 100.0);
+	return regressions;
+}
\ No newline at end of file
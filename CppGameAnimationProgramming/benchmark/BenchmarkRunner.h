@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* statistics of one case, all times are nanoseconds per iteration */
+struct BenchmarkResult {
+	std::string name;
+	size_t samples = 0;
+	size_t iterationsPerSample = 0;
+	double minimum = 0.0;
+	double mean = 0.0;
+	double median = 0.0;
+	double p90 = 0.0;
+	double p99 = 0.0;
+	double maximum = 0.0;
+	double stddev = 0.0;
+};
+
+struct BenchmarkSettings {
+	/* only cases whose name contains the filter run */
+	std::string filter;
+	size_t minSamples = 30;
+	size_t maxSamples = 1000;
+	size_t warmupSamples = 3;
+	/* iterations are batched until one sample takes at least this long */
+	double minSampleTimeMs = 0.5;
+	/* more samples are taken until a case ran this long */
+	double targetCaseTimeMs = 500.0;
+};
+
+class BenchmarkRunner {
+public:
+	/* the function runs one iteration, returning false skips the case */
+	void addCase(std::string name, std::function<bool()> function);
+	std::vector<BenchmarkResult> run(const BenchmarkSettings& settings);
+
+	static bool writeJson(std::string fileName, const std::vector<BenchmarkResult>& results);
+	static bool readJson(std::string fileName, std::vector<BenchmarkResult>& results);
+	/* logs a comparison table, returns the number of regressed cases */
+	static size_t compare(const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkResult>& baseline, double threshold);
+
+private:
+	std::vector<std::pair<std::string, std::function<bool()>>> mCases;
+
+	static bool runSample(const std::function<bool()>& function, size_t iterations, double& nanoseconds);
+	static BenchmarkResult summarize(std::string name, std::vector<double>& sampleTimes, size_t iterationsPerSample);
+};
\ No newline at end of file
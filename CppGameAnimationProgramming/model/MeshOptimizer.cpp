@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cmath>
+#include "MeshOptimizer.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	// Simulated LRU cache of the optimizer, larger than real FIFO caches to keep the order good for all of them
+	constexpr uint32_t OPTIMIZER_CACHE_SIZE = 32;
+
+	// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+	float getVertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+		if (remainingTriangles == 0) {
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			// Vertices of the last triangle get a fixed score, otherwise strips would win over fans
+			if (cachePosition < 3) {
+				score = 0.75f;
+			}
+			else {
+				score = std::pow(1.0f - (cachePosition - 3) / static_cast<float>(OPTIMIZER_CACHE_SIZE - 3), 1.5f);
+			}
+		}
+		// Vertices with few triangles left are finished first, so they do not have to come back later
+		return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+	}
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount, size_t vertexCount) {
+	PROFILE_FUNCTION();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+	const uint32_t* triangles = indices.data() + firstIndex;
+
+	// Triangles of every vertex, the first remainingTriangles entries are the ones not emitted yet
+	std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i) {
+		++remainingTriangles[triangles[i]];
+	}
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; ++i) {
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+	}
+	std::vector<uint32_t> adjacency(indexCount);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indexCount; ++i) {
+		adjacency[fill[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i) {
+		vertexScores[i] = getVertexScore(-1, remainingTriangles[i]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	uint32_t bestTriangle = 0;
+	for (size_t i = 0; i < triangleCount; ++i) {
+		triangleScores[i] = vertexScores[triangles[i * 3]] + vertexScores[triangles[i * 3 + 1]] + vertexScores[triangles[i * 3 + 2]];
+		if (triangleScores[i] > triangleScores[bestTriangle]) {
+			bestTriangle = static_cast<uint32_t>(i);
+		}
+	}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	// Fallback when no cached vertex has triangles left, the scan only moves forward
+	size_t nextUnemitted = 0;
+	while (result.size() < indexCount) {
+		emitted[bestTriangle] = 1;
+		newCache.clear();
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = triangles[bestTriangle * 3 + corner];
+			result.push_back(vertex);
+			newCache.push_back(vertex);
+			uint32_t* vertexTriangles = &adjacency[adjacencyOffsets[vertex]];
+			uint32_t* last = vertexTriangles + remainingTriangles[vertex];
+			uint32_t* found = std::find(vertexTriangles, last, bestTriangle);
+			// Degenerate triangles list the vertex twice, only the first corner removes the entry
+			if (found != last) {
+				*found = *(last - 1);
+				--remainingTriangles[vertex];
+			}
+		}
+		for (uint32_t vertex : cache) {
+			if (std::find(newCache.begin(), newCache.begin() + 3, vertex) == newCache.begin() + 3) {
+				newCache.push_back(vertex);
+			}
+		}
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			cachePositions[newCache[i]] = i < OPTIMIZER_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+			vertexScores[newCache[i]] = getVertexScore(cachePositions[newCache[i]], remainingTriangles[newCache[i]]);
+		}
+
+		// Only triangles touching the cache changed their score
+		float bestScore = -1.0f;
+		bool found = false;
+		for (uint32_t vertex : newCache) {
+			for (uint32_t i = 0; i < remainingTriangles[vertex]; ++i) {
+				uint32_t triangle = adjacency[adjacencyOffsets[vertex] + i];
+				float score = vertexScores[triangles[triangle * 3]] + vertexScores[triangles[triangle * 3 + 1]] +
+					vertexScores[triangles[triangle * 3 + 2]];
+				triangleScores[triangle] = score;
+				if (!found || score > bestScore) {
+					bestScore = score;
+					bestTriangle = triangle;
+					found = true;
+				}
+			}
+		}
+		if (newCache.size() > OPTIMIZER_CACHE_SIZE) {
+			newCache.resize(OPTIMIZER_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+		if (!found) {
+			while (nextUnemitted < triangleCount && emitted[nextUnemitted]) {
+				++nextUnemitted;
+			}
+			bestTriangle = static_cast<uint32_t>(nextUnemitted);
+			if (nextUnemitted == triangleCount) {
+				break;
+			}
+		}
+	}
+	std::copy(result.begin(), result.end(), indices.begin() + firstIndex);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount,
+		const std::vector<VkVertex>& vertices) {
+	PROFILE_FUNCTION();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+	const uint32_t* triangles = indices.data() + firstIndex;
+
+	// Clusters start where all three vertices miss the cache, moving them around costs almost no cache efficiency
+	const uint32_t cacheSize = 16;
+	std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+	uint32_t timestamp = cacheSize + 1;
+	std::vector<size_t> clusterStarts;
+	for (size_t i = 0; i < triangleCount; ++i) {
+		uint32_t misses = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = triangles[i * 3 + corner];
+			if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+				cacheTimestamps[vertex] = timestamp++;
+				++misses;
+			}
+		}
+		if (i == 0 || misses == 3) {
+			clusterStarts.push_back(i);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+	size_t clusterCount = clusterStarts.size() - 1;
+	if (clusterCount < 2) {
+		return;
+	}
+
+	// Area weighted centroids and normals
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+		float clusterArea = 0.0f;
+		for (size_t i = clusterStarts[cluster]; i < clusterStarts[cluster + 1]; ++i) {
+			glm::vec3 p0 = vertices[triangles[i * 3]].position;
+			glm::vec3 p1 = vertices[triangles[i * 3 + 1]].position;
+			glm::vec3 p2 = vertices[triangles[i * 3 + 2]].position;
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			clusterCentroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[cluster] += normal;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroids[cluster];
+		meshArea += clusterArea;
+		clusterCentroids[cluster] = clusterArea > 0.0f ? clusterCentroids[cluster] / clusterArea :
+			vertices[triangles[clusterStarts[cluster] * 3]].position;
+	}
+	if (meshArea == 0.0f) {
+		return;
+	}
+	meshCentroid /= meshArea;
+
+	// Winding conventions differ, the sign of the volume around the centroid tells whether the normals point outwards
+	double volume = 0.0;
+	for (size_t i = 0; i < triangleCount; ++i) {
+		glm::dvec3 p0 = glm::dvec3(vertices[triangles[i * 3]].position - meshCentroid);
+		glm::dvec3 p1 = glm::dvec3(vertices[triangles[i * 3 + 1]].position - meshCentroid);
+		glm::dvec3 p2 = glm::dvec3(vertices[triangles[i * 3 + 2]].position - meshCentroid);
+		volume += glm::dot(p0, glm::cross(p1, p2));
+	}
+	float outwardSign = volume < 0.0 ? -1.0f : 1.0f;
+
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<uint32_t> clusterOrder(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+		float length = glm::length(clusterNormals[cluster]);
+		glm::vec3 normal = length > 0.0f ? clusterNormals[cluster] * (outwardSign / length) : glm::vec3(0.0f);
+		sortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, normal);
+		clusterOrder[cluster] = static_cast<uint32_t>(cluster);
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+	for (uint32_t cluster : clusterOrder) {
+		result.insert(result.end(), triangles + clusterStarts[cluster] * 3, triangles + clusterStarts[cluster + 1] * 3);
+	}
+	std::copy(result.begin(), result.end(), indices.begin() + firstIndex);
+}
+
+void MeshOptimizer::optimizeVertexFetch(VkMesh& mesh, std::vector<uint32_t>& vertexRemap) {
+	PROFILE_FUNCTION();
+	const uint32_t unused = 0xffffffff;
+	vertexRemap.assign(mesh.vertices.size(), unused);
+	uint32_t nextVertex = 0;
+	for (uint32_t& index : mesh.indices) {
+		if (vertexRemap[index] == unused) {
+			vertexRemap[index] = nextVertex++;
+		}
+		index = vertexRemap[index];
+	}
+	for (uint32_t& newIndex : vertexRemap) {
+		if (newIndex == unused) {
+			newIndex = nextVertex++;
+		}
+	}
+	std::vector<VkVertex> vertices(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+		vertices[vertexRemap[i]] = mesh.vertices[i];
+	}
+	mesh.vertices.swap(vertices);
+}
+
+VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount,
+		size_t vertexCount, uint32_t cacheSize) {
+	VertexCacheStatistics statistics;
+	if (indexCount < 3) {
+		return statistics;
+	}
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	size_t misses = 0;
+	size_t usedVertices = 0;
+	for (size_t i = firstIndex; i < firstIndex + indexCount; ++i) {
+		uint32_t vertex = indices[i];
+		if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+			cacheTimestamps[vertex] = timestamp++;
+			++misses;
+		}
+		if (!used[vertex]) {
+			used[vertex] = 1;
+			++usedVertices;
+		}
+	}
+	statistics.acmr = static_cast<float>(misses) / (indexCount / 3);
+	statistics.atvr = static_cast<float>(misses) / usedVertices;
+	return statistics;
+}
+
+bool MeshOptimizer::optimize(VkMesh& mesh, bool reduceOverdraw, std::vector<uint32_t>* vertexRemap) {
+	PROFILE_FUNCTION();
+	if (mesh.indices.empty() || mesh.indices.size() % 3 != 0) {
+		LOG(Model, 1, "%s error: needs an indexed triangle list, got %zu indices\n", __FUNCTION__, mesh.indices.size());
+		return false;
+	}
+	for (uint32_t index : mesh.indices) {
+		if (index >= mesh.vertices.size()) {
+			LOG(Model, 1, "%s error: index %u out of range, mesh has %zu vertices\n", __FUNCTION__, index, mesh.vertices.size());
+			return false;
+		}
+	}
+	std::vector<VkMeshLod> lods = mesh.lods;
+	if (lods.empty()) {
+		lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+	}
+
+	VertexCacheStatistics before = analyzeVertexCache(mesh.indices, lods.front().firstIndex, lods.front().indexCount, mesh.vertices.size());
+	for (const VkMeshLod& lod : lods) {
+		optimizeVertexCache(mesh.indices, lod.firstIndex, lod.indexCount, mesh.vertices.size());
+		if (reduceOverdraw) {
+			optimizeOverdraw(mesh.indices, lod.firstIndex, lod.indexCount, mesh.vertices);
+		}
+	}
+	// The finest level comes first in the index list, its vertices end up in front
+	std::vector<uint32_t> remap;
+	optimizeVertexFetch(mesh, remap);
+	VertexCacheStatistics after = analyzeVertexCache(mesh.indices, lods.front().firstIndex, lods.front().indexCount, mesh.vertices.size());
+	LOG(Model, 1, "%s: %u triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", __FUNCTION__, lods.front().indexCount / 3,
+		before.acmr, after.acmr, before.atvr, after.atvr);
+	if (vertexRemap) {
+		*vertexRemap = std::move(remap);
+	}
+	return true;
+}
\ No newline at end of file
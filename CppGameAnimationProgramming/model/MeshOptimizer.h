@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "VkRenderData.h"
+
+/* post-transform cache efficiency, ACMR is misses per triangle (0.5 is ideal for regular grids), ATVR misses per used vertex (ideal 1) */
+struct VertexCacheStatistics {
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+/* reorders triangles and vertices of a mesh for the vertex cache, vertex fetch and overdraw; the triangles stay the same */
+class MeshOptimizer {
+public:
+	/* all steps on every LOD range, logs ACMR and ATVR before and after
+	 * vertexRemap gets the new index of every old vertex, per-vertex data outside of VkMesh has to follow it */
+	static bool optimize(VkMesh& mesh, bool reduceOverdraw = true, std::vector<uint32_t>* vertexRemap = nullptr);
+	/* Forsyth's linear-speed vertex cache optimization of [firstIndex, firstIndex + indexCount) */
+	static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount, size_t vertexCount);
+	/* view independent: clusters of a cache optimized range that stick out of the mesh go first, they occlude the rest more often */
+	static void optimizeOverdraw(std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount, const std::vector<VkVertex>& vertices);
+	/* vertices in order of first use, unused ones move to the end */
+	static void optimizeVertexFetch(VkMesh& mesh, std::vector<uint32_t>& vertexRemap);
+	/* FIFO cache simulation of [firstIndex, firstIndex + indexCount) */
+	static VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount,
+		size_t vertexCount, uint32_t cacheSize = 16);
+};
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+#include "MeshSimplifier.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	/* symmetric 4x4 matrix summing the squared distances to a set of planes */
+	struct Quadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+
+		void addPlane(const glm::dvec3& normal, double distance) {
+			a00 += normal.x * normal.x;
+			a01 += normal.x * normal.y;
+			a02 += normal.x * normal.z;
+			a03 += normal.x * distance;
+			a11 += normal.y * normal.y;
+			a12 += normal.y * normal.z;
+			a13 += normal.y * distance;
+			a22 += normal.z * normal.z;
+			a23 += normal.z * distance;
+			a33 += distance * distance;
+		}
+
+		void add(const Quadric& other) {
+			a00 += other.a00;
+			a01 += other.a01;
+			a02 += other.a02;
+			a03 += other.a03;
+			a11 += other.a11;
+			a12 += other.a12;
+			a13 += other.a13;
+			a22 += other.a22;
+			a23 += other.a23;
+			a33 += other.a33;
+		}
+
+		double evaluate(const glm::vec3& position) const {
+			double x = position.x;
+			double y = position.y;
+			double z = position.z;
+			double result = a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+				2.0 * (a01 * x * y + a02 * x * z + a03 * x + a12 * y * z + a13 * y + a23 * z);
+			// Rounding can dip slightly below zero
+			return std::max(result, 0.0);
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b) {
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	// Triangle normal scaled by twice its area
+	glm::vec3 getTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+		return glm::cross(p1 - p0, p2 - p0);
+	}
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<VkVertex>& vertices, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float maxError, float& error) {
+	PROFILE_FUNCTION();
+	error = 0.0f;
+	std::vector<uint32_t> result = indices;
+	size_t vertexCount = vertices.size();
+
+	// Edges used by one triangle only are on a border or on a UV seam, where the vertices are split
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	edgeUses.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3) {
+		for (size_t corner = 0; corner < 3; ++corner) {
+			++edgeUses[edgeKey(result[i + corner], result[i + (corner + 1) % 3])];
+		}
+	}
+	std::vector<uint8_t> locked(vertexCount, 0);
+	for (const auto& edge : edgeUses) {
+		if (edge.second != 2) {
+			locked[edge.first >> 32] = 1;
+			locked[edge.first & 0xffffffff] = 1;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		glm::vec3 p0 = vertices[result[i]].position;
+		glm::vec3 normal = getTriangleNormal(p0, vertices[result[i + 1]].position, vertices[result[i + 2]].position);
+		float length = glm::length(normal);
+		if (length == 0.0f) {
+			continue;
+		}
+		glm::dvec3 planeNormal = glm::dvec3(normal / length);
+		double distance = -glm::dot(planeNormal, glm::dvec3(p0));
+		for (size_t corner = 0; corner < 3; ++corner) {
+			quadrics[result[i + corner]].addPlane(planeNormal, distance);
+		}
+	}
+	// Costs are squared distances summed over the planes
+	double maxCost = static_cast<double>(maxError) * maxError;
+
+	std::vector<uint32_t> triangleOffsets;
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+	// Each pass collapses independent edges in order of cost, then the index list is rebuilt
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+		triangleOffsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : result) {
+			++triangleOffsets[index + 1];
+		}
+		for (size_t i = 0; i < vertexCount; ++i) {
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+		vertexTriangles.resize(result.size());
+		std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); ++i) {
+			vertexTriangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t a = result[i + corner];
+				uint32_t b = result[i + (corner + 1) % 3];
+				// Both directions, the cheaper one usually wins
+				if (!locked[a]) {
+					collapses.push_back({ a, b, quadrics[a].evaluate(vertices[b].position) });
+				}
+				if (!locked[b]) {
+					collapses.push_back({ b, a, quadrics[b].evaluate(vertices[a].position) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		for (size_t i = 0; i < vertexCount; ++i) {
+			remap[i] = static_cast<uint32_t>(i);
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t removedTriangles = 0;
+		size_t collapseCount = 0;
+		size_t targetTriangleCount = targetIndexCount / 3;
+		for (const Collapse& collapse : collapses) {
+			if (collapse.cost > maxCost || triangleCount - removedTriangles <= targetTriangleCount) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+			// Triangles around the removed vertex must not flip or turn by more than 60 degrees when it moves onto the kept one,
+			// smaller turns add up over the passes into folds
+			bool flips = false;
+			size_t sharedTriangles = 0;
+			glm::vec3 target = vertices[collapse.to].position;
+			for (uint32_t j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1] && !flips; ++j) {
+				const uint32_t* triangle = &result[vertexTriangles[j] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+					++sharedTriangles;
+					continue;
+				}
+				glm::vec3 positions[3];
+				glm::vec3 moved[3];
+				for (size_t corner = 0; corner < 3; ++corner) {
+					positions[corner] = vertices[triangle[corner]].position;
+					moved[corner] = triangle[corner] == collapse.from ? target : positions[corner];
+				}
+				glm::vec3 before = getTriangleNormal(positions[0], positions[1], positions[2]);
+				glm::vec3 after = getTriangleNormal(moved[0], moved[1], moved[2]);
+				flips = glm::dot(before, after) <= 0.5f * glm::length(before) * glm::length(after);
+			}
+			if (flips) {
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+			removedTriangles += sharedTriangles;
+			++collapseCount;
+			// Flip tests of later collapses in this pass see the triangles as they were, keep them away from this one
+			for (uint32_t j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1]; ++j) {
+				const uint32_t* triangle = &result[vertexTriangles[j] * 3];
+				touched[triangle[0]] = 1;
+				touched[triangle[1]] = 1;
+				touched[triangle[2]] = 1;
+			}
+		}
+		if (collapseCount == 0) {
+			break;
+		}
+
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = remap[result[i]];
+			uint32_t b = remap[result[i + 1]];
+			uint32_t c = remap[result[i + 2]];
+			if (a == b || b == c || a == c) {
+				continue;
+			}
+			result[writeIndex++] = a;
+			result[writeIndex++] = b;
+			result[writeIndex++] = c;
+		}
+		result.resize(writeIndex);
+	}
+	return result;
+}
+
+bool MeshSimplifier::generateLods(VkMesh& mesh, uint32_t maxLodCount, float maxRelativeError) {
+	PROFILE_FUNCTION();
+	if (mesh.indices.empty()) {
+		mesh.indices.resize(mesh.vertices.size());
+		for (size_t i = 0; i < mesh.indices.size(); ++i) {
+			mesh.indices.at(i) = static_cast<uint32_t>(i);
+		}
+	}
+	if (mesh.indices.size() % 3 != 0) {
+		LOG(Model, 1, "%s error: %zu indices do not form triangles\n", __FUNCTION__, mesh.indices.size());
+		return false;
+	}
+	for (uint32_t index : mesh.indices) {
+		if (index >= mesh.vertices.size()) {
+			LOG(Model, 1, "%s error: index %u out of range, mesh has %zu vertices\n", __FUNCTION__, index, mesh.vertices.size());
+			return false;
+		}
+	}
+
+	// Earlier levels stay, only the finest one is the source
+	if (!mesh.lods.empty()) {
+		VkMeshLod finest = mesh.lods.front();
+		mesh.indices = std::vector<uint32_t>(mesh.indices.begin() + finest.firstIndex,
+			mesh.indices.begin() + finest.firstIndex + finest.indexCount);
+	}
+	mesh.lods = { { 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f } };
+
+	glm::vec3 minimum(FLT_MAX);
+	glm::vec3 maximum(-FLT_MAX);
+	for (const VkVertex& vertex : mesh.vertices) {
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+	float maxError = mesh.vertices.empty() ? 0.0f : glm::length(maximum - minimum) * maxRelativeError;
+
+	// Every level starts from the previous one, the deviations add up along the chain
+	std::vector<uint32_t> lodIndices = mesh.indices;
+	while (mesh.lods.size() < maxLodCount && mesh.lods.back().error < maxError) {
+		float error = 0.0f;
+		std::vector<uint32_t> simplified = simplify(mesh.vertices, lodIndices, lodIndices.size() / 6 * 3,
+			maxError - mesh.lods.back().error, error);
+		// Less than a tenth removed is not worth another level
+		if (simplified.empty() || simplified.size() > lodIndices.size() * 9 / 10) {
+			break;
+		}
+		VkMeshLod lod{};
+		lod.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+		lod.indexCount = static_cast<uint32_t>(simplified.size());
+		lod.error = mesh.lods.back().error + error;
+		mesh.lods.push_back(lod);
+		mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+		lodIndices = std::move(simplified);
+	}
+	LOG(Model, 1, "%s: %zu levels, coarsest has %u of %u triangles, error %g\n", __FUNCTION__, mesh.lods.size(),
+		mesh.lods.back().indexCount / 3, mesh.lods.front().indexCount / 3, mesh.lods.back().error);
+	return true;
+}
\ No newline at end of file
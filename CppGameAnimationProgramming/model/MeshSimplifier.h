@@ -0,0 +1,17 @@
+#pragma once
+#include <vector>
+#include "VkRenderData.h"
+
+/* quadric error metric simplification into a chain of levels of detail
+ * vertices are only dropped, never moved or created, so per vertex data like joint weights stays valid for every level */
+class MeshSimplifier {
+public:
+	/* replaces mesh.lods, the coarser levels are appended to mesh.indices with about half the triangles each;
+	 * stops at maxLodCount levels, when a level would deviate more than maxRelativeError times the mesh size,
+	 * or when the mesh does not get simpler */
+	static bool generateLods(VkMesh& mesh, uint32_t maxLodCount = VkMeshDrawData::MAX_LODS, float maxRelativeError = 0.05f);
+	/* collapses edges until at most targetIndexCount indices are left or the next collapse costs more than maxError,
+	 * error gets the largest deviation of the result; border and UV seam vertices stay in place */
+	static std::vector<uint32_t> simplify(const std::vector<VkVertex>& vertices, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float maxError, float& error);
+};
\ No newline at end of file
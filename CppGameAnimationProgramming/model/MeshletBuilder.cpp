@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include "MeshletBuilder.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	// Vertex not in the current meshlet
+	constexpr uint8_t UNUSED_VERTEX = 0xff;
+}
+
+bool MeshletBuilder::build(const VkMesh& mesh, VkMeshletMesh& meshletMesh) {
+	PROFILE_FUNCTION();
+	meshletMesh = VkMeshletMesh{};
+	size_t firstIndex = 0;
+	size_t indexCount = mesh.indices.empty() ? mesh.vertices.size() : mesh.indices.size();
+	// Only the finest level, the coarse ones are for distant instances
+	if (!mesh.lods.empty() && !mesh.indices.empty()) {
+		firstIndex = mesh.lods.front().firstIndex;
+		indexCount = mesh.lods.front().indexCount;
+	}
+	if (indexCount % 3 != 0) {
+		LOG(Model, 1, "%s error: %zu indices do not form triangles\n", __FUNCTION__, indexCount);
+		return false;
+	}
+	meshletMesh.triangles.reserve(indexCount / 3);
+	meshletMesh.meshlets.reserve(indexCount / 3 / VkMeshlet::MAX_TRIANGLES + 1);
+
+	// Meshlet local index of every mesh vertex, only the entries of the current meshlet are set
+	std::vector<uint8_t> localIndices(mesh.vertices.size(), UNUSED_VERTEX);
+	VkMeshlet meshlet{};
+	for (size_t i = 0; i < indexCount; i += 3) {
+		uint32_t triangle[3];
+		uint32_t newVertexCount = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			triangle[corner] = mesh.indices.empty() ? static_cast<uint32_t>(i + corner) : mesh.indices[firstIndex + i + corner];
+			if (triangle[corner] >= mesh.vertices.size()) {
+				LOG(Model, 1, "%s error: index %u out of range, mesh has %zu vertices\n", __FUNCTION__, triangle[corner], mesh.vertices.size());
+				meshletMesh = VkMeshletMesh{};
+				return false;
+			}
+			// Repeated corners of degenerate triangles are counted twice, that only closes the meshlet early
+			if (localIndices[triangle[corner]] == UNUSED_VERTEX) {
+				++newVertexCount;
+			}
+		}
+		if (meshlet.vertexCount + newVertexCount > VkMeshlet::MAX_VERTICES || meshlet.triangleCount == VkMeshlet::MAX_TRIANGLES) {
+			finishMeshlet(mesh, meshlet, meshletMesh, localIndices);
+		}
+
+		uint32_t packedTriangle = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = triangle[corner];
+			if (localIndices[vertex] == UNUSED_VERTEX) {
+				localIndices[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+				meshletMesh.vertices.push_back(vertex);
+			}
+			packedTriangle |= static_cast<uint32_t>(localIndices[vertex]) << (corner * 8);
+		}
+		meshletMesh.triangles.push_back(packedTriangle);
+		++meshlet.triangleCount;
+	}
+	if (meshlet.triangleCount > 0) {
+		finishMeshlet(mesh, meshlet, meshletMesh, localIndices);
+	}
+	LOG(Model, 1, "%s: %zu triangles in %zu meshlets\n", __FUNCTION__, meshletMesh.triangles.size(), meshletMesh.meshlets.size());
+	return true;
+}
+
+void MeshletBuilder::finishMeshlet(const VkMesh& mesh, VkMeshlet& meshlet, VkMeshletMesh& meshletMesh, std::vector<uint8_t>& localIndices) {
+	auto getPosition = [&mesh, &meshletMesh, &meshlet](uint32_t localIndex) {
+		return mesh.vertices[meshletMesh.vertices[meshlet.vertexOffset + localIndex]].position;
+	};
+
+	// Sphere around the box center, a few percent larger than the smallest one
+	glm::vec3 minimum(FLT_MAX);
+	glm::vec3 maximum(-FLT_MAX);
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+		minimum = glm::min(minimum, getPosition(i));
+		maximum = glm::max(maximum, getPosition(i));
+	}
+	glm::vec3 center = (minimum + maximum) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+		radius = std::max(radius, glm::length(getPosition(i) - center));
+	}
+	meshlet.boundingSphere = glm::vec4(center, radius);
+
+	// The cone axis is the average of the unit normals, degenerate triangles have no say
+	std::array<glm::vec3, VkMeshlet::MAX_TRIANGLES> normals;
+	glm::vec3 normalSum(0.0f);
+	for (uint32_t i = 0; i < meshlet.triangleCount; ++i) {
+		uint32_t packedTriangle = meshletMesh.triangles[meshlet.triangleOffset + i];
+		glm::vec3 p0 = getPosition(packedTriangle & 0xff);
+		glm::vec3 p1 = getPosition((packedTriangle >> 8) & 0xff);
+		glm::vec3 p2 = getPosition((packedTriangle >> 16) & 0xff);
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		normals[i] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+		normalSum += normals[i];
+	}
+	meshlet.normalCone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float axisLength = glm::length(normalSum);
+	if (axisLength > 0.0f) {
+		glm::vec3 axis = normalSum / axisLength;
+		float minimumDot = 1.0f;
+		for (uint32_t i = 0; i < meshlet.triangleCount; ++i) {
+			if (normals[i] != glm::vec3(0.0f)) {
+				minimumDot = std::min(minimumDot, glm::dot(normals[i], axis));
+			}
+		}
+		// Cones wider than about 84 degrees almost never face away as a whole, their test stays off
+		if (minimumDot > 0.1f) {
+			meshlet.normalCone = glm::vec4(axis, std::sqrt(1.0f - minimumDot * minimumDot));
+		}
+	}
+	meshletMesh.meshlets.push_back(meshlet);
+
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+		localIndices[meshletMesh.vertices[meshlet.vertexOffset + i]] = UNUSED_VERTEX;
+	}
+	meshlet = VkMeshlet{};
+	meshlet.vertexOffset = static_cast<uint32_t>(meshletMesh.vertices.size());
+	meshlet.triangleOffset = static_cast<uint32_t>(meshletMesh.triangles.size());
+}
\ No newline at end of file
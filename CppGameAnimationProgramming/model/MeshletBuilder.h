@@ -0,0 +1,13 @@
+#pragma once
+#include "VkRenderData.h"
+
+/* splits indexed meshes into meshlets at load time, each with a bounding sphere and a normal cone */
+class MeshletBuilder {
+public:
+	/* greedy in index order, so meshes with good vertex locality give the tightest meshlets;
+	 * triangle normals follow cross(p1 - p0, p2 - p0), meshes without indices are drawn in vertex order */
+	static bool build(const VkMesh& mesh, VkMeshletMesh& meshletMesh);
+
+private:
+	static void finishMeshlet(const VkMesh& mesh, VkMeshlet& meshlet, VkMeshletMesh& meshletMesh, std::vector<uint8_t>& localIndices);
+};
\ No newline at end of file
@@ -1,21 +1,25 @@
 #include "Model.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
 #include "Logger.h"
+#include "Profiler.h"
 
 void Model::init() {
-	mVertexData.vertices.resize(6);
+	PROFILE_FUNCTION();
+	mVertexData.vertices.resize(4);
 	mVertexData.vertices[0].position = glm::vec3(-0.5f, -0.5f, 0.5f);
 	mVertexData.vertices[1].position = glm::vec3(0.5f, 0.5f, 0.5f);
 	mVertexData.vertices[2].position = glm::vec3(-0.5f, 0.5f, 0.5f);
-	mVertexData.vertices[3].position = glm::vec3(-0.5f, -0.5f, 0.5f);
-	mVertexData.vertices[4].position = glm::vec3(0.5f, -0.5f, 0.5f);
-	mVertexData.vertices[5].position = glm::vec3(0.5f, 0.5f, 0.5f);
+	mVertexData.vertices[3].position = glm::vec3(0.5f, -0.5f, 0.5f);
 	mVertexData.vertices[0].uv = glm::vec2(0.0f, 0.0f);
 	mVertexData.vertices[1].uv = glm::vec2(1.0f, 1.0f);
 	mVertexData.vertices[2].uv = glm::vec2(0.0f, 1.0f);
-	mVertexData.vertices[3].uv = glm::vec2(0.0f, 0.0f);
-	mVertexData.vertices[4].uv = glm::vec2(1.0f, 0.0f);
-	mVertexData.vertices[5].uv = glm::vec2(1.0f, 1.0f);
-	Logger::log(1, "%s: loaded %d vertices\n", __FUNCTION__, mVertexData.vertices.size());
+	mVertexData.vertices[3].uv = glm::vec2(1.0f, 0.0f);
+	mVertexData.indices = { 0, 1, 2, 0, 3, 1 };
+	MeshSimplifier::generateLods(mVertexData);
+	// Done at load for now, the same call works in an offline cooking step
+	MeshOptimizer::optimize(mVertexData);
+	LOG(Model, 1, "%s: loaded %zu vertices, %zu indices\n", __FUNCTION__, mVertexData.vertices.size(), mVertexData.indices.size());
 }
 
 /*
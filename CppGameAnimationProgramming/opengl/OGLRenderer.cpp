@@ -2,11 +2,11 @@
 
 bool OGLRenderer::init(unsigned int width, unsigned int height) {
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		Logger::log(1, "%s error: failed to initialize GLAD\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: failed to initialize GLAD\n", __FUNCTION__);
 		return false;
 	}
 	if (!GLAD_GL_VERSION_4_6) {
-		Logger::log(1, "%s error: failed to get at least OpenGL 4.6\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: failed to get at least OpenGL 4.6\n", __FUNCTION__);
 		return false;
 	}
 
@@ -14,7 +14,7 @@ bool OGLRenderer::init(unsigned int width, unsigned int height) {
 		return false;
 	}
 	if (!mTex.loadTexture("crate.png")) {
-		Logger::log(1, "%s: texture loading failed\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s: texture loading failed\n", __FUNCTION__);
 		return false;
 	}
 	mVertexBuffer.init();
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cfloat>
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// SSE2 is part of every x64 target, an 8-wide AVX path would need /arch:AVX for the whole build
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_USE_SSE 1
+#include <xmmintrin.h>
+#else
+#define BVH_USE_SSE 0
+#endif
+
+void Bvh::build(const std::vector<Aabb>& bounds) {
+	PROFILE_FUNCTION();
+	mNodes.clear();
+	mBounds = bounds;
+	mInstanceNodes.assign(bounds.size(), EMPTY);
+	mDirty = false;
+	if (bounds.empty()) {
+		mDirtyNodes.clear();
+		return;
+	}
+
+	std::vector<glm::vec3> centers(bounds.size());
+	std::vector<uint32_t> instances(bounds.size());
+	for (size_t i = 0; i < bounds.size(); ++i) {
+		centers.at(i) = (bounds.at(i).min + bounds.at(i).max) * 0.5f;
+		instances.at(i) = static_cast<uint32_t>(i);
+	}
+	// Median splits leave a bit more than one node per two instances
+	mNodes.reserve(bounds.size() / 2 + 1);
+	buildNode(instances, 0, instances.size(), EMPTY, centers);
+	mDirtyNodes.assign(mNodes.size(), 0);
+}
+
+uint32_t Bvh::buildNode(std::vector<uint32_t>& instances, size_t first, size_t count, uint32_t parent,
+		const std::vector<glm::vec3>& centers) {
+	uint32_t nodeIndex = static_cast<uint32_t>(mNodes.size());
+	mNodes.emplace_back();
+	mNodes.back().parent = parent;
+
+	// The largest range is halved at the median of its widest axis until there are four
+	size_t rangeFirst[WIDTH] = { first };
+	size_t rangeCount[WIDTH] = { count };
+	uint32_t rangeNum = 1;
+	while (rangeNum < WIDTH) {
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < rangeNum; ++i) {
+			if (rangeCount[i] > rangeCount[largest]) {
+				largest = i;
+			}
+		}
+		if (rangeCount[largest] <= 1) {
+			break;
+		}
+		size_t begin = rangeFirst[largest];
+		size_t size = rangeCount[largest];
+		glm::vec3 low = glm::vec3(FLT_MAX);
+		glm::vec3 high = glm::vec3(-FLT_MAX);
+		for (size_t i = begin; i < begin + size; ++i) {
+			low = glm::min(low, centers[instances[i]]);
+			high = glm::max(high, centers[instances[i]]);
+		}
+		glm::vec3 extent = high - low;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		size_t half = size / 2;
+		std::nth_element(instances.begin() + begin, instances.begin() + begin + half, instances.begin() + begin + size,
+			[&centers, axis](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+		rangeCount[largest] = half;
+		rangeFirst[rangeNum] = begin + half;
+		rangeCount[rangeNum] = size - half;
+		++rangeNum;
+	}
+
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		// mNodes grows during the recursion, no references across buildNode()
+		if (lane >= rangeNum) {
+			mNodes[nodeIndex].child[lane] = EMPTY;
+			setLane(mNodes[nodeIndex], lane, Aabb{});
+		}
+		else if (rangeCount[lane] == 1) {
+			uint32_t instance = instances[rangeFirst[lane]];
+			mInstanceNodes[instance] = nodeIndex;
+			mNodes[nodeIndex].child[lane] = instance | INSTANCE_BIT;
+			setLane(mNodes[nodeIndex], lane, mBounds[instance]);
+		}
+		else {
+			uint32_t childIndex = buildNode(instances, rangeFirst[lane], rangeCount[lane], nodeIndex, centers);
+			mNodes[nodeIndex].child[lane] = childIndex;
+			setLane(mNodes[nodeIndex], lane, getNodeBounds(childIndex));
+		}
+	}
+	return nodeIndex;
+}
+
+void Bvh::setLane(Node& node, uint32_t lane, const Aabb& bounds) {
+	node.minX[lane] = bounds.min.x;
+	node.minY[lane] = bounds.min.y;
+	node.minZ[lane] = bounds.min.z;
+	node.maxX[lane] = bounds.max.x;
+	node.maxY[lane] = bounds.max.y;
+	node.maxZ[lane] = bounds.max.z;
+}
+
+Aabb Bvh::getNodeBounds(uint32_t nodeIndex) const {
+	const Node& node = mNodes[nodeIndex];
+	Aabb bounds{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		if (node.child[lane] == EMPTY) {
+			continue;
+		}
+		bounds.min = glm::min(bounds.min, glm::vec3(node.minX[lane], node.minY[lane], node.minZ[lane]));
+		bounds.max = glm::max(bounds.max, glm::vec3(node.maxX[lane], node.maxY[lane], node.maxZ[lane]));
+	}
+	return bounds;
+}
+
+void Bvh::updateBounds(uint32_t instance, const Aabb& bounds) {
+	mBounds.at(instance) = bounds;
+	// Stops at the first node an earlier update already marked, its parents are marked too
+	for (uint32_t node = mInstanceNodes.at(instance); node != EMPTY && !mDirtyNodes[node]; node = mNodes[node].parent) {
+		mDirtyNodes[node] = 1;
+	}
+	mDirty = true;
+}
+
+void Bvh::refit() {
+	if (!mDirty) {
+		return;
+	}
+	PROFILE_FUNCTION();
+	// Children are stored after their parent, walking backwards updates them first
+	for (size_t i = mNodes.size(); i-- > 0;) {
+		if (!mDirtyNodes[i]) {
+			continue;
+		}
+		mDirtyNodes[i] = 0;
+		Node& node = mNodes[i];
+		for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+			uint32_t child = node.child[lane];
+			if (child == EMPTY) {
+				continue;
+			}
+			if (child & INSTANCE_BIT) {
+				setLane(node, lane, mBounds[child & ~INSTANCE_BIT]);
+			}
+			else {
+				setLane(node, lane, getNodeBounds(child));
+			}
+		}
+	}
+	mDirty = false;
+}
+
+uint32_t Bvh::testNode(const Node& node, const Frustum& frustum, uint32_t& insideMask) {
+	uint32_t validMask = 0;
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		validMask |= node.child[lane] != EMPTY ? 1u << lane : 0u;
+	}
+	// Per axis the corner farthest along the plane normal gives the larger product, the nearest one the smaller;
+	// outside when the farthest corner is behind a plane, fully inside when the nearest corner is in front of all
+	uint32_t outsideMask = 0;
+	uint32_t crossingMask = 0;
+#if BVH_USE_SSE
+	__m128 minX = _mm_load_ps(node.minX);
+	__m128 minY = _mm_load_ps(node.minY);
+	__m128 minZ = _mm_load_ps(node.minZ);
+	__m128 maxX = _mm_load_ps(node.maxX);
+	__m128 maxY = _mm_load_ps(node.maxY);
+	__m128 maxZ = _mm_load_ps(node.maxZ);
+	__m128 zero = _mm_setzero_ps();
+	__m128 outside = zero;
+	__m128 crossing = zero;
+	for (const glm::vec4& plane : frustum.planes) {
+		__m128 normalX = _mm_set1_ps(plane.x);
+		__m128 normalY = _mm_set1_ps(plane.y);
+		__m128 normalZ = _mm_set1_ps(plane.z);
+		__m128 lowX = _mm_mul_ps(normalX, minX);
+		__m128 highX = _mm_mul_ps(normalX, maxX);
+		__m128 lowY = _mm_mul_ps(normalY, minY);
+		__m128 highY = _mm_mul_ps(normalY, maxY);
+		__m128 lowZ = _mm_mul_ps(normalZ, minZ);
+		__m128 highZ = _mm_mul_ps(normalZ, maxZ);
+		__m128 distance = _mm_set1_ps(plane.w);
+		__m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_max_ps(lowX, highX), _mm_max_ps(lowY, highY)),
+			_mm_add_ps(_mm_max_ps(lowZ, highZ), distance));
+		__m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_min_ps(lowX, highX), _mm_min_ps(lowY, highY)),
+			_mm_add_ps(_mm_min_ps(lowZ, highZ), distance));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(farDistance, zero));
+		crossing = _mm_or_ps(crossing, _mm_cmplt_ps(nearDistance, zero));
+	}
+	outsideMask = static_cast<uint32_t>(_mm_movemask_ps(outside));
+	crossingMask = static_cast<uint32_t>(_mm_movemask_ps(crossing));
+#else
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		for (const glm::vec4& plane : frustum.planes) {
+			float lowX = plane.x * node.minX[lane];
+			float highX = plane.x * node.maxX[lane];
+			float lowY = plane.y * node.minY[lane];
+			float highY = plane.y * node.maxY[lane];
+			float lowZ = plane.z * node.minZ[lane];
+			float highZ = plane.z * node.maxZ[lane];
+			float farDistance = std::max(lowX, highX) + std::max(lowY, highY) + std::max(lowZ, highZ) + plane.w;
+			float nearDistance = std::min(lowX, highX) + std::min(lowY, highY) + std::min(lowZ, highZ) + plane.w;
+			outsideMask |= farDistance < 0.0f ? 1u << lane : 0u;
+			crossingMask |= nearDistance < 0.0f ? 1u << lane : 0u;
+		}
+	}
+#endif
+	uint32_t visibleMask = validMask & ~outsideMask;
+	insideMask = visibleMask & ~crossingMask;
+	return visibleMask;
+}
+
+void Bvh::cull(const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const {
+	PROFILE_FUNCTION();
+	if (mNodes.empty()) {
+		return;
+	}
+	cullNode(0, frustum, visibleInstances);
+}
+
+void Bvh::cullNode(uint32_t nodeIndex, const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const {
+	const Node& node = mNodes[nodeIndex];
+	uint32_t insideMask = 0;
+	uint32_t visibleMask = testNode(node, frustum, insideMask);
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		if (!(visibleMask & (1u << lane))) {
+			continue;
+		}
+		uint32_t child = node.child[lane];
+		if (child & INSTANCE_BIT) {
+			visibleInstances.push_back(child & ~INSTANCE_BIT);
+		}
+		else if (insideMask & (1u << lane)) {
+			appendSubtree(child, visibleInstances);
+		}
+		else {
+			cullNode(child, frustum, visibleInstances);
+		}
+	}
+}
+
+void Bvh::appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visibleInstances) const {
+	const Node& node = mNodes[nodeIndex];
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		uint32_t child = node.child[lane];
+		if (child == EMPTY) {
+			continue;
+		}
+		if (child & INSTANCE_BIT) {
+			visibleInstances.push_back(child & ~INSTANCE_BIT);
+		}
+		else {
+			appendSubtree(child, visibleInstances);
+		}
+	}
+}
+
+void Bvh::expandTask(const CullTask& task, const Frustum& frustum, std::vector<CullTask>& tasks,
+		std::vector<uint32_t>& visibleInstances) const {
+	const Node& node = mNodes[task.node];
+	uint32_t insideMask = 0xf;
+	uint32_t visibleMask = 0;
+	if (task.inside) {
+		for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+			visibleMask |= node.child[lane] != EMPTY ? 1u << lane : 0u;
+		}
+	}
+	else {
+		visibleMask = testNode(node, frustum, insideMask);
+	}
+	for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+		if (!(visibleMask & (1u << lane))) {
+			continue;
+		}
+		uint32_t child = node.child[lane];
+		if (child & INSTANCE_BIT) {
+			visibleInstances.push_back(child & ~INSTANCE_BIT);
+		}
+		else {
+			tasks.push_back({ child, (insideMask & (1u << lane)) != 0 });
+		}
+	}
+}
+
+void Bvh::cullParallel(const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const {
+	PROFILE_FUNCTION();
+	unsigned int threadCount = JobSystem::getThreadCount() + 1;
+	if (mNodes.empty() || threadCount == 1) {
+		cull(frustum, visibleInstances);
+		return;
+	}
+
+	// The top levels are culled here until there are a few subtrees per thread to balance uneven visibility
+	size_t targetTaskCount = threadCount * 8;
+	std::vector<CullTask> tasks = { { 0, false } };
+	std::vector<CullTask> nextTasks;
+	while (!tasks.empty() && tasks.size() < targetTaskCount) {
+		nextTasks.clear();
+		for (const CullTask& task : tasks) {
+			expandTask(task, frustum, nextTasks, visibleInstances);
+		}
+		tasks.swap(nextTasks);
+	}
+
+	std::vector<std::vector<uint32_t>> taskInstances(tasks.size());
+	JobSystem::parallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			if (tasks[i].inside) {
+				appendSubtree(tasks[i].node, taskInstances[i]);
+			}
+			else {
+				cullNode(tasks[i].node, frustum, taskInstances[i]);
+			}
+		}
+	});
+
+	size_t visibleCount = visibleInstances.size();
+	for (const std::vector<uint32_t>& instances : taskInstances) {
+		visibleCount += instances.size();
+	}
+	visibleInstances.reserve(visibleCount);
+	for (const std::vector<uint32_t>& instances : taskInstances) {
+		visibleInstances.insert(visibleInstances.end(), instances.begin(), instances.end());
+	}
+}
+
+size_t Bvh::getInstanceCount() const {
+	return mBounds.size();
+}
+
+size_t Bvh::getNodeCount() const {
+	return mNodes.size();
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+struct Aabb {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+};
+
+/* four-wide bounding volume hierarchy over instance boxes for culling on the CPU
+ * a node keeps the boxes of its four children side by side, one SIMD test checks all of them */
+class Bvh {
+public:
+	/* instance i gets bounds[i], replaces the previous tree */
+	void build(const std::vector<Aabb>& bounds);
+	/* for moving instances, the tree sees the new box after the next refit() */
+	void updateBounds(uint32_t instance, const Aabb& bounds);
+	/* resizes the boxes above changed instances, the tree layout stays;
+	 * rebuild once instances moved far away from where they were at build time */
+	void refit();
+	/* appends the instances touching the frustum, subtrees fully inside are taken without further tests */
+	void cull(const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const;
+	/* same instances as cull() in a different order, the subtrees are culled on the job system */
+	void cullParallel(const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const;
+
+	size_t getInstanceCount() const;
+	size_t getNodeCount() const;
+
+private:
+	static constexpr uint32_t WIDTH = 4;
+	static constexpr uint32_t EMPTY = 0xffffffff;
+	// Lanes with this bit hold an instance instead of a node
+	static constexpr uint32_t INSTANCE_BIT = 0x80000000;
+
+	/* structure of arrays, lane i of every array belongs to child[i] */
+	struct Node {
+		alignas(16) float minX[WIDTH];
+		float minY[WIDTH];
+		float minZ[WIDTH];
+		float maxX[WIDTH];
+		float maxY[WIDTH];
+		float maxZ[WIDTH];
+		uint32_t child[WIDTH];
+		uint32_t parent;
+	};
+	struct CullTask {
+		uint32_t node;
+		bool inside;
+	};
+
+	std::vector<Node> mNodes;
+	std::vector<Aabb> mBounds;
+	// Node holding the instance in one of its lanes
+	std::vector<uint32_t> mInstanceNodes;
+	std::vector<uint8_t> mDirtyNodes;
+	bool mDirty = false;
+
+	uint32_t buildNode(std::vector<uint32_t>& instances, size_t first, size_t count, uint32_t parent,
+		const std::vector<glm::vec3>& centers);
+	static void setLane(Node& node, uint32_t lane, const Aabb& bounds);
+	Aabb getNodeBounds(uint32_t node) const;
+	/* returns the lanes not outside any plane, insideMask gets the lanes inside all planes */
+	static uint32_t testNode(const Node& node, const Frustum& frustum, uint32_t& insideMask);
+	void cullNode(uint32_t node, const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const;
+	void appendSubtree(uint32_t node, std::vector<uint32_t>& visibleInstances) const;
+	/* one level down: visible instance lanes go to visibleInstances, visible child nodes become tasks */
+	void expandTask(const CullTask& task, const Frustum& frustum, std::vector<CullTask>& tasks,
+		std::vector<uint32_t>& visibleInstances) const;
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "Frustum.h"
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection) {
+	// Rows of the matrix, glm stores columns
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i) {
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	Frustum frustum;
+	frustum.planes.at(0) = rows[3] + rows[0];
+	frustum.planes.at(1) = rows[3] - rows[0];
+	frustum.planes.at(2) = rows[3] + rows[1];
+	frustum.planes.at(3) = rows[3] - rows[1];
+	// Depth range 0 to 1, the near plane is z >= 0 without the w term
+	frustum.planes.at(4) = rows[2];
+	frustum.planes.at(5) = rows[3] - rows[2];
+	for (glm::vec4& plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f) {
+			plane /= length;
+		}
+	}
+	return frustum;
+}
\ No newline at end of file
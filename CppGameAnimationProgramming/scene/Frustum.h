@@ -0,0 +1,11 @@
+#pragma once
+#include <array>
+#include <glm/glm.hpp>
+
+/* six planes as xyz normal and w distance, normals point inside and are normalized */
+struct Frustum {
+	std::array<glm::vec4, 6> planes;
+
+	/* Vulkan clip space, depth 0 to 1 */
+	static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 460 core
+#extension GL_EXT_nonuniform_qualifier : require
+layout (location = 0) in vec2 texCoord;
+layout (location = 1) flat in uint textureIndex;
+layout (location = 0) out vec4 FragColor;
+// Texture table, every texture of the scene in one set
+layout (set = 0, binding = 0) uniform sampler2D textures[];
+// Constant per pipeline, the test is folded away when disabled
+layout (constant_id = 1) const bool ALPHA_TEST = false;
+layout (constant_id = 2) const float ALPHA_CUTOFF = 0.5;
+void main() {
+	// Instances of one indirect draw call can use different textures
+	vec4 color = texture(textures[nonuniformEXT(textureIndex)], texCoord);
+	if (ALPHA_TEST && color.a < ALPHA_CUTOFF) {
+		discard;
+	}
+	FragColor = color;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 0) out vec2 texCoord;
+layout (location = 1) flat out uint textureIndex;
+struct InstanceData {
+	vec4 positionScale;
+	uint meshIndex;
+	uint textureIndex;
+	uint padding0;
+	uint padding1;
+};
+// Indexed by gl_InstanceIndex, the culling pass writes it as firstInstance
+layout (set = 1, binding = 0) readonly buffer Instances { InstanceData instances[]; };
+layout (push_constant) uniform DrawData {
+	mat4 viewProjection;
+	// Quantized positions arrive as SNORM in [-1, 1] within the mesh bounds
+	vec4 positionDequantization;
+} drawData;
+#ifdef SKINNED
+// Joints per vertex, the loop is unrolled for each specialization
+layout (constant_id = 0) const uint JOINT_INFLUENCES = 4;
+layout (set = 2, binding = 0) readonly buffer JointMatrices { mat4 jointMatrices[]; };
+// Four influences per word, joints as UINT8 and weights as UNORM8
+layout (set = 2, binding = 1) readonly buffer JointIndices { uint jointIndices[]; };
+layout (set = 2, binding = 2) readonly buffer JointWeights { uint jointWeights[]; };
+#endif
+void main() {
+	InstanceData instance = instances[gl_InstanceIndex];
+	vec3 meshPosition = aPos * drawData.positionDequantization.w + drawData.positionDequantization.xyz;
+#ifdef SKINNED
+	mat4 skinMatrix = mat4(0.0);
+	for (uint i = 0; i < JOINT_INFLUENCES; ++i) {
+		uint influence = uint(gl_VertexIndex) * JOINT_INFLUENCES + i;
+		uint shift = (influence & 3u) * 8u;
+		uint joint = bitfieldExtract(jointIndices[influence >> 2], int(shift), 8);
+		float weight = float(bitfieldExtract(jointWeights[influence >> 2], int(shift), 8)) / 255.0;
+		skinMatrix += weight * jointMatrices[joint];
+	}
+	vec3 position = (skinMatrix * vec4(meshPosition, 1.0)).xyz;
+#else
+	vec3 position = meshPosition;
+#endif
+	gl_Position = drawData.viewProjection * vec4(position * instance.positionScale.w + instance.positionScale.xyz, 1.0);
+	texCoord = aTexCoord;
+	textureIndex = instance.textureIndex;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <chrono>
+#include "FileWatcher.h"
+#include "Logger.h"
+#include "Profiler.h"
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// Upper bound for noticing cleanup, and the scan interval of the polling fallback
+	constexpr int WATCH_INTERVAL_MS = 250;
+}
+
+bool FileWatcher::init(std::vector<std::string> directories) {
+	mDirectories = std::move(directories);
+#ifdef __linux__
+	mInotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (mInotifyDescriptor < 0) {
+		LOG(Io, 1, "%s error: inotify is not available\n", __FUNCTION__);
+		return false;
+	}
+	for (const std::string& directory : mDirectories) {
+		// Editors either write in place or rename a temporary file over the original
+		int watch = inotify_add_watch(mInotifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0) {
+			LOG(Io, 1, "%s error: could not watch directory '%s'\n", __FUNCTION__, directory.c_str());
+			continue;
+		}
+		mWatchDirectories[watch] = directory;
+	}
+#else
+	scanDirectories(false);
+#endif
+	mRunning = true;
+	mThread = std::thread(&FileWatcher::watchLoop, this);
+	LOG(Io, 1, "%s: watching %zu directories\n", __FUNCTION__, mDirectories.size());
+	return true;
+}
+
+void FileWatcher::cleanup() {
+	if (!mRunning) {
+		return;
+	}
+	mRunning = false;
+	mThread.join();
+#ifdef __linux__
+	close(mInotifyDescriptor);
+	mInotifyDescriptor = -1;
+	mWatchDirectories.clear();
+#endif
+}
+
+std::vector<std::string> FileWatcher::getChangedFiles() {
+	std::lock_guard<std::mutex> lock(mChangedMutex);
+	std::vector<std::string> changedFiles(mChangedFiles.begin(), mChangedFiles.end());
+	mChangedFiles.clear();
+	return changedFiles;
+}
+
+void FileWatcher::addChangedFile(std::string fileName) {
+	LOG(Io, 2, "%s: '%s' changed\n", __FUNCTION__, fileName.c_str());
+	std::lock_guard<std::mutex> lock(mChangedMutex);
+	mChangedFiles.insert(std::move(fileName));
+}
+
+#ifdef __linux__
+void FileWatcher::watchLoop() {
+	if (Profiler::isEnabled()) {
+		Profiler::setThreadName("file watcher");
+	}
+	alignas(inotify_event) char buffer[4096];
+	while (mRunning) {
+		pollfd descriptor{ mInotifyDescriptor, POLLIN, 0 };
+		if (poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0) {
+			continue;
+		}
+		ssize_t length = read(mInotifyDescriptor, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length; ) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			auto directory = mWatchDirectories.find(event->wd);
+			if (event->len > 0 && directory != mWatchDirectories.end()) {
+				addChangedFile(directory->second + "/" + event->name);
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+#else
+void FileWatcher::watchLoop() {
+	if (Profiler::isEnabled()) {
+		Profiler::setThreadName("file watcher");
+	}
+	while (mRunning) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+		scanDirectories(true);
+	}
+}
+
+void FileWatcher::scanDirectories(bool reportChanges) {
+	for (const std::string& directory : mDirectories) {
+		std::error_code error;
+		for (std::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error)) {
+			if (!entry->is_regular_file(error)) {
+				continue;
+			}
+			std::filesystem::file_time_type writeTime = entry->last_write_time(error);
+			std::string fileName = directory + "/" + entry->path().filename().string();
+			auto known = mWriteTimes.find(fileName);
+			if (known == mWriteTimes.end() || known->second != writeTime) {
+				mWriteTimes[fileName] = writeTime;
+				if (reportChanges) {
+					addChangedFile(fileName);
+				}
+			}
+		}
+	}
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef __linux__
+#include <filesystem>
+#endif
+
+/* reports files written inside a set of directories, watched on a background thread (inotify on Linux, polling elsewhere) */
+class FileWatcher {
+public:
+	/* only files directly inside the directories are watched, not subdirectories */
+	bool init(std::vector<std::string> directories);
+	void cleanup();
+	/* files written since the last call as "directory/name", each reported once */
+	std::vector<std::string> getChangedFiles();
+
+private:
+	std::vector<std::string> mDirectories;
+	std::thread mThread;
+	std::atomic<bool> mRunning{ false };
+	std::mutex mChangedMutex;
+	std::set<std::string> mChangedFiles;
+
+#ifdef __linux__
+	int mInotifyDescriptor = -1;
+	std::map<int, std::string> mWatchDirectories;
+#else
+	std::map<std::string, std::filesystem::file_time_type> mWriteTimes;
+	void scanDirectories(bool reportChanges);
+#endif
+	void watchLoop();
+	void addChangedFile(std::string fileName);
+};
\ No newline at end of file
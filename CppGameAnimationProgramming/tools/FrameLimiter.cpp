@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "FrameLimiter.h"
+#include "Profiler.h"
+
+void FrameLimiter::setTargetFrameTime(uint64_t frameTime) {
+	mTargetFrameTime = frameTime;
+	mNextDeadline = 0;
+}
+
+uint64_t FrameLimiter::getTargetFrameTime() const {
+	return mTargetFrameTime;
+}
+
+void FrameLimiter::waitForFrameStart() {
+	if (mTargetFrameTime == 0) {
+		return;
+	}
+	PROFILE_ZONE("frameLimiter");
+	uint64_t now = Profiler::now();
+	// First frame or a missed deadline, restart the cadence from here
+	if (mNextDeadline == 0 || now > mNextDeadline) {
+		mNextDeadline = now + mTargetFrameTime;
+	}
+	uint64_t workTime = std::min(predictWorkTime() + SAFETY_MARGIN, mTargetFrameTime);
+	uint64_t wakeTime = mNextDeadline - workTime;
+	while ((now = Profiler::now()) < wakeTime) {
+		if (wakeTime - now > SPIN_TIME) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds(wakeTime - now - SPIN_TIME));
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void FrameLimiter::frameDone(uint64_t workTime, uint64_t blockedTime) {
+	// The time spent blocked is not part of the work, it only means the limiter woke up too early
+	mWorkTimes.at(mWorkIndex) = workTime > blockedTime ? workTime - blockedTime : 0;
+	mWorkIndex = (mWorkIndex + 1) % WORK_HISTORY;
+	if (mTargetFrameTime == 0 || mNextDeadline == 0) {
+		return;
+	}
+	// Blocking shifts the cadence towards the point the presentation engine releases images
+	mNextDeadline += mTargetFrameTime + std::min(blockedTime, mTargetFrameTime / 2);
+}
+
+uint64_t FrameLimiter::predictWorkTime() const {
+	// The slowest recent frame, a single late frame costs a whole refresh interval
+	return *std::max_element(mWorkTimes.begin(), mWorkTimes.end());
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/* paces frames so their work ends just before the next present deadline instead of queueing up */
+class FrameLimiter {
+public:
+	/* nanoseconds between two presents, 0 disables the limiter */
+	void setTargetFrameTime(uint64_t frameTime);
+	uint64_t getTargetFrameTime() const;
+	/* sleeps until the predicted frame work still fits before the deadline, sample input right after */
+	void waitForFrameStart();
+	/* workTime: frame start to present, blockedTime: part of it spent waiting for the GPU or the swapchain */
+	void frameDone(uint64_t workTime, uint64_t blockedTime);
+
+private:
+	static constexpr size_t WORK_HISTORY = 16;
+	// Sleeps are coarse, the last part before the wake up time is spent yielding
+	static constexpr uint64_t SPIN_TIME = 2000000;
+	static constexpr uint64_t SAFETY_MARGIN = 500000;
+
+	uint64_t mTargetFrameTime = 0;
+	uint64_t mNextDeadline = 0;
+	std::array<uint64_t, WORK_HISTORY> mWorkTimes{};
+	size_t mWorkIndex = 0;
+
+	uint64_t predictWorkTime() const;
+};
\ No newline at end of file
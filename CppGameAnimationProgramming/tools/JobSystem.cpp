@@ -0,0 +1,140 @@
+#include <chrono>
+#include <string>
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+std::vector<std::thread> JobSystem::mWorkers;
+std::deque<JobSystem::Job> JobSystem::mJobs;
+std::mutex JobSystem::mJobMutex;
+std::condition_variable JobSystem::mJobCondition;
+bool JobSystem::mRunning = false;
+
+namespace {
+	thread_local unsigned int currentThreadIndex = 0;
+}
+
+void JobSystem::init(unsigned int threadCount) {
+	if (!mWorkers.empty()) {
+		return;
+	}
+	if (threadCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mJobMutex);
+		mRunning = true;
+	}
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		mWorkers.emplace_back(&JobSystem::workerLoop, i + 1);
+	}
+	LOG(General, 1, "%s: started %u worker threads\n", __FUNCTION__, threadCount);
+}
+
+void JobSystem::cleanup() {
+	{
+		std::lock_guard<std::mutex> lock(mJobMutex);
+		mRunning = false;
+	}
+	mJobCondition.notify_all();
+	for (auto& worker : mWorkers) {
+		worker.join();
+	}
+	mWorkers.clear();
+	// Jobs submitted during shutdown still have to run
+	while (runOneJob(nullptr)) {
+	}
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter* counter) {
+	if (counter) {
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	std::function<void()> wrappedJob = [job = std::move(job), counter]() {
+		job();
+		if (counter) {
+			counter->pending.fetch_sub(1, std::memory_order_release);
+		}
+	};
+
+	std::unique_lock<std::mutex> lock(mJobMutex);
+	if (!mRunning) {
+		lock.unlock();
+		wrappedJob();
+		return;
+	}
+	mJobs.push_back({ std::move(wrappedJob), counter });
+	lock.unlock();
+	mJobCondition.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	// Helping with foreign jobs could pull a long shader compile into a frame
+	while (counter.pending.load(std::memory_order_acquire) > 0) {
+		if (!runOneJob(&counter)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t batchSize, std::function<void(size_t begin, size_t end)> job) {
+	if (batchSize == 0) {
+		batchSize = 1;
+	}
+	JobCounter counter;
+	for (size_t begin = 0; begin < count; begin += batchSize) {
+		size_t end = begin + batchSize < count ? begin + batchSize : count;
+		submit([&job, begin, end]() { job(begin, end); }, &counter);
+	}
+	wait(counter);
+}
+
+unsigned int JobSystem::getThreadCount() {
+	return static_cast<unsigned int>(mWorkers.size());
+}
+
+unsigned int JobSystem::getCurrentThreadIndex() {
+	return currentThreadIndex;
+}
+
+bool JobSystem::runOneJob(const JobCounter* counter) {
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(mJobMutex);
+		auto jobIter = mJobs.begin();
+		if (counter) {
+			while (jobIter != mJobs.end() && jobIter->counter != counter) {
+				++jobIter;
+			}
+		}
+		if (jobIter == mJobs.end()) {
+			return false;
+		}
+		job = std::move(jobIter->func);
+		mJobs.erase(jobIter);
+	}
+	job();
+	return true;
+}
+
+void JobSystem::workerLoop(unsigned int threadIndex) {
+	currentThreadIndex = threadIndex;
+	// Naming allocates the event buffer, skip it when nothing is recorded
+	if (Profiler::isEnabled()) {
+		Profiler::setThreadName("worker " + std::to_string(threadIndex));
+	}
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mJobMutex);
+			mJobCondition.wait(lock, [] { return !mJobs.empty() || !mRunning; });
+			if (mJobs.empty()) {
+				return;
+			}
+			job = std::move(mJobs.front().func);
+			mJobs.pop_front();
+		}
+		job();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* counts unfinished jobs of a group, JobSystem::wait() blocks until it drops to zero */
+struct JobCounter {
+	std::atomic<int> pending{ 0 };
+};
+
+/* fixed pool of worker threads, without init() all jobs run inline on the caller */
+class JobSystem {
+public:
+	/* threadCount 0 uses one worker per hardware thread minus the calling thread */
+	static void init(unsigned int threadCount = 0);
+	static void cleanup();
+
+	static void submit(std::function<void()> job, JobCounter* counter = nullptr);
+	/* executes queued jobs of the same counter while waiting, safe to call from a worker */
+	static void wait(JobCounter& counter);
+	/* splits [0, count) into batches and waits for all of them */
+	static void parallelFor(size_t count, size_t batchSize, std::function<void(size_t begin, size_t end)> job);
+
+	static unsigned int getThreadCount();
+	/* 0 for threads outside the pool, 1..getThreadCount() for workers */
+	static unsigned int getCurrentThreadIndex();
+
+private:
+	struct Job {
+		std::function<void()> func;
+		const JobCounter* counter = nullptr;
+	};
+
+	static std::vector<std::thread> mWorkers;
+	static std::deque<Job> mJobs;
+	static std::mutex mJobMutex;
+	static std::condition_variable mJobCondition;
+	static bool mRunning;
+
+	static void workerLoop(unsigned int threadIndex);
+	/* nullptr takes any job, otherwise only jobs submitted with that counter */
+	static bool runOneJob(const JobCounter* counter);
+};
@@ -1,3 +1,187 @@
+#include <csignal>
+#include <cstdlib>
+#ifdef _WIN32
+#include <io.h>
+#define LOGGER_RAW_WRITE _write
+#else
+#include <unistd.h>
+#define LOGGER_RAW_WRITE write
+#endif
 #include "Logger.h"
 
-unsigned int Logger::mLogLevel = 1;
\ No newline at end of file
+std::atomic<unsigned int> Logger::mLogLevels[static_cast<unsigned int>(LogChannel::Count)] = { 1, 1, 1, 1, 1, 1 };
+std::atomic<bool> Logger::mAsync{ false };
+std::atomic<bool> Logger::mRunning{ false };
+std::atomic_flag Logger::mDraining = ATOMIC_FLAG_INIT;
+std::thread Logger::mWriterThread;
+std::atomic<bool> Logger::mWriterWaiting{ false };
+std::mutex Logger::mWakeMutex;
+std::condition_variable Logger::mWakeCondition;
+std::atomic<LogRingBuffer*> Logger::mRingList[Logger::MAX_RINGS];
+std::atomic<size_t> Logger::mRingCount{ 0 };
+std::mutex Logger::mRingMutex;
+std::vector<std::unique_ptr<LogRingBuffer>> Logger::mRings;
+std::vector<LogRingBuffer*> Logger::mFreeRings;
+
+namespace {
+	// Long enough for any slot, the string arguments are limited by the slot size
+	constexpr size_t LINE_SIZE = 1024;
+	constexpr int STDOUT_FD = 1;
+
+	void writeLine(const char* line, int length, bool fromSignal) {
+		if (length <= 0) {
+			return;
+		}
+		// snprintf returns the untruncated length
+		size_t size = static_cast<size_t>(length) < LINE_SIZE ? static_cast<size_t>(length) : LINE_SIZE - 1;
+		if (fromSignal) {
+			// stdio may hold its lock in the interrupted code
+			[[maybe_unused]] auto result = LOGGER_RAW_WRITE(STDOUT_FD, line, static_cast<unsigned int>(size));
+		} else {
+			std::fwrite(line, 1, size, stdout);
+		}
+	}
+}
+
+void Logger::init() {
+	if (mRunning.exchange(true)) {
+		return;
+	}
+	mWriterThread = std::thread(&Logger::writerLoop);
+	mAsync.store(true, std::memory_order_release);
+
+	// Queued messages must reach stdout on exit and on crash
+	std::atexit(&Logger::cleanup);
+	std::signal(SIGSEGV, &Logger::signalHandler);
+	std::signal(SIGABRT, &Logger::signalHandler);
+	std::signal(SIGFPE, &Logger::signalHandler);
+	std::signal(SIGILL, &Logger::signalHandler);
+}
+
+void Logger::cleanup() {
+	if (!mRunning.exchange(false)) {
+		return;
+	}
+	// Taking the mutex once orders the flag before a waiting writer checks it again
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+	}
+	mWakeCondition.notify_one();
+	mWriterThread.join();
+	// Late messages from other threads go out directly
+	mAsync.store(false, std::memory_order_release);
+	flush();
+}
+
+void Logger::flush() {
+	while (drain(false) > 0) {
+	}
+}
+
+LogRingBuffer* Logger::getThreadRing() {
+	// Returns the ring to the free list when the thread exits, queued messages are still drained
+	struct ThreadRing {
+		LogRingBuffer* ring = nullptr;
+		~ThreadRing() {
+			if (ring) {
+				std::lock_guard<std::mutex> lock(mRingMutex);
+				mFreeRings.push_back(ring);
+			}
+		}
+	};
+	thread_local ThreadRing threadRing;
+	if (threadRing.ring) {
+		return threadRing.ring;
+	}
+
+	std::lock_guard<std::mutex> lock(mRingMutex);
+	// The mutex orders the old owner's last head store before this thread's first one
+	if (!mFreeRings.empty()) {
+		threadRing.ring = mFreeRings.back();
+		mFreeRings.pop_back();
+		return threadRing.ring;
+	}
+	if (mRings.size() == MAX_RINGS) {
+		return nullptr;
+	}
+	mRings.emplace_back(std::make_unique<LogRingBuffer>());
+	threadRing.ring = mRings.back().get();
+	mRingList[mRings.size() - 1].store(threadRing.ring, std::memory_order_release);
+	mRingCount.store(mRings.size(), std::memory_order_release);
+	return threadRing.ring;
+}
+
+void Logger::wakeWriter() {
+	std::lock_guard<std::mutex> lock(mWakeMutex);
+	mWakeCondition.notify_one();
+}
+
+bool Logger::hasQueuedMessages() {
+	size_t ringCount = mRingCount.load(std::memory_order_acquire);
+	for (size_t i = 0; i < ringCount; ++i) {
+		LogRingBuffer* ring = mRingList[i].load(std::memory_order_acquire);
+		if (ring->head.load(std::memory_order_acquire) != ring->tail.load(std::memory_order_relaxed) ||
+			ring->dropped.load(std::memory_order_relaxed) > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void Logger::writerLoop() {
+	while (mRunning.load(std::memory_order_acquire)) {
+		if (drain(false) > 0) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(mWakeMutex);
+		mWriterWaiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		mWakeCondition.wait(lock, [] { return hasQueuedMessages() || !mRunning.load(std::memory_order_acquire); });
+		mWriterWaiting.store(false, std::memory_order_relaxed);
+	}
+	drain(false);
+}
+
+size_t Logger::drain(bool fromSignal) {
+	// Only one consumer per ring; the signal handler must not wait forever on a crashed writer
+	unsigned int spins = 0;
+	while (mDraining.test_and_set(std::memory_order_acquire)) {
+		if (fromSignal && ++spins > 100000) {
+			return 0;
+		}
+		std::this_thread::yield();
+	}
+
+	// The ring list only grows, no lock needed to walk it
+	size_t written = 0;
+	char line[LINE_SIZE];
+	size_t ringCount = mRingCount.load(std::memory_order_acquire);
+	for (size_t i = 0; i < ringCount; ++i) {
+		LogRingBuffer* ring = mRingList[i].load(std::memory_order_acquire);
+		size_t tail = ring->tail.load(std::memory_order_relaxed);
+		size_t head = ring->head.load(std::memory_order_acquire);
+		for (; tail != head; ++tail) {
+			const LogSlot& slot = ring->slots[tail % LogRingBuffer::SLOT_COUNT];
+			writeLine(line, slot.print(slot, line, sizeof(line)), fromSignal);
+			++written;
+		}
+		ring->tail.store(tail, std::memory_order_release);
+
+		unsigned int dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped > 0) {
+			writeLine(line, std::snprintf(line, sizeof(line), "%s: dropped %u messages, log buffer full\n", __FUNCTION__, dropped), fromSignal);
+		}
+	}
+
+	if (written > 0 && !fromSignal) {
+		std::fflush(stdout);
+	}
+	mDraining.clear(std::memory_order_release);
+	return written;
+}
+
+void Logger::signalHandler(int signal) {
+	drain(true);
+	std::signal(signal, SIG_DFL);
+	std::raise(signal);
+}
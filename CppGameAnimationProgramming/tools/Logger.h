@@ -1,20 +1,250 @@
 #pragma once
 #include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+/* never executed, only lets the compiler check the arguments against the format
+ * MSVC has no format attribute but checks the arguments of CRT printf calls (C4477) */
+#ifdef _MSC_VER
+#define LOGGER_CHECK_FORMAT(...) std::printf(__VA_ARGS__)
+#else
+#define LOGGER_CHECK_FORMAT(...) Logger::checkFormat(__VA_ARGS__)
+#endif
+
+/* compile-time thresholds, messages with a higher level are removed by the LOG macro */
+#ifndef LOGGER_MAX_LEVEL
+#ifdef NDEBUG
+#define LOGGER_MAX_LEVEL 4
+#else
+#define LOGGER_MAX_LEVEL 9
+#endif
+#endif
+#ifndef LOGGER_MAX_LEVEL_GENERAL
+#define LOGGER_MAX_LEVEL_GENERAL LOGGER_MAX_LEVEL
+#endif
+#ifndef LOGGER_MAX_LEVEL_RENDERER
+#define LOGGER_MAX_LEVEL_RENDERER LOGGER_MAX_LEVEL
+#endif
+#ifndef LOGGER_MAX_LEVEL_VULKAN
+#define LOGGER_MAX_LEVEL_VULKAN LOGGER_MAX_LEVEL
+#endif
+#ifndef LOGGER_MAX_LEVEL_MODEL
+#define LOGGER_MAX_LEVEL_MODEL LOGGER_MAX_LEVEL
+#endif
+#ifndef LOGGER_MAX_LEVEL_ANIMATION
+#define LOGGER_MAX_LEVEL_ANIMATION LOGGER_MAX_LEVEL
+#endif
+#ifndef LOGGER_MAX_LEVEL_IO
+#define LOGGER_MAX_LEVEL_IO LOGGER_MAX_LEVEL
+#endif
+
+/* LOG(Vulkan, 1, "%s error: ...\n", __FUNCTION__)
+ * the format string is checked by the compiler, arguments are only evaluated if the
+ * message passes both the compile-time and the run-time level of the channel */
+#define LOG(channel, level, ...) \
+	do { \
+		if constexpr (false) { \
+			LOGGER_CHECK_FORMAT(__VA_ARGS__); \
+		} \
+		if constexpr (Logger::isCompiledIn(LogChannel::channel, level)) { \
+			if (Logger::isEnabled(LogChannel::channel, level)) { \
+				Logger::log(LogChannel::channel, level, __VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+enum class LogChannel : unsigned int {
+	General = 0,
+	Renderer,
+	Vulkan,
+	Model,
+	Animation,
+	Io,
+	Count
+};
+
+/* one message: format pointer plus a copy of the arguments, formatted later by the writer thread */
+struct LogSlot {
+	int (*print)(const LogSlot& slot, char* buffer, size_t size) = nullptr;
+	const char* format = nullptr;
+	unsigned char data[240];
+};
+
+/* single producer (the logging thread) / single consumer (the writer thread) ring */
+struct LogRingBuffer {
+	static constexpr size_t SLOT_COUNT = 1024;
+	LogSlot slots[SLOT_COUNT];
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	std::atomic<unsigned int> dropped{ 0 };
+};
 
 class Logger {
 public:
-	/* log if input log level is equal or smaller to log level set*/
+	/* log if input log level is equal or smaller to log level set for the channel */
 	template<typename... Args>
-	static void log(unsigned int logLevel, Args... args) {
-		if (logLevel <= mLogLevel) {
-			std::printf(args...);
+	static void log(LogChannel channel, unsigned int logLevel, const char* format, Args... args) {
+		if (!isEnabled(channel, logLevel)) {
+			return;
+		}
+		if (!mAsync.load(std::memory_order_acquire)) {
+			std::printf(format, args...);
 			std::fflush(stdout);
+			return;
 		}
+		static_assert(fixedArgSize<Args...>() <= sizeof(LogSlot::data), "too many arguments for one log message");
+
+		LogRingBuffer* ring = getThreadRing();
+		// More live threads than ring slots, this one logs directly
+		if (!ring) {
+			std::printf(format, args...);
+			std::fflush(stdout);
+			return;
+		}
+		size_t head = ring->head.load(std::memory_order_relaxed);
+		// Ring full: drop the message instead of blocking the caller
+		if (head - ring->tail.load(std::memory_order_acquire) == LogRingBuffer::SLOT_COUNT) {
+			ring->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		LogSlot& slot = ring->slots[head % LogRingBuffer::SLOT_COUNT];
+		slot.print = &printSlot<Args...>;
+		slot.format = format;
+		[[maybe_unused]] size_t offset = 0;
+		[[maybe_unused]] size_t stringBudget = sizeof(slot.data) - fixedArgSize<Args...>();
+		(encodeArg(slot, offset, stringBudget, args), ...);
+		ring->head.store(head + 1, std::memory_order_release);
+		// Pairs with the fence in writerLoop: either the writer sees the message or this sees it waiting
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (mWriterWaiting.load(std::memory_order_relaxed)) {
+			wakeWriter();
+		}
+	}
+
+	static constexpr bool isCompiledIn(LogChannel channel, unsigned int logLevel) {
+		return logLevel <= mCompiledLogLevels[static_cast<unsigned int>(channel)];
+	}
+
+	static bool isEnabled(LogChannel channel, unsigned int logLevel) {
+		return logLevel <= mLogLevels[static_cast<unsigned int>(channel)].load(std::memory_order_relaxed);
 	}
 
+	/* set the run-time level of all channels */
 	static void setLogLevel(unsigned int inLogLevel) {
-		inLogLevel <= 9 ? mLogLevel = inLogLevel : mLogLevel = 9;
+		for (unsigned int i = 0; i < static_cast<unsigned int>(LogChannel::Count); ++i) {
+			setLogLevel(static_cast<LogChannel>(i), inLogLevel);
+		}
 	}
+
+	static void setLogLevel(LogChannel channel, unsigned int inLogLevel) {
+		mLogLevels[static_cast<unsigned int>(channel)].store(inLogLevel <= 9 ? inLogLevel : 9, std::memory_order_relaxed);
+	}
+
+#ifndef _MSC_VER
+	/* never called, target of LOGGER_CHECK_FORMAT */
+	__attribute__((format(printf, 1, 2))) static void checkFormat(const char*, ...) {}
+#endif
+
+	/* start the background writer, messages are queued from now on */
+	static void init();
+	/* write all queued messages and stop the background writer */
+	static void cleanup();
+	/* write all queued messages from the calling thread */
+	static void flush();
+
 private:
-	static unsigned int mLogLevel;
+	static constexpr unsigned int mCompiledLogLevels[] = {
+		LOGGER_MAX_LEVEL_GENERAL,
+		LOGGER_MAX_LEVEL_RENDERER,
+		LOGGER_MAX_LEVEL_VULKAN,
+		LOGGER_MAX_LEVEL_MODEL,
+		LOGGER_MAX_LEVEL_ANIMATION,
+		LOGGER_MAX_LEVEL_IO
+	};
+	// Read by every logging thread, may be changed while they run
+	static std::atomic<unsigned int> mLogLevels[static_cast<unsigned int>(LogChannel::Count)];
+	static std::atomic<bool> mAsync;
+	static std::atomic<bool> mRunning;
+	static std::atomic_flag mDraining;
+	static std::thread mWriterThread;
+	static std::atomic<bool> mWriterWaiting;
+	static std::mutex mWakeMutex;
+	static std::condition_variable mWakeCondition;
+
+	// Live threads with a ring at the same time, the signal handler reads the list without locking
+	static constexpr size_t MAX_RINGS = 256;
+	static std::atomic<LogRingBuffer*> mRingList[MAX_RINGS];
+	static std::atomic<size_t> mRingCount;
+	static std::mutex mRingMutex;
+	static std::vector<std::unique_ptr<LogRingBuffer>> mRings;
+	// Rings of exited threads, handed to the next new thread
+	static std::vector<LogRingBuffer*> mFreeRings;
+
+	static LogRingBuffer* getThreadRing();
+	static void wakeWriter();
+	static bool hasQueuedMessages();
+	static void writerLoop();
+	static size_t drain(bool fromSignal);
+	static void signalHandler(int signal);
+
+	/* C strings are copied into the slot, everything else is copied by value */
+	template<typename T>
+	static constexpr bool isString() {
+		return std::is_same<std::decay_t<T>, const char*>::value || std::is_same<std::decay_t<T>, char*>::value;
+	}
+
+	template<typename... Args>
+	static constexpr size_t fixedArgSize() {
+		// strings need at least their terminating zero
+		return (size_t{ 0 } + ... + (isString<Args>() ? 1 : sizeof(std::decay_t<Args>)));
+	}
+
+	template<typename T>
+	static void encodeArg(LogSlot& slot, size_t& offset, size_t& stringBudget, const T& arg) {
+		if constexpr (isString<T>()) {
+			const char* str = arg ? arg : "(null)";
+			size_t length = std::strlen(str);
+			if (length > stringBudget) {
+				length = stringBudget;
+			}
+			stringBudget -= length;
+			std::memcpy(slot.data + offset, str, length);
+			slot.data[offset + length] = '\0';
+			offset += length + 1;
+		} else {
+			static_assert(std::is_trivially_copyable<T>::value, "log arguments must be trivially copyable");
+			std::memcpy(slot.data + offset, &arg, sizeof(T));
+			offset += sizeof(T);
+		}
+	}
+
+	template<typename T>
+	static auto decodeArg(const LogSlot& slot, size_t& offset) {
+		if constexpr (isString<T>()) {
+			const char* str = reinterpret_cast<const char*>(slot.data + offset);
+			offset += std::strlen(str) + 1;
+			return str;
+		} else {
+			std::decay_t<T> value;
+			std::memcpy(&value, slot.data + offset, sizeof(value));
+			offset += sizeof(value);
+			return value;
+		}
+	}
+
+	template<typename... Args>
+	static int printSlot(const LogSlot& slot, char* buffer, size_t size) {
+		[[maybe_unused]] size_t offset = 0;
+		// braced init keeps the left-to-right decode order
+		std::tuple<decltype(decodeArg<Args>(slot, offset))...> values{ decodeArg<Args>(slot, offset)... };
+		return std::apply([&](auto... values) { return std::snprintf(buffer, size, slot.format, values...); }, values);
+	}
 };
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include "PngWriter.h"
+#include "Logger.h"
+
+namespace {
+	uint32_t crc32(const unsigned char* data, size_t length, uint32_t crc = 0) {
+		static const std::array<uint32_t, 256> table = [] {
+			std::array<uint32_t, 256> values{};
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; ++bit) {
+					value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+				}
+				values[i] = value;
+			}
+			return values;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < length; ++i) {
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	void appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+		out.push_back(static_cast<unsigned char>(value >> 24));
+		out.push_back(static_cast<unsigned char>(value >> 16));
+		out.push_back(static_cast<unsigned char>(value >> 8));
+		out.push_back(static_cast<unsigned char>(value));
+	}
+
+	void appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+		appendBigEndian(out, static_cast<uint32_t>(data.size()));
+		size_t typeStart = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		// CRC covers type and data
+		appendBigEndian(out, crc32(out.data() + typeStart, out.size() - typeStart));
+	}
+}
+
+bool PngWriter::write(std::string fileName, uint32_t width, uint32_t height, const std::vector<unsigned char>& rgbaPixels) {
+	size_t rowSize = static_cast<size_t>(width) * 4;
+	if (width == 0 || height == 0 || rgbaPixels.size() < rowSize * height) {
+		LOG(Io, 1, "%s error: invalid image size %ux%u for '%s'\n", __FUNCTION__, width, height, fileName.c_str());
+		return false;
+	}
+
+	// Scanlines with filter type 0 in front of every row
+	std::vector<unsigned char> scanlines;
+	scanlines.reserve((rowSize + 1) * height);
+	for (uint32_t y = 0; y < height; ++y) {
+		scanlines.push_back(0);
+		scanlines.insert(scanlines.end(), rgbaPixels.begin() + y * rowSize, rgbaPixels.begin() + (y + 1) * rowSize);
+	}
+
+	// zlib stream of stored deflate blocks, at most 65535 bytes each
+	std::vector<unsigned char> zlibData = { 0x78, 0x01 };
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+	for (unsigned char value : scanlines) {
+		adlerA = (adlerA + value) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	size_t offset = 0;
+	do {
+		size_t blockSize = std::min<size_t>(scanlines.size() - offset, 65535);
+		bool lastBlock = offset + blockSize == scanlines.size();
+		zlibData.push_back(lastBlock ? 1 : 0);
+		zlibData.push_back(static_cast<unsigned char>(blockSize));
+		zlibData.push_back(static_cast<unsigned char>(blockSize >> 8));
+		zlibData.push_back(static_cast<unsigned char>(~blockSize));
+		zlibData.push_back(static_cast<unsigned char>(~blockSize >> 8));
+		zlibData.insert(zlibData.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < scanlines.size());
+	appendBigEndian(zlibData, (adlerB << 16) | adlerA);
+
+	// Header: 8 bit RGBA, no interlacing
+	std::vector<unsigned char> header;
+	appendBigEndian(header, width);
+	appendBigEndian(header, height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+	std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	appendChunk(png, "IHDR", header);
+	appendChunk(png, "IDAT", zlibData);
+	appendChunk(png, "IEND", {});
+
+	std::ofstream outFile(fileName, std::ios::binary | std::ios::trunc);
+	if (!outFile.is_open()) {
+		LOG(Io, 1, "%s error: could not open file '%s'\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+	outFile.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+	outFile.close();
+	if (outFile.fail()) {
+		LOG(Io, 1, "%s error: could not write file '%s'\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+	LOG(Io, 1, "%s: wrote %ux%u image to '%s'\n", __FUNCTION__, width, height, fileName.c_str());
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* minimal PNG encoder for RGBA8 images, uses uncompressed deflate blocks */
+class PngWriter {
+public:
+	static bool write(std::string fileName, uint32_t width, uint32_t height, const std::vector<unsigned char>& rgbaPixels);
+};
\ No newline at end of file
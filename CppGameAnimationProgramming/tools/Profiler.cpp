@@ -0,0 +1,124 @@
+#include <fstream>
+#include <cinttypes>
+#include "Profiler.h"
+#include "Logger.h"
+
+std::atomic<bool> Profiler::mEnabled{ false };
+std::atomic<uint32_t> Profiler::mFrameNumber{ 0 };
+const std::chrono::steady_clock::time_point Profiler::mEpoch = std::chrono::steady_clock::now();
+std::mutex Profiler::mBufferMutex;
+std::vector<std::unique_ptr<ProfileThreadBuffer>> Profiler::mBuffers;
+ProfileThreadBuffer* Profiler::mGpuBuffer = nullptr;
+
+namespace {
+	std::string escapeJson(const char* text) {
+		std::string escaped;
+		for (const char* c = text; *c != '\0'; ++c) {
+			if (*c == '"' || *c == '\\') {
+				escaped += '\\';
+			}
+			escaped += *c;
+		}
+		return escaped;
+	}
+
+	void writeTimestamp(std::ofstream& outFile, const char* key, uint64_t nanoseconds) {
+		// Chrome trace timestamps are microseconds
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "\"%s\":%" PRIu64 ".%03" PRIu64, key, nanoseconds / 1000, nanoseconds % 1000);
+		outFile << buffer;
+	}
+}
+
+ProfileThreadBuffer* Profiler::createBuffer(std::string threadName) {
+	std::lock_guard<std::mutex> lock(mBufferMutex);
+	mBuffers.emplace_back(std::make_unique<ProfileThreadBuffer>());
+	ProfileThreadBuffer* buffer = mBuffers.back().get();
+	buffer->threadId = static_cast<uint32_t>(mBuffers.size());
+	buffer->threadName = threadName;
+	return buffer;
+}
+
+ProfileThreadBuffer* Profiler::getThreadBuffer() {
+	thread_local ProfileThreadBuffer* buffer = nullptr;
+	if (!buffer) {
+		buffer = createBuffer(std::string());
+	}
+	return buffer;
+}
+
+void Profiler::addGpuEvent(const char* name, uint64_t start, uint64_t end) {
+	if (!isEnabled()) {
+		return;
+	}
+	// Only the render thread reads back GPU queries
+	if (!mGpuBuffer) {
+		mGpuBuffer = createBuffer("GPU");
+	}
+	pushEvent(mGpuBuffer, { name, start, end, ProfileEventType::Zone, 0 });
+}
+
+void Profiler::frameMark() {
+	if (!isEnabled()) {
+		return;
+	}
+	uint64_t timestamp = now();
+	addEvent("Frame", timestamp, timestamp, ProfileEventType::Frame, mFrameNumber.fetch_add(1, std::memory_order_relaxed));
+}
+
+void Profiler::setThreadName(std::string name) {
+	ProfileThreadBuffer* buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(mBufferMutex);
+	buffer->threadName = name;
+}
+
+bool Profiler::writeChromeTrace(std::string fileName) {
+	std::ofstream outFile(fileName);
+	if (!outFile.is_open()) {
+		LOG(Io, 1, "%s error: could not open trace file '%s'\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+
+	size_t eventCount = 0;
+	bool first = true;
+	outFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	std::lock_guard<std::mutex> lock(mBufferMutex);
+	for (const auto& buffer : mBuffers) {
+		if (!buffer->threadName.empty()) {
+			outFile << (first ? "" : ",\n");
+			outFile << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"args\":{\"name\":\"" << escapeJson(buffer->threadName.c_str()) << "\"}}";
+			first = false;
+		}
+
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; ++i) {
+			const ProfileEvent& event = buffer->events[i];
+			outFile << (first ? "" : ",\n");
+			first = false;
+			outFile << "{\"name\":\"" << escapeJson(event.name) << "\",\"pid\":1,\"tid\":" << buffer->threadId << ",";
+			writeTimestamp(outFile, "ts", event.start);
+			switch (event.type) {
+			case ProfileEventType::Frame:
+				outFile << ",\"ph\":\"i\",\"s\":\"g\",\"args\":{\"frame\":" << event.value << "}}";
+				break;
+			default:
+				outFile << ",\"ph\":\"X\",\"cat\":\"" << (buffer.get() == mGpuBuffer ? "gpu" : "cpu") << "\",";
+				writeTimestamp(outFile, "dur", event.end - event.start);
+				outFile << "}";
+				break;
+			}
+		}
+		eventCount += count;
+
+		size_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+		if (dropped > 0) {
+			LOG(General, 1, "%s: thread %u dropped %zu events, buffer full\n", __FUNCTION__, buffer->threadId, dropped);
+		}
+	}
+	outFile << "\n]}\n";
+	outFile.close();
+
+	LOG(General, 1, "%s: wrote %zu events to '%s'\n", __FUNCTION__, eventCount, fileName.c_str());
+	return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+/* zone names must outlive the profiler, use string literals or __FUNCTION__ */
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_FRAME() Profiler::frameMark()
+#else
+#define PROFILE_ZONE(name) do {} while (0)
+#define PROFILE_FUNCTION() do {} while (0)
+#define PROFILE_FRAME() do {} while (0)
+#endif
+
+enum class ProfileEventType : uint32_t {
+	Zone = 0,
+	Frame
+};
+
+struct ProfileEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	ProfileEventType type;
+	uint32_t value;
+};
+
+/* written only by the owning thread, read by the exporter up to 'count' */
+struct ProfileThreadBuffer {
+	static constexpr size_t EVENT_COUNT = 1 << 18;
+	std::unique_ptr<ProfileEvent[]> events = std::make_unique<ProfileEvent[]>(EVENT_COUNT);
+	std::atomic<size_t> count{ 0 };
+	std::atomic<size_t> dropped{ 0 };
+	uint32_t threadId = 0;
+	std::string threadName;
+};
+
+class Profiler {
+public:
+	static void setEnabled(bool enabled) {
+		mEnabled.store(enabled, std::memory_order_relaxed);
+	}
+	static bool isEnabled() {
+		return mEnabled.load(std::memory_order_relaxed);
+	}
+
+	/* nanoseconds since the profiler was loaded */
+	static uint64_t now() {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - mEpoch).count());
+	}
+
+	static void addEvent(const char* name, uint64_t start, uint64_t end, ProfileEventType type = ProfileEventType::Zone, uint32_t value = 0) {
+		pushEvent(getThreadBuffer(), { name, start, end, type, value });
+	}
+
+	/* events measured on the GPU, converted to profiler time; written on their own "GPU" track */
+	static void addGpuEvent(const char* name, uint64_t start, uint64_t end);
+	/* marks the start of a new frame on the calling thread */
+	static void frameMark();
+	static void setThreadName(std::string name);
+
+	/* writes all recorded events as Chrome trace / Perfetto JSON */
+	static bool writeChromeTrace(std::string fileName);
+
+private:
+	static std::atomic<bool> mEnabled;
+	static std::atomic<uint32_t> mFrameNumber;
+	static const std::chrono::steady_clock::time_point mEpoch;
+	static std::mutex mBufferMutex;
+	static std::vector<std::unique_ptr<ProfileThreadBuffer>> mBuffers;
+	static ProfileThreadBuffer* mGpuBuffer;
+
+	static ProfileThreadBuffer* getThreadBuffer();
+	static ProfileThreadBuffer* createBuffer(std::string threadName);
+
+	static void pushEvent(ProfileThreadBuffer* buffer, const ProfileEvent& event) {
+		size_t index = buffer->count.load(std::memory_order_relaxed);
+		if (index == ProfileThreadBuffer::EVENT_COUNT) {
+			buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		buffer->events[index] = event;
+		buffer->count.store(index + 1, std::memory_order_release);
+	}
+};
+
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* name) {
+		if (Profiler::isEnabled()) {
+			mName = name;
+			mStart = Profiler::now();
+		}
+	}
+	~ProfileZone() {
+		if (mName) {
+			Profiler::addEvent(mName, mStart, Profiler::now());
+		}
+	}
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+private:
+	const char* mName = nullptr;
+	uint64_t mStart = 0;
+};
@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "TaskGraph.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+void TaskGraph::addTask(const char* name, std::vector<const char*> dependencies, std::function<bool()> task) {
+	std::unique_ptr<Task> newTask = std::make_unique<Task>();
+	newTask->name = name;
+	newTask->function = std::move(task);
+	for (const char* dependency : dependencies) {
+		size_t index = 0;
+		while (index < mTasks.size() && std::strcmp(mTasks.at(index)->name, dependency) != 0) {
+			++index;
+		}
+		// Only earlier tasks can be referenced, so the graph never has a cycle
+		if (index == mTasks.size()) {
+			LOG(General, 1, "%s error: task '%s' depends on unknown task '%s'\n", __FUNCTION__, name, dependency);
+			mInvalid = true;
+			return;
+		}
+		newTask->dependencies.push_back(index);
+		mTasks.at(index)->dependents.push_back(mTasks.size());
+	}
+	mTasks.push_back(std::move(newTask));
+}
+
+bool TaskGraph::run() {
+	PROFILE_FUNCTION();
+	if (mInvalid) {
+		LOG(General, 1, "%s error: task graph is invalid, nothing executed\n", __FUNCTION__);
+		return false;
+	}
+	mFailed = false;
+	mStart = Profiler::now();
+	for (auto& task : mTasks) {
+		task->pendingDependencies = task->dependencies.size();
+		task->executed = false;
+		task->succeeded = false;
+	}
+
+	JobCounter counter;
+	for (size_t i = 0; i < mTasks.size(); ++i) {
+		if (mTasks.at(i)->dependencies.empty()) {
+			schedule(i, counter);
+		}
+	}
+	// The calling thread runs tasks too while waiting
+	JobSystem::wait(counter);
+	mEnd = Profiler::now();
+
+	for (const auto& task : mTasks) {
+		if (!task->executed) {
+			LOG(General, 1, "%s: task '%s' skipped, a dependency failed\n", __FUNCTION__, task->name);
+		}
+	}
+	return !mFailed;
+}
+
+void TaskGraph::schedule(size_t taskIndex, JobCounter& counter) {
+	JobSystem::submit([this, taskIndex, &counter]() {
+		Task& task = *mTasks.at(taskIndex);
+		task.threadIndex = JobSystem::getCurrentThreadIndex();
+		task.start = Profiler::now();
+		{
+			ProfileZone zone(task.name);
+			task.succeeded = task.function();
+		}
+		task.end = Profiler::now();
+		task.executed = true;
+		if (!task.succeeded) {
+			LOG(General, 1, "%s error: task '%s' failed\n", __FUNCTION__, task.name);
+			mFailed = true;
+			return;
+		}
+		for (size_t dependent : task.dependents) {
+			if (mTasks.at(dependent)->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				schedule(dependent, counter);
+			}
+		}
+	}, &counter);
+}
+
+void TaskGraph::logReport(const char* title) {
+	uint64_t taskTime = 0;
+	// Tasks are stored in dependency order, so one pass finds the longest chain
+	std::vector<uint64_t> chainTime(mTasks.size(), 0);
+	std::vector<size_t> chainPrevious(mTasks.size(), SIZE_MAX);
+	size_t chainEnd = SIZE_MAX;
+	for (size_t i = 0; i < mTasks.size(); ++i) {
+		const Task& task = *mTasks.at(i);
+		if (!task.executed) {
+			continue;
+		}
+		uint64_t duration = task.end - task.start;
+		taskTime += duration;
+		for (size_t dependency : task.dependencies) {
+			if (chainTime.at(dependency) > chainTime.at(i)) {
+				chainTime.at(i) = chainTime.at(dependency);
+				chainPrevious.at(i) = dependency;
+			}
+		}
+		chainTime.at(i) += duration;
+		if (chainEnd == SIZE_MAX || chainTime.at(i) > chainTime.at(chainEnd)) {
+			chainEnd = i;
+		}
+	}
+
+	uint64_t wallTime = mEnd - mStart;
+	LOG(General, 1, "%s: %zu tasks in %.2f ms on %u threads, %.2f ms task time (%.2fx parallel)\n", title, mTasks.size(),
+		wallTime / 1.0e6, JobSystem::getThreadCount() + 1, taskTime / 1.0e6, wallTime > 0 ? static_cast<double>(taskTime) / wallTime : 0.0);
+	LOG(General, 1, "%s:   %-24s %10s %10s %7s\n", title, "task", "start ms", "time ms", "thread");
+	for (const auto& task : mTasks) {
+		if (!task->executed) {
+			LOG(General, 1, "%s:   %-24s %10s\n", title, task->name, "skipped");
+			continue;
+		}
+		LOG(General, 1, "%s:   %-24s %10.2f %10.2f %7u\n", title, task->name,
+			(task->start - mStart) / 1.0e6, (task->end - task->start) / 1.0e6, task->threadIndex);
+	}
+
+	if (chainEnd == SIZE_MAX) {
+		return;
+	}
+	std::string chain;
+	for (size_t i = chainEnd; i != SIZE_MAX; i = chainPrevious.at(i)) {
+		chain = std::string(mTasks.at(i)->name) + (chain.empty() ? "" : " -> ") + chain;
+	}
+	LOG(General, 1, "%s: critical path %.2f ms: %s\n", title, chainTime.at(chainEnd) / 1.0e6, chain.c_str());
+}
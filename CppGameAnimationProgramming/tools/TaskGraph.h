@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "JobSystem.h"
+
+/* one-shot dependency graph, independent tasks run concurrently on the JobSystem */
+class TaskGraph {
+public:
+	/* names must outlive the graph, use string literals; dependencies must be added first */
+	void addTask(const char* name, std::vector<const char*> dependencies, std::function<bool()> task);
+	/* false if the graph is invalid or a task failed, tasks depending on a failed task are skipped */
+	bool run();
+	/* start, duration and thread of every task plus the critical path */
+	void logReport(const char* title);
+
+private:
+	struct Task {
+		const char* name = nullptr;
+		std::function<bool()> function;
+		std::vector<size_t> dependencies;
+		std::vector<size_t> dependents;
+		std::atomic<size_t> pendingDependencies{ 0 };
+		bool succeeded = false;
+		bool executed = false;
+		uint64_t start = 0;
+		uint64_t end = 0;
+		unsigned int threadIndex = 0;
+	};
+
+	// Tasks hold atomics and are never moved once added
+	std::vector<std::unique_ptr<Task>> mTasks;
+	std::atomic<bool> mFailed{ false };
+	bool mInvalid = false;
+	uint64_t mStart = 0;
+	uint64_t mEnd = 0;
+
+	void schedule(size_t taskIndex, JobCounter& counter);
+};
@@ -0,0 +1,107 @@
+#include <mutex>
+#include "BindlessTextures.h"
+#include "LayoutCache.h"
+#include "DeletionQueue.h"
+#include "Logger.h"
+
+namespace {
+	// Textures may be uploaded by init tasks on several threads
+	std::mutex tableMutex;
+}
+
+bool BindlessTextures::init(VkRenderData& renderData) {
+	VkBindlessTextureData& table = renderData.rdBindlessTextures;
+	// Count 0 marks the runtime array, the same binding the reflected shaders produce
+	VkDescriptorSetLayoutBinding tableBinding{};
+	tableBinding.binding = 0;
+	tableBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	tableBinding.descriptorCount = 0;
+	tableBinding.stageFlags = VK_SHADER_STAGE_ALL;
+	table.layout = LayoutCache::getDescriptorSetLayout(renderData, { tableBinding });
+	if (table.layout == VK_NULL_HANDLE) {
+		LOG(Vulkan, 1, "%s error: could not create texture table layout\n", __FUNCTION__);
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = table.capacity;
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(renderData.rdVkbDevice.device, &poolInfo, nullptr, &table.pool) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create texture table pool\n", __FUNCTION__);
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = table.pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &table.layout;
+	if (vkAllocateDescriptorSets(renderData.rdVkbDevice.device, &allocateInfo, &table.set) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not allocate texture table\n", __FUNCTION__);
+		return false;
+	}
+	LOG(Vulkan, 1, "%s: texture table with %u slots\n", __FUNCTION__, table.capacity);
+	return true;
+}
+
+uint32_t BindlessTextures::addTexture(VkRenderData& renderData, VkImageView imageView, VkSampler sampler) {
+	VkBindlessTextureData& table = renderData.rdBindlessTextures;
+	uint32_t textureIndex = UINT32_MAX;
+	{
+		std::lock_guard<std::mutex> lock(tableMutex);
+		if (!table.freeIndices.empty()) {
+			textureIndex = table.freeIndices.back();
+			table.freeIndices.pop_back();
+		}
+		else if (table.nextIndex < table.capacity) {
+			textureIndex = table.nextIndex++;
+		}
+	}
+	if (textureIndex == UINT32_MAX) {
+		LOG(Vulkan, 1, "%s error: texture table is full (%u slots)\n", __FUNCTION__, table.capacity);
+		return UINT32_MAX;
+	}
+	updateTexture(renderData, textureIndex, imageView, sampler);
+	return textureIndex;
+}
+
+void BindlessTextures::updateTexture(VkRenderData& renderData, uint32_t textureIndex, VkImageView imageView, VkSampler sampler) {
+	VkBindlessTextureData& table = renderData.rdBindlessTextures;
+	// Different array elements, no lock needed for the write itself
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = table.set;
+	write.dstBinding = 0;
+	write.dstArrayElement = textureIndex;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(renderData.rdVkbDevice.device, 1, &write, 0, nullptr);
+}
+
+void BindlessTextures::removeTexture(VkRenderData& renderData, uint32_t textureIndex) {
+	if (textureIndex >= renderData.rdBindlessTextures.capacity) {
+		return;
+	}
+	// Draws already submitted may still sample the slot, hand it out again only after they finished
+	DeletionQueue::push(renderData, [&renderData, textureIndex]() {
+		std::lock_guard<std::mutex> lock(tableMutex);
+		renderData.rdBindlessTextures.freeIndices.push_back(textureIndex);
+	});
+}
+
+void BindlessTextures::cleanup(VkRenderData& renderData) {
+	// The layout belongs to the LayoutCache, the set goes with the pool
+	vkDestroyDescriptorPool(renderData.rdVkbDevice.device, renderData.rdBindlessTextures.pool, nullptr);
+	renderData.rdBindlessTextures = VkBindlessTextureData{};
+}
\ No newline at end of file
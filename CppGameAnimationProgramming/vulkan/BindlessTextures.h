@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* global texture table using descriptor indexing, bound once per command buffer
+ * slots are written with update-after-bind, so textures can come and go while frames are in flight */
+class BindlessTextures {
+public:
+	/* the table capacity in rdBindlessTextures has to be set by the device init */
+	static bool init(VkRenderData& renderData);
+	/* index for shaders, UINT32_MAX if the table is full */
+	static uint32_t addTexture(VkRenderData& renderData, VkImageView imageView, VkSampler sampler);
+	/* points the slot to another image, no frame in flight may sample the slot */
+	static void updateTexture(VkRenderData& renderData, uint32_t textureIndex, VkImageView imageView, VkSampler sampler);
+	/* the slot is reused once the frames submitted so far are complete */
+	static void removeTexture(VkRenderData& renderData, uint32_t textureIndex);
+	static void cleanup(VkRenderData& renderData);
+};
\ No newline at end of file
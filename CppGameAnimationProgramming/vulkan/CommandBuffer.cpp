@@ -3,13 +3,17 @@
 #include <VkBootstrap.h>
 
 bool CommandBuffer::init(VkRenderData& renderData, VkCommandBuffer& commandBuffer) {
+	return init(renderData, renderData.rdCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, commandBuffer);
+}
+
+bool CommandBuffer::init(VkRenderData& renderData, VkCommandPool pool, VkCommandBufferLevel level, VkCommandBuffer& commandBuffer) {
 	VkCommandBufferAllocateInfo bufferAllocInfo{};
 	bufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	bufferAllocInfo.commandPool = renderData.rdCommandPool;
-	bufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	bufferAllocInfo.commandPool = pool;
+	bufferAllocInfo.level = level;
 	bufferAllocInfo.commandBufferCount = 1;
 	if (vkAllocateCommandBuffers(renderData.rdVkbDevice.device, &bufferAllocInfo, &commandBuffer) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not allocate command buffers\n", __FUNCTION__);
+		LOG(Vulkan, 1, "%s error: could not allocate command buffers\n", __FUNCTION__);
 		return false;
 	}
 	return true;
@@ -4,6 +4,9 @@
 
 class CommandBuffer {
 public:
+	/* primary buffer from the one-shot pool */
 	static bool init(VkRenderData& renderData, VkCommandBuffer& commandBuffer);
 	static void cleanup(VkRenderData& renderData, VkCommandBuffer& commandBuffer);
+	/* frame pool buffers are freed together with their pool */
+	static bool init(VkRenderData& renderData, VkCommandPool pool, VkCommandBufferLevel level, VkCommandBuffer& commandBuffer);
 };
\ No newline at end of file
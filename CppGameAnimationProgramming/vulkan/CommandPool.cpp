@@ -1,19 +1,112 @@
 #include "CommandPool.h"
+#include "CommandBuffer.h"
+#include "JobSystem.h"
 #include "Logger.h"
 #include "VkBootstrap.h"
 
 bool CommandPool::init(VkRenderData& renderData) {
-	VkCommandPoolCreateInfo poolCreateInfo{};
-	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolCreateInfo.queueFamilyIndex = renderData.rdVkbDevice.get_queue_index(vkb::QueueType::graphics).value();
-	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	if (vkCreateCommandPool(renderData.rdVkbDevice.device, &poolCreateInfo, nullptr, &renderData.rdCommandPool) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not create command pool\n", __FUNCTION__);
+	VkCommandPoolCreateInfo uploadPoolCreateInfo{};
+	uploadPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	uploadPoolCreateInfo.queueFamilyIndex = renderData.rdVkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+	uploadPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	if (vkCreateCommandPool(renderData.rdVkbDevice.device, &uploadPoolCreateInfo, nullptr, &renderData.rdCommandPool) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create command pool\n", __FUNCTION__);
 		return false;
 	}
+
+	VkCommandPoolData& commandPools = renderData.rdFrameCommandPools;
+	commandPools.threadCount = JobSystem::getThreadCount() + 1;
+	commandPools.frameIndex = 0;
+	commandPools.pools.resize(VkCommandPoolData::FRAME_COUNT * commandPools.threadCount);
+	commandPools.primaryBuffers.resize(VkCommandPoolData::FRAME_COUNT, VK_NULL_HANDLE);
+
+	VkCommandPoolCreateInfo poolCreateInfo = uploadPoolCreateInfo;
+	// Buffers live for one frame and are only reset together with their pool
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	for (VkThreadCommandPool& threadPool : commandPools.pools) {
+		if (vkCreateCommandPool(renderData.rdVkbDevice.device, &poolCreateInfo, nullptr, &threadPool.pool) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not create command pool\n", __FUNCTION__);
+			return false;
+		}
+	}
+	for (uint32_t frame = 0; frame < VkCommandPoolData::FRAME_COUNT; ++frame) {
+		if (!CommandBuffer::init(renderData, commandPools.pools.at(frame * commandPools.threadCount).pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				commandPools.primaryBuffers.at(frame))) {
+			LOG(Vulkan, 1, "%s error: could not allocate primary command buffer\n", __FUNCTION__);
+			return false;
+		}
+	}
+	renderData.rdCommandBuffer = commandPools.primaryBuffers.at(0);
+	LOG(Vulkan, 2, "%s: %u command pools for %u threads\n", __FUNCTION__, static_cast<uint32_t>(commandPools.pools.size()),
+		commandPools.threadCount);
 	return true;
 }
 
+bool CommandPool::beginFrame(VkRenderData& renderData) {
+	VkCommandPoolData& commandPools = renderData.rdFrameCommandPools;
+	commandPools.frameIndex = (commandPools.frameIndex + 1) % VkCommandPoolData::FRAME_COUNT;
+	for (uint32_t thread = 0; thread < commandPools.threadCount; ++thread) {
+		VkThreadCommandPool& threadPool = commandPools.pools.at(commandPools.frameIndex * commandPools.threadCount + thread);
+		if (vkResetCommandPool(renderData.rdVkbDevice.device, threadPool.pool, 0) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not reset command pool\n", __FUNCTION__);
+			return false;
+		}
+		threadPool.usedCount = 0;
+	}
+	renderData.rdCommandBuffer = commandPools.primaryBuffers.at(commandPools.frameIndex);
+	return true;
+}
+
+VkCommandBuffer CommandPool::beginSecondary(VkRenderData& renderData, VkFormat colorFormat, VkFormat depthFormat) {
+	VkCommandPoolData& commandPools = renderData.rdFrameCommandPools;
+	uint32_t thread = JobSystem::getCurrentThreadIndex();
+	if (thread >= commandPools.threadCount) {
+		LOG(Vulkan, 1, "%s error: thread %u has no command pool\n", __FUNCTION__, thread);
+		return VK_NULL_HANDLE;
+	}
+	// Only this thread touches its pool, no locking needed
+	VkThreadCommandPool& threadPool = commandPools.pools.at(commandPools.frameIndex * commandPools.threadCount + thread);
+	if (threadPool.usedCount == threadPool.secondaryBuffers.size()) {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		if (!CommandBuffer::init(renderData, threadPool.pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, commandBuffer)) {
+			return VK_NULL_HANDLE;
+		}
+		threadPool.secondaryBuffers.push_back(commandBuffer);
+	}
+	VkCommandBuffer commandBuffer = threadPool.secondaryBuffers.at(threadPool.usedCount++);
+
+	// Continues a dynamic rendering begun in the primary buffer, only the attachment formats have to match
+	VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	renderingInfo.colorAttachmentCount = colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+	renderingInfo.depthAttachmentFormat = depthFormat;
+	renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.pNext = &renderingInfo;
+	// The pass statistics query of the primary buffer stays active while the secondary buffers run
+	inheritanceInfo.pipelineStatistics = renderData.rdQueries.statisticsPool != VK_NULL_HANDLE ? VkQueryData::STATISTICS : 0;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not begin secondary command buffer\n", __FUNCTION__);
+		return VK_NULL_HANDLE;
+	}
+	return commandBuffer;
+}
+
 void CommandPool::cleanup(VkRenderData& renderData) {
+	// Destroying a pool frees its buffers
 	vkDestroyCommandPool(renderData.rdVkbDevice.device, renderData.rdCommandPool, nullptr);
+	VkCommandPoolData& commandPools = renderData.rdFrameCommandPools;
+	for (VkThreadCommandPool& threadPool : commandPools.pools) {
+		vkDestroyCommandPool(renderData.rdVkbDevice.device, threadPool.pool, nullptr);
+	}
+	commandPools = VkCommandPoolData{};
+	renderData.rdCommandBuffer = VK_NULL_HANDLE;
 }
\ No newline at end of file
@@ -2,8 +2,14 @@
 #include <vulkan/vulkan.h>
 #include "VkRenderData.h"
 
+/* one pool per frame and recording thread, so workers record without locking and pools are reset instead of buffers */
 class CommandPool {
 public:
+	/* the one-shot pool, frame pools for the render thread and every job system worker, and the primary buffer of each frame */
 	static bool init(VkRenderData& renderData);
+	/* moves to the next frame and resets its pools, the GPU must be done with that frame */
+	static bool beginFrame(VkRenderData& renderData);
+	/* begun secondary buffer from the pool of the calling thread, it continues a rendering with these attachment formats */
+	static VkCommandBuffer beginSecondary(VkRenderData& renderData, VkFormat colorFormat, VkFormat depthFormat);
 	static void cleanup(VkRenderData& renderData);
 };
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "DeletionQueue.h"
+#include "Logger.h"
+
+void DeletionQueue::push(VkRenderData& renderData, std::function<void()> destroyFunction, uint32_t frameDelay) {
+	renderData.rdDeletionQueue.push_back({ renderData.rdFrameNumber + frameDelay, std::move(destroyFunction) });
+}
+
+void DeletionQueue::flush(VkRenderData& renderData) {
+	// Entries are pushed in frame order except for a larger delay, stop at the first one still in use
+	while (!renderData.rdDeletionQueue.empty() && renderData.rdDeletionQueue.front().frame <= renderData.rdFrameNumber) {
+		renderData.rdDeletionQueue.front().destroyFunction();
+		renderData.rdDeletionQueue.pop_front();
+	}
+}
+
+void DeletionQueue::cleanup(VkRenderData& renderData) {
+	LOG(Vulkan, 2, "%s: destroying %zu deferred resources\n", __FUNCTION__, renderData.rdDeletionQueue.size());
+	for (auto& entry : renderData.rdDeletionQueue) {
+		entry.destroyFunction();
+	}
+	renderData.rdDeletionQueue.clear();
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include "VkRenderData.h"
+
+/* destroys resources once the GPU has finished every frame that could still use them, no device idle wait */
+class DeletionQueue {
+public:
+	/* runs after the GPU finished the frames submitted so far plus frameDelay more, for the presentation engine */
+	static void push(VkRenderData& renderData, std::function<void()> destroyFunction, uint32_t frameDelay = 0);
+	/* call right after the frame fence wait, every submitted frame is complete then */
+	static void flush(VkRenderData& renderData);
+	/* runs everything left, the device has to be idle */
+	static void cleanup(VkRenderData& renderData);
+};
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include "DescriptorAllocator.h"
+#include "Logger.h"
+
+namespace {
+	// Static sets may be requested by init tasks on several threads, frame sets only by the render loop
+	std::mutex staticMutex;
+
+	// Descriptors per set of each type, multiplied by the sets per pool
+	const std::vector<std::pair<VkDescriptorType, uint32_t>> POOL_RATIOS = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+	};
+
+	VkDescriptorPool createPool(VkDevice device) {
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (const auto& ratio : POOL_RATIOS) {
+			poolSizes.push_back({ ratio.first, ratio.second * VkDescriptorAllocatorData::SETS_PER_POOL });
+		}
+		// No FREE_DESCRIPTOR_SET_BIT, sets only go away with a pool reset
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = VkDescriptorAllocatorData::SETS_PER_POOL;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not create descriptor pool\n", __FUNCTION__);
+			return VK_NULL_HANDLE;
+		}
+		return pool;
+	}
+
+	bool nextPool(VkDevice device, VkDescriptorPoolChain& chain) {
+		if (chain.currentPool != VK_NULL_HANDLE) {
+			chain.usedPools.push_back(chain.currentPool);
+		}
+		if (!chain.freePools.empty()) {
+			chain.currentPool = chain.freePools.back();
+			chain.freePools.pop_back();
+			return true;
+		}
+		chain.currentPool = createPool(device);
+		return chain.currentPool != VK_NULL_HANDLE;
+	}
+
+	VkDescriptorSet allocate(VkDevice device, VkDescriptorPoolChain& chain, VkDescriptorSetLayout layout) {
+		if (chain.currentPool == VK_NULL_HANDLE && !nextPool(device, chain)) {
+			return VK_NULL_HANDLE;
+		}
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = chain.currentPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &layout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkResult result = vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		// A full pool is retired into the chain, the next one is fresh and has room for any single set
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+			if (!nextPool(device, chain)) {
+				return VK_NULL_HANDLE;
+			}
+			allocateInfo.descriptorPool = chain.currentPool;
+			result = vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		}
+		if (result != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not allocate descriptor set (%i)\n", __FUNCTION__, result);
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	void resetChain(VkDevice device, VkDescriptorPoolChain& chain) {
+		if (chain.currentPool != VK_NULL_HANDLE) {
+			chain.usedPools.push_back(chain.currentPool);
+			chain.currentPool = VK_NULL_HANDLE;
+		}
+		for (VkDescriptorPool pool : chain.usedPools) {
+			vkResetDescriptorPool(device, pool, 0);
+			chain.freePools.push_back(pool);
+		}
+		chain.usedPools.clear();
+	}
+
+	void destroyChain(VkDevice device, VkDescriptorPoolChain& chain) {
+		resetChain(device, chain);
+		for (VkDescriptorPool pool : chain.freePools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		chain.freePools.clear();
+	}
+
+	void appendKey(std::string& key, const void* data, size_t size) {
+		key.append(static_cast<const char*>(data), size);
+	}
+}
+
+bool DescriptorAllocator::init(VkRenderData& renderData) {
+	// One pool up front, the first frames should not have to create any
+	if (!nextPool(renderData.rdVkbDevice.device, renderData.rdDescriptorAllocator.staticPools)) {
+		LOG(Vulkan, 1, "%s error: could not create initial descriptor pool\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+void DescriptorAllocator::beginFrame(VkRenderData& renderData) {
+	// The fence wait guarantees that the frame which used this slot before is complete
+	VkDescriptorAllocatorData& allocator = renderData.rdDescriptorAllocator;
+	allocator.currentSlot = static_cast<uint32_t>(renderData.rdFrameNumber % VkDescriptorAllocatorData::FRAME_SLOTS);
+	resetChain(renderData.rdVkbDevice.device, allocator.framePools.at(allocator.currentSlot));
+}
+
+VkDescriptorSet DescriptorAllocator::allocateFrameSet(VkRenderData& renderData, VkDescriptorSetLayout layout) {
+	VkDescriptorAllocatorData& allocator = renderData.rdDescriptorAllocator;
+	return allocate(renderData.rdVkbDevice.device, allocator.framePools.at(allocator.currentSlot), layout);
+}
+
+VkDescriptorSet DescriptorAllocator::allocateStaticSet(VkRenderData& renderData, VkDescriptorSetLayout layout) {
+	std::lock_guard<std::mutex> lock(staticMutex);
+	return allocate(renderData.rdVkbDevice.device, renderData.rdDescriptorAllocator.staticPools, layout);
+}
+
+VkDescriptorSet DescriptorAllocator::getCachedSet(VkRenderData& renderData, VkDescriptorSetLayout layout,
+		const std::vector<VkDescriptorBindingData>& bindings) {
+	// Field by field, struct padding must not end up in the key
+	std::string key;
+	appendKey(key, &layout, sizeof(layout));
+	for (const VkDescriptorBindingData& binding : bindings) {
+		appendKey(key, &binding.binding, sizeof(binding.binding));
+		appendKey(key, &binding.type, sizeof(binding.type));
+		appendKey(key, &binding.imageInfo.sampler, sizeof(binding.imageInfo.sampler));
+		appendKey(key, &binding.imageInfo.imageView, sizeof(binding.imageInfo.imageView));
+		appendKey(key, &binding.imageInfo.imageLayout, sizeof(binding.imageInfo.imageLayout));
+		appendKey(key, &binding.bufferInfo.buffer, sizeof(binding.bufferInfo.buffer));
+		appendKey(key, &binding.bufferInfo.offset, sizeof(binding.bufferInfo.offset));
+		appendKey(key, &binding.bufferInfo.range, sizeof(binding.bufferInfo.range));
+	}
+
+	std::lock_guard<std::mutex> lock(staticMutex);
+	VkDescriptorAllocatorData& allocator = renderData.rdDescriptorAllocator;
+	auto cached = allocator.cachedSets.find(key);
+	if (cached != allocator.cachedSets.end()) {
+		return cached->second.set;
+	}
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet>& freeSets = allocator.freeCachedSets[layout];
+	if (!freeSets.empty()) {
+		set = freeSets.back();
+		freeSets.pop_back();
+	}
+	else {
+		set = allocate(renderData.rdVkbDevice.device, allocator.staticPools, layout);
+	}
+	if (set == VK_NULL_HANDLE) {
+		return VK_NULL_HANDLE;
+	}
+
+	std::vector<VkWriteDescriptorSet> writes;
+	for (const VkDescriptorBindingData& binding : bindings) {
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding.binding;
+		write.descriptorCount = 1;
+		write.descriptorType = binding.type;
+		write.pImageInfo = &binding.imageInfo;
+		write.pBufferInfo = &binding.bufferInfo;
+		writes.push_back(write);
+	}
+	vkUpdateDescriptorSets(renderData.rdVkbDevice.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+	VkCachedDescriptorSet entry{};
+	entry.set = set;
+	entry.layout = layout;
+	for (const VkDescriptorBindingData& binding : bindings) {
+		if (binding.bufferInfo.buffer != VK_NULL_HANDLE) {
+			entry.buffers.push_back(binding.bufferInfo.buffer);
+		}
+	}
+	allocator.cachedSets.emplace(key, std::move(entry));
+	return set;
+}
+
+void DescriptorAllocator::invalidate(VkRenderData& renderData, VkBuffer buffer) {
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(staticMutex);
+	VkDescriptorAllocatorData& allocator = renderData.rdDescriptorAllocator;
+	for (auto cached = allocator.cachedSets.begin(); cached != allocator.cachedSets.end();) {
+		const std::vector<VkBuffer>& buffers = cached->second.buffers;
+		if (std::find(buffers.begin(), buffers.end(), buffer) == buffers.end()) {
+			++cached;
+			continue;
+		}
+		// No frame reads the set anymore, the next request with this layout rewrites it
+		allocator.freeCachedSets[cached->second.layout].push_back(cached->second.set);
+		cached = allocator.cachedSets.erase(cached);
+	}
+}
+
+void DescriptorAllocator::cleanup(VkRenderData& renderData) {
+	VkDevice device = renderData.rdVkbDevice.device;
+	VkDescriptorAllocatorData& allocator = renderData.rdDescriptorAllocator;
+	for (VkDescriptorPoolChain& chain : allocator.framePools) {
+		destroyChain(device, chain);
+	}
+	destroyChain(device, allocator.staticPools);
+	allocator.cachedSets.clear();
+	allocator.freeCachedSets.clear();
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* descriptor sets from chained pools, never freed one by one
+ * frame sets are dropped wholesale when their pools are reset, static sets live until cleanup */
+class DescriptorAllocator {
+public:
+	static bool init(VkRenderData& renderData);
+	/* call right after the frame fence wait, resets the pools of the frame slot being reused */
+	static void beginFrame(VkRenderData& renderData);
+	/* valid until the current frame slot comes around again, main thread only */
+	static VkDescriptorSet allocateFrameSet(VkRenderData& renderData, VkDescriptorSetLayout layout);
+	/* valid until cleanup */
+	static VkDescriptorSet allocateStaticSet(VkRenderData& renderData, VkDescriptorSetLayout layout);
+	/* static set with the given contents, identical layout and bindings return the same set */
+	static VkDescriptorSet getCachedSet(VkRenderData& renderData, VkDescriptorSetLayout layout,
+		const std::vector<VkDescriptorBindingData>& bindings);
+	/* drops the cached sets referencing the buffer, call when it is destroyed and no frame uses it anymore */
+	static void invalidate(VkRenderData& renderData, VkBuffer buffer);
+	static void cleanup(VkRenderData& renderData);
+};
\ No newline at end of file
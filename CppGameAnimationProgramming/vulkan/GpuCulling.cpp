@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "GpuCulling.h"
+#include "Shader.h"
+#include "LayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "DeletionQueue.h"
+#include "Frustum.h"
+#include "MeshletBuilder.h"
+#include "VertexFormat.h"
+#include "Logger.h"
+
+namespace {
+	bool createBuffer(VkRenderData& renderData, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+			VkBuffer& buffer, VmaAllocation& bufferAlloc) {
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		VmaAllocationCreateInfo vmaAllocInfo{};
+		vmaAllocInfo.usage = memoryUsage;
+		if (vmaCreateBuffer(renderData.rdAllocator, &bufferInfo, &vmaAllocInfo, &buffer, &bufferAlloc, nullptr) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not allocate %llu byte buffer via VMA\n", __FUNCTION__, static_cast<unsigned long long>(size));
+			return false;
+		}
+		return true;
+	}
+
+	void retireBuffer(VkRenderData& renderData, VkBuffer& buffer, VmaAllocation& bufferAlloc) {
+		if (buffer == VK_NULL_HANDLE) {
+			return;
+		}
+		VkBuffer oldBuffer = buffer;
+		VmaAllocation oldBufferAlloc = bufferAlloc;
+		DeletionQueue::push(renderData, [&renderData, oldBuffer, oldBufferAlloc]() {
+			// Before the handle is freed, a new buffer could get the same one and hit a stale set
+			DescriptorAllocator::invalidate(renderData, oldBuffer);
+			vmaDestroyBuffer(renderData.rdAllocator, oldBuffer, oldBufferAlloc);
+		});
+		buffer = VK_NULL_HANDLE;
+		bufferAlloc = VK_NULL_HANDLE;
+	}
+
+	void writeBuffer(VkRenderData& renderData, VmaAllocation bufferAlloc, const void* data, size_t size) {
+		void* mappedData;
+		vmaMapMemory(renderData.rdAllocator, bufferAlloc, &mappedData);
+		std::memcpy(mappedData, data, size);
+		vmaUnmapMemory(renderData.rdAllocator, bufferAlloc);
+	}
+
+	VkDescriptorBindingData storageBinding(uint32_t binding, VkBuffer buffer) {
+		VkDescriptorBindingData bindingData{};
+		bindingData.binding = binding;
+		bindingData.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindingData.bufferInfo.buffer = buffer;
+		bindingData.bufferInfo.offset = 0;
+		bindingData.bufferInfo.range = VK_WHOLE_SIZE;
+		return bindingData;
+	}
+
+	VkBufferMemoryBarrier bufferBarrier(VkBuffer buffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		return barrier;
+	}
+
+	bool createFilledBuffer(VkRenderData& renderData, const void* data, size_t size, VkBufferUsageFlags usage,
+			VkBuffer& buffer, VmaAllocation& bufferAlloc) {
+		if (!createBuffer(renderData, size, usage, VMA_MEMORY_USAGE_CPU_TO_GPU, buffer, bufferAlloc)) {
+			return false;
+		}
+		writeBuffer(renderData, bufferAlloc, data, size);
+		return true;
+	}
+
+	bool createComputePipeline(VkRenderData& renderData, std::string shaderFileName, VkPipeline& pipeline,
+			VkPipelineLayout& pipelineLayout, VkDescriptorSetLayout& setLayout) {
+		VkDevice device = renderData.rdVkbDevice.device;
+		VkShaderStage shader{};
+		if (!Shader::loadShader(device, shaderFileName, shader)) {
+			LOG(Vulkan, 1, "%s error: could not load culling shader '%s'\n", __FUNCTION__, shaderFileName.c_str());
+			return false;
+		}
+		pipelineLayout = LayoutCache::getPipelineLayout(renderData, { shader.reflection });
+		// The set layout is deduplicated, asking again with the reflected bindings returns the one in the pipeline layout
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		for (const VkShaderBinding& binding : shader.reflection.bindings) {
+			bindings.push_back(binding.layoutBinding);
+		}
+		setLayout = LayoutCache::getDescriptorSetLayout(renderData, bindings);
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shader.module;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		VkResult result = pipelineLayout == VK_NULL_HANDLE || setLayout == VK_NULL_HANDLE ? VK_ERROR_INITIALIZATION_FAILED :
+			vkCreateComputePipelines(device, renderData.rdPipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+		vkDestroyShaderModule(device, shader.module, nullptr);
+		if (result != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not create culling pipeline for '%s'\n", __FUNCTION__, shaderFileName.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// The eye is the one point with clip space x, y and w all zero, parallel projections only have a direction
+	glm::vec4 getViewOrigin(const glm::mat4& viewProjection) {
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; ++i) {
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+		glm::mat3 system = glm::transpose(glm::mat3(glm::vec3(rows[0]), glm::vec3(rows[1]), glm::vec3(rows[3])));
+		float determinant = glm::determinant(system);
+		float scale = glm::length(glm::vec3(rows[0])) * glm::length(glm::vec3(rows[1])) * glm::length(glm::vec3(rows[3]));
+		if (std::abs(determinant) > 1.0e-6f * scale) {
+			glm::vec3 position = glm::inverse(system) * -glm::vec3(rows[0].w, rows[1].w, rows[3].w);
+			return glm::vec4(position, 1.0f);
+		}
+		// Along the direction clip x and y stay the same, depth has to grow
+		glm::vec3 direction = glm::cross(glm::vec3(rows[0]), glm::vec3(rows[1]));
+		if (glm::dot(direction, glm::vec3(rows[2])) < 0.0f) {
+			direction = -direction;
+		}
+		float length = glm::length(direction);
+		return glm::vec4(length > 0.0f ? direction / length : glm::vec3(0.0f, 0.0f, 1.0f), 0.0f);
+	}
+}
+
+bool GpuCulling::init(VkRenderData& renderData, std::string shaderFileName, std::string clusterShaderFileName) {
+	VkCullingData& culling = renderData.rdCulling;
+	VkClusterCullingData& clusters = renderData.rdClusterCulling;
+	if (!createComputePipeline(renderData, shaderFileName, culling.pipeline, culling.pipelineLayout, culling.cullSetLayout) ||
+		!createComputePipeline(renderData, clusterShaderFileName, clusters.pipeline, clusters.pipelineLayout, clusters.cullSetLayout)) {
+		return false;
+	}
+
+	// Same binding the reflected vertex shaders produce for their instance buffer
+	VkDescriptorSetLayoutBinding instanceBinding{};
+	instanceBinding.binding = 0;
+	instanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceBinding.descriptorCount = 1;
+	instanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	culling.instanceSetLayout = LayoutCache::getDescriptorSetLayout(renderData, { instanceBinding });
+	if (culling.instanceSetLayout == VK_NULL_HANDLE) {
+		LOG(Vulkan, 1, "%s error: could not create instance set layout\n", __FUNCTION__);
+		return false;
+	}
+
+	if (!createBuffer(renderData, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, culling.countBuffer, culling.countBufferAlloc)) {
+		return false;
+	}
+	return true;
+}
+
+bool GpuCulling::uploadScene(VkRenderData& renderData, const std::vector<VkInstanceData>& instances,
+		const std::vector<VkMeshDrawData>& meshes) {
+	VkCullingData& culling = renderData.rdCulling;
+	bool buffersChanged = false;
+	// Grow by doubling, scenes that add instances over time do not reallocate every frame
+	if (instances.size() > culling.instanceCapacity) {
+		uint32_t capacity = std::max<uint32_t>(culling.instanceCapacity * 2, static_cast<uint32_t>(instances.size()));
+		retireBuffer(renderData, culling.instanceBuffer, culling.instanceBufferAlloc);
+		retireBuffer(renderData, culling.drawBuffer, culling.drawBufferAlloc);
+		if (!createBuffer(renderData, capacity * sizeof(VkInstanceData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_MEMORY_USAGE_CPU_TO_GPU, culling.instanceBuffer, culling.instanceBufferAlloc) ||
+			!createBuffer(renderData, capacity * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+				VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, culling.drawBuffer, culling.drawBufferAlloc)) {
+			culling.instanceCapacity = 0;
+			culling.instanceCount = 0;
+			return false;
+		}
+		culling.instanceCapacity = capacity;
+		buffersChanged = true;
+	}
+	if (meshes.size() > culling.meshCapacity) {
+		uint32_t capacity = std::max<uint32_t>(culling.meshCapacity * 2, static_cast<uint32_t>(meshes.size()));
+		retireBuffer(renderData, culling.meshBuffer, culling.meshBufferAlloc);
+		if (!createBuffer(renderData, capacity * sizeof(VkMeshDrawData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_MEMORY_USAGE_CPU_TO_GPU, culling.meshBuffer, culling.meshBufferAlloc)) {
+			culling.meshCapacity = 0;
+			culling.instanceCount = 0;
+			return false;
+		}
+		culling.meshCapacity = capacity;
+		buffersChanged = true;
+	}
+	if (culling.instanceCapacity == 0 || culling.meshCapacity == 0) {
+		culling.instanceCount = 0;
+		return true;
+	}
+
+	if (buffersChanged) {
+		culling.cullSet = DescriptorAllocator::getCachedSet(renderData, culling.cullSetLayout, {
+			storageBinding(0, culling.instanceBuffer), storageBinding(1, culling.meshBuffer),
+			storageBinding(2, culling.drawBuffer), storageBinding(3, culling.countBuffer) });
+		culling.instanceSet = DescriptorAllocator::getCachedSet(renderData, culling.instanceSetLayout, {
+			storageBinding(0, culling.instanceBuffer) });
+		if (culling.cullSet == VK_NULL_HANDLE || culling.instanceSet == VK_NULL_HANDLE) {
+			LOG(Vulkan, 1, "%s error: could not allocate culling descriptor sets\n", __FUNCTION__);
+			culling.instanceCount = 0;
+			return false;
+		}
+	}
+	writeBuffer(renderData, culling.instanceBufferAlloc, instances.data(), instances.size() * sizeof(VkInstanceData));
+	writeBuffer(renderData, culling.meshBufferAlloc, meshes.data(), meshes.size() * sizeof(VkMeshDrawData));
+	culling.instanceCount = static_cast<uint32_t>(instances.size());
+	return true;
+}
+
+VkCullData GpuCulling::getCullData(VkRenderData& renderData, const glm::mat4& viewProjection) {
+	VkCullData cullData{};
+	Frustum frustum = Frustum::fromViewProjection(viewProjection);
+	for (size_t i = 0; i < frustum.planes.size(); ++i) {
+		cullData.frustumPlanes[i] = frustum.planes.at(i);
+	}
+	cullData.instanceCount = renderData.rdCulling.instanceCount;
+	// Screen size of a mesh unit at distance w, the vertical axis of the projection decides
+	cullData.clipW = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	glm::vec3 clipY = glm::vec3(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1]);
+	cullData.pixelsPerUnit = glm::length(clipY) * renderData.rdRenderExtent.height * 0.5f;
+	cullData.lodErrorPixels = renderData.rdCulling.lodErrorPixels;
+	return cullData;
+}
+
+uint32_t GpuCulling::selectLod(const VkCullData& cullData, const VkMeshDrawData& mesh, const VkInstanceData& instance) {
+	// Same as cull.comp
+	glm::vec3 center = glm::vec3(mesh.boundingSphere) * instance.positionScale.w + glm::vec3(instance.positionScale);
+	float radius = mesh.boundingSphere.w * instance.positionScale.w;
+	uint32_t lod = 0;
+	float nearestW = glm::dot(glm::vec3(cullData.clipW), center) + cullData.clipW.w - radius * glm::length(glm::vec3(cullData.clipW));
+	if (nearestW > 0.0f) {
+		float pixelsPerUnit = cullData.pixelsPerUnit * instance.positionScale.w / nearestW;
+		while (lod + 1 < mesh.lodCount && mesh.lods[lod + 1].error * pixelsPerUnit <= cullData.lodErrorPixels) {
+			++lod;
+		}
+	}
+	return lod;
+}
+
+void GpuCulling::recordCulling(VkRenderData& renderData, VkCommandBuffer commandBuffer, const glm::mat4& viewProjection) {
+	VkCullingData& culling = renderData.rdCulling;
+	// recordDraws skips the draw as well
+	if (culling.instanceCount == 0) {
+		return;
+	}
+	vkCmdFillBuffer(commandBuffer, culling.countBuffer, 0, sizeof(uint32_t), 0);
+	// Previous frame's indirect reads are complete through the frame fence, only the clear needs ordering
+	VkBufferMemoryBarrier clearBarrier = bufferBarrier(culling.countBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr, 1, &clearBarrier, 0, nullptr);
+
+	VkCullData cullData = getCullData(renderData, viewProjection);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling.pipelineLayout, 0, 1, &culling.cullSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, culling.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkCullData), &cullData);
+	vkCmdDispatch(commandBuffer, (culling.instanceCount + VkCullingData::WORKGROUP_SIZE - 1) / VkCullingData::WORKGROUP_SIZE, 1, 1);
+}
+
+void GpuCulling::recordDraws(VkRenderData& renderData, VkCommandBuffer commandBuffer) {
+	VkCullingData& culling = renderData.rdCulling;
+	if (culling.instanceCount == 0) {
+		return;
+	}
+	vkCmdDrawIndexedIndirectCount(commandBuffer, culling.drawBuffer, 0, culling.countBuffer, 0, culling.instanceCount,
+		sizeof(VkDrawIndexedIndirectCommand));
+}
+
+bool GpuCulling::uploadClusters(VkRenderData& renderData, const VkMesh& mesh, uint32_t textureIndex) {
+	VkClusterCullingData& clusters = renderData.rdClusterCulling;
+	// The previous mesh may still be drawn by a submitted frame
+	retireBuffer(renderData, clusters.instanceBuffer, clusters.instanceBufferAlloc);
+	retireBuffer(renderData, clusters.vertexBuffer, clusters.vertexBufferAlloc);
+	retireBuffer(renderData, clusters.meshletBuffer, clusters.meshletBufferAlloc);
+	retireBuffer(renderData, clusters.meshletVertexBuffer, clusters.meshletVertexBufferAlloc);
+	retireBuffer(renderData, clusters.meshletTriangleBuffer, clusters.meshletTriangleBufferAlloc);
+	retireBuffer(renderData, clusters.indexBuffer, clusters.indexBufferAlloc);
+	retireBuffer(renderData, clusters.drawBuffer, clusters.drawBufferAlloc);
+	clusters.meshletCount = 0;
+
+	VkMeshletMesh meshletMesh;
+	if (!MeshletBuilder::build(mesh, meshletMesh)) {
+		LOG(Vulkan, 1, "%s error: could not build meshlets\n", __FUNCTION__);
+		return false;
+	}
+	if (meshletMesh.meshlets.empty()) {
+		return true;
+	}
+
+	VkInstanceData instance{};
+	instance.textureIndex = textureIndex;
+	std::vector<uint8_t> vertexData;
+	VertexFormat::encode(renderData.rdVertexFormat, mesh.vertices, vertexData, clusters.positionDequantization);
+	if (!createFilledBuffer(renderData, &instance, sizeof(VkInstanceData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			clusters.instanceBuffer, clusters.instanceBufferAlloc) ||
+		!createFilledBuffer(renderData, vertexData.data(), vertexData.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			clusters.vertexBuffer, clusters.vertexBufferAlloc) ||
+		!createFilledBuffer(renderData, meshletMesh.meshlets.data(), meshletMesh.meshlets.size() * sizeof(VkMeshlet),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, clusters.meshletBuffer, clusters.meshletBufferAlloc) ||
+		!createFilledBuffer(renderData, meshletMesh.vertices.data(), meshletMesh.vertices.size() * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, clusters.meshletVertexBuffer, clusters.meshletVertexBufferAlloc) ||
+		!createFilledBuffer(renderData, meshletMesh.triangles.data(), meshletMesh.triangles.size() * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, clusters.meshletTriangleBuffer, clusters.meshletTriangleBufferAlloc) ||
+		!createBuffer(renderData, meshletMesh.triangles.size() * 3 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, clusters.indexBuffer, clusters.indexBufferAlloc) ||
+		!createBuffer(renderData, sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, clusters.drawBuffer, clusters.drawBufferAlloc)) {
+		return false;
+	}
+
+	clusters.cullSet = DescriptorAllocator::getCachedSet(renderData, clusters.cullSetLayout, {
+		storageBinding(0, clusters.meshletBuffer), storageBinding(1, clusters.meshletVertexBuffer),
+		storageBinding(2, clusters.meshletTriangleBuffer), storageBinding(3, clusters.indexBuffer),
+		storageBinding(4, clusters.drawBuffer) });
+	clusters.instanceSet = DescriptorAllocator::getCachedSet(renderData, renderData.rdCulling.instanceSetLayout, {
+		storageBinding(0, clusters.instanceBuffer) });
+	if (clusters.cullSet == VK_NULL_HANDLE || clusters.instanceSet == VK_NULL_HANDLE) {
+		LOG(Vulkan, 1, "%s error: could not allocate cluster culling descriptor sets\n", __FUNCTION__);
+		return false;
+	}
+	clusters.meshletCount = static_cast<uint32_t>(meshletMesh.meshlets.size());
+	return true;
+}
+
+void GpuCulling::recordClusterCulling(VkRenderData& renderData, VkCommandBuffer commandBuffer, const glm::mat4& viewProjection) {
+	VkClusterCullingData& clusters = renderData.rdClusterCulling;
+	if (clusters.meshletCount == 0) {
+		return;
+	}
+	// No indices yet, the shader adds those of every surviving meshlet
+	VkDrawIndexedIndirectCommand emptyDraw{};
+	emptyDraw.instanceCount = 1;
+	vkCmdUpdateBuffer(commandBuffer, clusters.drawBuffer, 0, sizeof(VkDrawIndexedIndirectCommand), &emptyDraw);
+	VkBufferMemoryBarrier clearBarrier = bufferBarrier(clusters.drawBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr, 1, &clearBarrier, 0, nullptr);
+
+	VkClusterCullData cullData{};
+	Frustum frustum = Frustum::fromViewProjection(viewProjection);
+	for (size_t i = 0; i < frustum.planes.size(); ++i) {
+		cullData.frustumPlanes[i] = frustum.planes.at(i);
+	}
+	cullData.viewOrigin = getViewOrigin(viewProjection);
+	// The pipelines take clockwise triangles as front faces, in Vulkan clip space their normals point away from the viewer;
+	// a mirroring view projection turns that around
+	cullData.frontFaceSign = glm::determinant(viewProjection) >= 0.0f ? 1.0f : -1.0f;
+	cullData.meshletCount = clusters.meshletCount;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusters.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusters.pipelineLayout, 0, 1, &clusters.cullSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, clusters.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkClusterCullData), &cullData);
+	// One workgroup per meshlet, at least 65535 groups per dimension are always supported
+	uint32_t groupCountX = std::min<uint32_t>(clusters.meshletCount, 65535);
+	uint32_t groupCountY = (clusters.meshletCount + groupCountX - 1) / groupCountX;
+	vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+}
+
+void GpuCulling::recordClusterDraws(VkRenderData& renderData, VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) {
+	VkClusterCullingData& clusters = renderData.rdClusterCulling;
+	if (clusters.meshletCount == 0) {
+		return;
+	}
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &clusters.instanceSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(VkDrawData, positionDequantization),
+		sizeof(glm::vec4), &clusters.positionDequantization);
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &clusters.vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, clusters.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdDrawIndexedIndirect(commandBuffer, clusters.drawBuffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuCulling::cleanup(VkRenderData& renderData) {
+	// Layouts belong to the LayoutCache, the sets to the descriptor allocator
+	VkCullingData& culling = renderData.rdCulling;
+	vkDestroyPipeline(renderData.rdVkbDevice.device, culling.pipeline, nullptr);
+	vmaDestroyBuffer(renderData.rdAllocator, culling.instanceBuffer, culling.instanceBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, culling.meshBuffer, culling.meshBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, culling.drawBuffer, culling.drawBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, culling.countBuffer, culling.countBufferAlloc);
+	renderData.rdCulling = VkCullingData{};
+
+	VkClusterCullingData& clusters = renderData.rdClusterCulling;
+	vkDestroyPipeline(renderData.rdVkbDevice.device, clusters.pipeline, nullptr);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.instanceBuffer, clusters.instanceBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.vertexBuffer, clusters.vertexBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.meshletBuffer, clusters.meshletBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.meshletVertexBuffer, clusters.meshletVertexBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.meshletTriangleBuffer, clusters.meshletTriangleBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.indexBuffer, clusters.indexBufferAlloc);
+	vmaDestroyBuffer(renderData.rdAllocator, clusters.drawBuffer, clusters.drawBufferAlloc);
+	renderData.rdClusterCulling = VkClusterCullingData{};
+}
\ No newline at end of file
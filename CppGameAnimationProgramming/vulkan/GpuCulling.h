@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* frustum culling in a compute shader, visible instances end up as indirect draws with a GPU written count
+ * the CPU cost per frame does not depend on the number of instances
+ * a static mesh can additionally be culled per meshlet, by frustum and normal cone */
+class GpuCulling {
+public:
+	/* compute pipelines and draw count buffer, needs VMA, the pipeline cache and the descriptor allocator */
+	static bool init(VkRenderData& renderData, std::string shaderFileName, std::string clusterShaderFileName);
+	/* copies instances and meshes into the storage buffers, only while no submitted frame reads them */
+	static bool uploadScene(VkRenderData& renderData, const std::vector<VkInstanceData>& instances,
+		const std::vector<VkMeshDrawData>& meshes);
+	/* push constants of the culling shader for this view */
+	static VkCullData getCullData(VkRenderData& renderData, const glm::mat4& viewProjection);
+	/* LOD the culling shader would pick, for draws recorded on the CPU */
+	static uint32_t selectLod(const VkCullData& cullData, const VkMeshDrawData& mesh, const VkInstanceData& instance);
+	/* outside of a rendering: resets the count and culls, the render graph orders the indirect draw after it */
+	static void recordCulling(VkRenderData& renderData, VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+	/* inside the rendering with pipeline, index and vertex buffers bound, draws every visible instance */
+	static void recordDraws(VkRenderData& renderData, VkCommandBuffer commandBuffer);
+	/* splits a world space mesh into meshlets and replaces the previous one, drawn once with the given texture */
+	static bool uploadClusters(VkRenderData& renderData, const VkMesh& mesh, uint32_t textureIndex);
+	/* outside of a rendering: writes the indices of the meshlets in view and facing the camera, ordered like recordCulling */
+	static void recordClusterCulling(VkRenderData& renderData, VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+	/* inside the rendering with the graphics pipeline and the texture table bound, rebinds set 1 and the buffers */
+	static void recordClusterDraws(VkRenderData& renderData, VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+	static void cleanup(VkRenderData& renderData);
+};
\ No newline at end of file
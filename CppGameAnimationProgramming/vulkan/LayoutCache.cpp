@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include "LayoutCache.h"
+#include "Logger.h"
+
+namespace {
+	// Init tasks and later pipeline builds may ask for layouts from several threads
+	std::mutex layoutMutex;
+
+	void appendKey(std::string& key, uint64_t value) {
+		key += std::to_string(value);
+		key += ',';
+	}
+
+	VkDescriptorSetLayout getSetLayoutLocked(VkRenderData& renderData, std::vector<VkDescriptorSetLayoutBinding> bindings) {
+		std::sort(bindings.begin(), bindings.end(),
+			[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+		// Runtime arrays become bindless tables, visible to all stages so every shader shares one layout
+		bool bindless = false;
+		for (VkDescriptorSetLayoutBinding& binding : bindings) {
+			if (binding.descriptorCount == 0) {
+				binding.stageFlags = VK_SHADER_STAGE_ALL;
+				bindless = true;
+			}
+		}
+		std::string key;
+		for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+			appendKey(key, binding.binding);
+			appendKey(key, binding.descriptorType);
+			appendKey(key, binding.descriptorCount);
+			appendKey(key, binding.stageFlags);
+		}
+		auto cached = renderData.rdDescriptorSetLayouts.find(key);
+		if (cached != renderData.rdDescriptorSetLayouts.end()) {
+			return cached->second;
+		}
+
+		std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size(), 0);
+		for (size_t i = 0; i < bindings.size(); ++i) {
+			if (bindings.at(i).descriptorCount == 0) {
+				bindings.at(i).descriptorCount = renderData.rdBindlessTextures.capacity;
+				// Slots are filled and replaced while the set is bound, unused ones stay empty
+				bindingFlags.at(i) = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+					VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+			}
+		}
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+		if (bindless) {
+			layoutInfo.pNext = &bindingFlagsInfo;
+			layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		}
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if (vkCreateDescriptorSetLayout(renderData.rdVkbDevice.device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not create descriptor set layout\n", __FUNCTION__);
+			return VK_NULL_HANDLE;
+		}
+		renderData.rdDescriptorSetLayouts.emplace(key, layout);
+		return layout;
+	}
+}
+
+VkDescriptorSetLayout LayoutCache::getDescriptorSetLayout(VkRenderData& renderData, std::vector<VkDescriptorSetLayoutBinding> bindings) {
+	std::lock_guard<std::mutex> lock(layoutMutex);
+	return getSetLayoutLocked(renderData, std::move(bindings));
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(VkRenderData& renderData, const std::vector<VkShaderReflection>& stages) {
+	// Merge per set, a binding used by several stages gets all their stage flags
+	std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets;
+	VkPushConstantRange pushConstants{};
+	uint32_t pushConstantEnd = 0;
+	for (const VkShaderReflection& stage : stages) {
+		for (const VkShaderBinding& shaderBinding : stage.bindings) {
+			std::vector<VkDescriptorSetLayoutBinding>& setBindings = sets[shaderBinding.set];
+			auto existing = std::find_if(setBindings.begin(), setBindings.end(),
+				[&shaderBinding](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == shaderBinding.layoutBinding.binding; });
+			if (existing == setBindings.end()) {
+				setBindings.push_back(shaderBinding.layoutBinding);
+				continue;
+			}
+			if (existing->descriptorType != shaderBinding.layoutBinding.descriptorType || existing->descriptorCount != shaderBinding.layoutBinding.descriptorCount) {
+				LOG(Vulkan, 1, "%s error: stages disagree on set %u binding %u\n", __FUNCTION__, shaderBinding.set, shaderBinding.layoutBinding.binding);
+				return VK_NULL_HANDLE;
+			}
+			existing->stageFlags |= shaderBinding.layoutBinding.stageFlags;
+		}
+		// One range for all stages, overlapping ranges with different stages are not allowed
+		for (const VkPushConstantRange& range : stage.pushConstants) {
+			pushConstants.offset = pushConstants.stageFlags == 0 ? range.offset : std::min(pushConstants.offset, range.offset);
+			pushConstantEnd = std::max(pushConstantEnd, range.offset + range.size);
+			pushConstants.stageFlags |= range.stageFlags;
+		}
+	}
+	pushConstants.size = pushConstantEnd - pushConstants.offset;
+
+	std::lock_guard<std::mutex> lock(layoutMutex);
+	// Unused set numbers below the highest one get an empty layout
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+	for (uint32_t set = 0; set < setCount; ++set) {
+		auto bindings = sets.find(set);
+		VkDescriptorSetLayout setLayout = getSetLayoutLocked(renderData,
+			bindings == sets.end() ? std::vector<VkDescriptorSetLayoutBinding>{} : bindings->second);
+		if (setLayout == VK_NULL_HANDLE) {
+			return VK_NULL_HANDLE;
+		}
+		setLayouts.push_back(setLayout);
+	}
+
+	std::string key;
+	for (VkDescriptorSetLayout setLayout : setLayouts) {
+		appendKey(key, reinterpret_cast<uint64_t>(setLayout));
+	}
+	key += '|';
+	appendKey(key, pushConstants.stageFlags);
+	appendKey(key, pushConstants.offset);
+	appendKey(key, pushConstants.size);
+	auto cached = renderData.rdPipelineLayouts.find(key);
+	if (cached != renderData.rdPipelineLayouts.end()) {
+		return cached->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstants.stageFlags != 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstants;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	if (vkCreatePipelineLayout(renderData.rdVkbDevice.device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create pipeline layout\n", __FUNCTION__);
+		return VK_NULL_HANDLE;
+	}
+	renderData.rdPipelineLayouts.emplace(key, pipelineLayout);
+	LOG(Vulkan, 2, "%s: new pipeline layout with %zu sets, %zu layouts cached\n", __FUNCTION__, setLayouts.size(), renderData.rdPipelineLayouts.size());
+	return pipelineLayout;
+}
+
+void LayoutCache::cleanup(VkRenderData& renderData) {
+	std::lock_guard<std::mutex> lock(layoutMutex);
+	for (auto& pipelineLayout : renderData.rdPipelineLayouts) {
+		vkDestroyPipelineLayout(renderData.rdVkbDevice.device, pipelineLayout.second, nullptr);
+	}
+	renderData.rdPipelineLayouts.clear();
+	for (auto& setLayout : renderData.rdDescriptorSetLayouts) {
+		vkDestroyDescriptorSetLayout(renderData.rdVkbDevice.device, setLayout.second, nullptr);
+	}
+	renderData.rdDescriptorSetLayouts.clear();
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* deduplicated descriptor set and pipeline layouts, pipelines with the same interface stay layout compatible */
+class LayoutCache {
+public:
+	/* identical binding lists return the same layout, owned by the cache
+	 * a descriptor count of 0 (a runtime array in the shader) is a bindless table sized by rdBindlessTextures */
+	static VkDescriptorSetLayout getDescriptorSetLayout(VkRenderData& renderData, std::vector<VkDescriptorSetLayoutBinding> bindings);
+	/* merges bindings and push constants of all stages, VK_NULL_HANDLE if the stages disagree */
+	static VkPipelineLayout getPipelineLayout(VkRenderData& renderData, const std::vector<VkShaderReflection>& stages);
+	static void cleanup(VkRenderData& renderData);
+};
\ No newline at end of file
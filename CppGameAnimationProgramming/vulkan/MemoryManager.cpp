@@ -0,0 +1,301 @@
+#include <array>
+#include "MemoryManager.h"
+#include "CommandBuffer.h"
+#include "DescriptorAllocator.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	constexpr double MEBIBYTE = 1024.0 * 1024.0;
+}
+
+bool MemoryManager::init(VkRenderData& renderData) {
+	VkMemoryData& memory = renderData.rdMemory;
+	memory.queueFamilies = { renderData.rdGraphicsQueueFamily, renderData.rdTransferQueueFamily };
+
+	// Recorded again for every pass, reset together with the pool
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = renderData.rdTransferQueueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	if (vkCreateCommandPool(renderData.rdVkbDevice.device, &poolInfo, nullptr, &memory.transferPool) != VK_SUCCESS ||
+		!CommandBuffer::init(renderData, memory.transferPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, memory.transferCommandBuffer)) {
+		LOG(Vulkan, 1, "%s error: could not create transfer command buffer\n", __FUNCTION__);
+		return false;
+	}
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(renderData.rdVkbDevice.device, &fenceInfo, nullptr, &memory.transferFence) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create transfer fence\n", __FUNCTION__);
+		return false;
+	}
+
+	updateBudgets(renderData);
+	for (size_t i = 0; i < memory.heapBudgets.size(); ++i) {
+		const VkHeapBudget& budget = memory.heapBudgets.at(i);
+		LOG(Vulkan, 1, "%s: heap %zu (%s) budget %.0f MiB\n", __FUNCTION__, i, budget.deviceLocal ? "device local" : "host",
+			budget.budget / MEBIBYTE);
+	}
+	LOG(Vulkan, 1, "%s: memory budget %s, defragmentation copies on the %s queue\n", __FUNCTION__,
+		memory.budgetExtension ? "from VK_EXT_memory_budget" : "estimated by VMA",
+		renderData.rdTransferQueue != renderData.rdGraphicsQueue ? "transfer" : "graphics");
+	return true;
+}
+
+void MemoryManager::updateBudgets(VkRenderData& renderData) {
+	VkMemoryData& memory = renderData.rdMemory;
+	const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+	vmaGetMemoryProperties(renderData.rdAllocator, &properties);
+	std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+	vmaGetHeapBudgets(renderData.rdAllocator, budgets.data());
+
+	memory.heapBudgets.resize(properties->memoryHeapCount);
+	memory.heapWarned.resize(properties->memoryHeapCount, false);
+	for (uint32_t i = 0; i < properties->memoryHeapCount; ++i) {
+		VkHeapBudget& budget = memory.heapBudgets.at(i);
+		budget.usage = budgets.at(i).usage;
+		budget.budget = budgets.at(i).budget;
+		budget.allocationBytes = budgets.at(i).statistics.allocationBytes;
+		budget.blockBytes = budgets.at(i).statistics.blockBytes;
+		budget.deviceLocal = (properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+}
+
+void MemoryManager::beginFrame(VkRenderData& renderData) {
+	PROFILE_FUNCTION();
+	VkMemoryData& memory = renderData.rdMemory;
+	// VMA refreshes the budget from the driver at most once per frame index
+	vmaSetCurrentFrameIndex(renderData.rdAllocator, static_cast<uint32_t>(renderData.rdFrameNumber));
+	updateBudgets(renderData);
+
+	for (uint32_t heap = 0; heap < memory.heapBudgets.size(); ++heap) {
+		const VkHeapBudget& budget = memory.heapBudgets.at(heap);
+		if (budget.budget == 0) {
+			continue;
+		}
+		double usage = static_cast<double>(budget.usage) / budget.budget;
+		// Logged once per crossing, not every frame
+		if (usage > VkMemoryData::WARNING_USAGE && !memory.heapWarned.at(heap)) {
+			LOG(Vulkan, 1, "%s warning: heap %u uses %.0f of %.0f MiB\n", __FUNCTION__, heap, budget.usage / MEBIBYTE, budget.budget / MEBIBYTE);
+		}
+		memory.heapWarned.at(heap) = usage > VkMemoryData::WARNING_USAGE;
+
+		// Retired memory is freed a frame later, the next check sees the result
+		if (usage > VkMemoryData::EVICTION_USAGE && renderData.rdFrameNumber > memory.lastEvictionFrame + 1) {
+			VkDeviceSize target = static_cast<VkDeviceSize>(budget.budget * static_cast<double>(VkMemoryData::WARNING_USAGE));
+			VkDeviceSize bytes = budget.usage - target;
+			VkDeviceSize freed = 0;
+			for (auto& handler : memory.evictionHandlers) {
+				if (freed >= bytes) {
+					break;
+				}
+				freed += handler(heap, bytes - freed);
+			}
+			memory.lastEvictionFrame = renderData.rdFrameNumber;
+			LOG(Vulkan, 1, "%s: heap %u over budget, evicted %.1f of %.1f MiB\n", __FUNCTION__, heap, freed / MEBIBYTE, bytes / MEBIBYTE);
+		}
+	}
+	updateDefragmentation(renderData);
+}
+
+void MemoryManager::updateDefragmentation(VkRenderData& renderData) {
+	VkMemoryData& memory = renderData.rdMemory;
+	// The copies of the last pass were submitted a frame ago, they are usually done
+	if (memory.passInFlight && !finishPass(renderData, false)) {
+		return;
+	}
+	if (memory.defragmentation == VK_NULL_HANDLE) {
+		if (renderData.rdFrameNumber < memory.lastDefragmentationFrame + VkMemoryData::DEFRAGMENTATION_INTERVAL) {
+			return;
+		}
+		memory.lastDefragmentationFrame = renderData.rdFrameNumber;
+		// Free space inside the blocks is what the moves can give back
+		VkDeviceSize freeBytes = 0;
+		for (size_t i = 0; i < memory.heapBudgets.size(); ++i) {
+			const VkHeapBudget& budget = memory.heapBudgets.at(i);
+			freeBytes += budget.blockBytes - budget.allocationBytes;
+			LOG(Vulkan, 2, "%s: heap %zu uses %.1f of %.1f MiB, %.1f MiB in %.1f MiB of blocks\n", __FUNCTION__, i,
+				budget.usage / MEBIBYTE, budget.budget / MEBIBYTE, budget.allocationBytes / MEBIBYTE, budget.blockBytes / MEBIBYTE);
+		}
+		if (freeBytes < VkMemoryData::DEFRAGMENTATION_MIN_FREE_BYTES || memory.movableBuffers.empty()) {
+			return;
+		}
+		VmaDefragmentationInfo defragmentationInfo{};
+		defragmentationInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+		defragmentationInfo.maxBytesPerPass = VkMemoryData::MAX_MOVE_BYTES_PER_FRAME;
+		defragmentationInfo.maxAllocationsPerPass = VkMemoryData::MAX_MOVES_PER_FRAME;
+		if (vmaBeginDefragmentation(renderData.rdAllocator, &defragmentationInfo, &memory.defragmentation) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not begin defragmentation\n", __FUNCTION__);
+			memory.defragmentation = VK_NULL_HANDLE;
+			return;
+		}
+		memory.passCount = 0;
+		LOG(Vulkan, 2, "%s: defragmenting, %.1f MiB free inside the blocks\n", __FUNCTION__, freeBytes / MEBIBYTE);
+	}
+	if (!beginPass(renderData)) {
+		endDefragmentation(renderData);
+	}
+}
+
+bool MemoryManager::beginPass(VkRenderData& renderData) {
+	VkMemoryData& memory = renderData.rdMemory;
+	if (memory.passCount++ >= VkMemoryData::MAX_PASSES_PER_RUN) {
+		return false;
+	}
+	memory.passInfo = VmaDefragmentationPassMoveInfo{};
+	VkResult result = vmaBeginDefragmentationPass(renderData.rdAllocator, memory.defragmentation, &memory.passInfo);
+	// Success means there is nothing left to move
+	if (result != VK_INCOMPLETE) {
+		return false;
+	}
+
+	VkDevice device = renderData.rdVkbDevice.device;
+	vkResetCommandPool(device, memory.transferPool, 0);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(memory.transferCommandBuffer, &beginInfo) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not begin transfer command buffer\n", __FUNCTION__);
+		return false;
+	}
+	// A copy of every registered buffer is created at its new place, the others stay where they are
+	memory.movedBuffers.assign(memory.passInfo.moveCount, VK_NULL_HANDLE);
+	uint32_t copyCount = 0;
+	for (uint32_t i = 0; i < memory.passInfo.moveCount; ++i) {
+		VmaDefragmentationMove& move = memory.passInfo.pMoves[i];
+		auto movable = memory.movableBuffers.find(move.srcAllocation);
+		if (movable == memory.movableBuffers.end()) {
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+		VkBuffer newBuffer = VK_NULL_HANDLE;
+		if (vkCreateBuffer(device, &movable->second.createInfo, nullptr, &newBuffer) != VK_SUCCESS ||
+			vmaBindBufferMemory(renderData.rdAllocator, move.dstTmpAllocation, newBuffer) != VK_SUCCESS) {
+			vkDestroyBuffer(device, newBuffer, nullptr);
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+		VkBufferCopy region{};
+		region.size = movable->second.createInfo.size;
+		vkCmdCopyBuffer(memory.transferCommandBuffer, *movable->second.buffer, newBuffer, 1, &region);
+		memory.movedBuffers.at(i) = newBuffer;
+		++copyCount;
+	}
+	if (vkEndCommandBuffer(memory.transferCommandBuffer) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not end transfer command buffer\n", __FUNCTION__);
+		return false;
+	}
+	if (copyCount == 0) {
+		return vmaEndDefragmentationPass(renderData.rdAllocator, memory.defragmentation, &memory.passInfo) == VK_INCOMPLETE;
+	}
+
+	// Frames keep drawing from the old buffers while the copies run
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &memory.transferCommandBuffer;
+	if (vkResetFences(device, 1, &memory.transferFence) != VK_SUCCESS ||
+		vkQueueSubmit(renderData.rdTransferQueue, 1, &submitInfo, memory.transferFence) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not submit defragmentation copies\n", __FUNCTION__);
+		return false;
+	}
+	memory.passInFlight = true;
+	LOG(Vulkan, 3, "%s: copying %u of %u proposed moves\n", __FUNCTION__, copyCount, memory.passInfo.moveCount);
+	return true;
+}
+
+bool MemoryManager::finishPass(VkRenderData& renderData, bool wait) {
+	VkMemoryData& memory = renderData.rdMemory;
+	VkDevice device = renderData.rdVkbDevice.device;
+	if (wait) {
+		vkWaitForFences(device, 1, &memory.transferFence, VK_TRUE, UINT64_MAX);
+	}
+	else if (vkGetFenceStatus(device, memory.transferFence) != VK_SUCCESS) {
+		return false;
+	}
+	memory.passInFlight = false;
+
+	// The frames reading the old buffers are complete, the owners switch to the copies
+	for (uint32_t i = 0; i < memory.passInfo.moveCount; ++i) {
+		VkBuffer newBuffer = memory.movedBuffers.at(i);
+		auto movable = memory.movableBuffers.find(memory.passInfo.pMoves[i].srcAllocation);
+		if (newBuffer == VK_NULL_HANDLE || movable == memory.movableBuffers.end()) {
+			continue;
+		}
+		DescriptorAllocator::invalidate(renderData, *movable->second.buffer);
+		vkDestroyBuffer(device, *movable->second.buffer, nullptr);
+		*movable->second.buffer = newBuffer;
+	}
+	memory.movedBuffers.clear();
+	// The allocation handles stay, VMA points them to the new memory and frees the old
+	if (vmaEndDefragmentationPass(renderData.rdAllocator, memory.defragmentation, &memory.passInfo) == VK_SUCCESS) {
+		endDefragmentation(renderData);
+	}
+	return true;
+}
+
+void MemoryManager::endDefragmentation(VkRenderData& renderData) {
+	VkMemoryData& memory = renderData.rdMemory;
+	if (memory.defragmentation == VK_NULL_HANDLE) {
+		return;
+	}
+	VmaDefragmentationStats stats{};
+	vmaEndDefragmentation(renderData.rdAllocator, memory.defragmentation, &stats);
+	memory.defragmentation = VK_NULL_HANDLE;
+	LOG(Vulkan, 2, "%s: moved %u allocations (%.1f MiB) in %u passes, released %u blocks (%.1f MiB)\n", __FUNCTION__,
+		stats.allocationsMoved, stats.bytesMoved / MEBIBYTE, memory.passCount, stats.deviceMemoryBlocksFreed, stats.bytesFreed / MEBIBYTE);
+}
+
+void MemoryManager::prepareMovableBuffer(VkRenderData& renderData, VkBufferCreateInfo& bufferInfo) {
+	VkMemoryData& memory = renderData.rdMemory;
+	bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	// Read by the transfer queue without an ownership transfer
+	if (memory.queueFamilies.at(0) != memory.queueFamilies.at(1)) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(memory.queueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = memory.queueFamilies.data();
+	}
+}
+
+void MemoryManager::registerMovableBuffer(VkRenderData& renderData, VkBuffer& buffer, VmaAllocation allocation, const VkBufferCreateInfo& bufferInfo) {
+	VkMovableBuffer movable{};
+	movable.buffer = &buffer;
+	movable.createInfo = bufferInfo;
+	movable.createInfo.pNext = nullptr;
+	renderData.rdMemory.movableBuffers[allocation] = movable;
+}
+
+void MemoryManager::unregisterMovableBuffer(VkRenderData& renderData, VmaAllocation allocation) {
+	VkMemoryData& memory = renderData.rdMemory;
+	if (memory.movableBuffers.find(allocation) == memory.movableBuffers.end()) {
+		return;
+	}
+	// The owner retires the buffer afterwards, the submitted frame may still read the one that is replaced now
+	if (memory.passInFlight) {
+		if (renderData.rdFrameSubmitted &&
+			vkWaitForFences(renderData.rdVkbDevice.device, 1, &renderData.rdRenderFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: waiting for the frame fence failed\n", __FUNCTION__);
+		}
+		finishPass(renderData, true);
+	}
+	memory.movableBuffers.erase(allocation);
+}
+
+void MemoryManager::addEvictionHandler(VkRenderData& renderData, std::function<VkDeviceSize(uint32_t heapIndex, VkDeviceSize bytes)> handler) {
+	renderData.rdMemory.evictionHandlers.push_back(std::move(handler));
+}
+
+std::vector<VkHeapBudget> MemoryManager::getHeapBudgets(VkRenderData& renderData) {
+	return renderData.rdMemory.heapBudgets;
+}
+
+void MemoryManager::cleanup(VkRenderData& renderData) {
+	VkMemoryData& memory = renderData.rdMemory;
+	if (memory.passInFlight) {
+		finishPass(renderData, true);
+	}
+	endDefragmentation(renderData);
+	vkDestroyFence(renderData.rdVkbDevice.device, memory.transferFence, nullptr);
+	vkDestroyCommandPool(renderData.rdVkbDevice.device, memory.transferPool, nullptr);
+	memory = VkMemoryData{};
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+#include "VkRenderData.h"
+
+/* heap budgets of the allocator, eviction before a heap runs out and incremental defragmentation
+ * the moved buffers are copied on the transfer queue, a few moves per frame */
+class MemoryManager {
+public:
+	/* transfer command pool and fence, needs VMA and the queues */
+	static bool init(VkRenderData& renderData);
+	/* call after the frame fence wait: reads the budgets, evicts, finishes the last defragmentation pass and starts the next */
+	static void beginFrame(VkRenderData& renderData);
+	/* adds transfer usage and the queue families the defragmentation copies need, before the buffer is created */
+	static void prepareMovableBuffer(VkRenderData& renderData, VkBufferCreateInfo& bufferInfo);
+	/* the defragmentation may replace buffer, the handle has to be read from there again every frame */
+	static void registerMovableBuffer(VkRenderData& renderData, VkBuffer& buffer, VmaAllocation allocation, const VkBufferCreateInfo& bufferInfo);
+	/* call before the buffer is destroyed or retired, waits for a copy of it in flight */
+	static void unregisterMovableBuffer(VkRenderData& renderData, VmaAllocation allocation);
+	/* called when a heap goes over VkMemoryData::EVICTION_USAGE of its budget */
+	static void addEvictionHandler(VkRenderData& renderData, std::function<VkDeviceSize(uint32_t heapIndex, VkDeviceSize bytes)> handler);
+	/* usage and budget of every heap, read in the last beginFrame */
+	static std::vector<VkHeapBudget> getHeapBudgets(VkRenderData& renderData);
+	/* waits for the copies in flight and stops the defragmentation */
+	static void cleanup(VkRenderData& renderData);
+private:
+	static void updateBudgets(VkRenderData& renderData);
+	static void updateDefragmentation(VkRenderData& renderData);
+	static bool beginPass(VkRenderData& renderData);
+	static bool finishPass(VkRenderData& renderData, bool wait);
+	static void endDefragmentation(VkRenderData& renderData);
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include <cstring>
+#include "OffscreenTarget.h"
+#include "CommandBuffer.h"
+#include "Logger.h"
+
+bool OffscreenTarget::init(VkRenderData& renderData, unsigned int width, unsigned int height) {
+	renderData.rdColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	renderData.rdRenderExtent = { width, height };
+
+	// Image, read back by a transfer after each pass
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = renderData.rdColorFormat;
+	imageInfo.extent = { width, height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VmaAllocationCreateInfo imageAllocInfo{};
+	imageAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	if (vmaCreateImage(renderData.rdAllocator, &imageInfo, &imageAllocInfo, &renderData.rdOffscreenImage, &renderData.rdOffscreenImageAlloc, nullptr) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not allocate offscreen color image\n", __FUNCTION__);
+		return false;
+	}
+
+	// Image view
+	VkImageViewCreateInfo imageViewInfo{};
+	imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewInfo.image = renderData.rdOffscreenImage;
+	imageViewInfo.format = renderData.rdColorFormat;
+	imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageViewInfo.subresourceRange.baseMipLevel = 0;
+	imageViewInfo.subresourceRange.levelCount = 1;
+	imageViewInfo.subresourceRange.baseArrayLayer = 0;
+	imageViewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(renderData.rdVkbDevice.device, &imageViewInfo, nullptr, &renderData.rdOffscreenImageView) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create offscreen color image view\n", __FUNCTION__);
+		return false;
+	}
+	LOG(Vulkan, 1, "%s: offscreen target %ux%u created\n", __FUNCTION__, width, height);
+	return true;
+}
+
+void OffscreenTarget::cleanup(VkRenderData& renderData) {
+	vkDestroyImageView(renderData.rdVkbDevice.device, renderData.rdOffscreenImageView, nullptr);
+	vmaDestroyImage(renderData.rdAllocator, renderData.rdOffscreenImage, renderData.rdOffscreenImageAlloc);
+	renderData.rdOffscreenImageView = VK_NULL_HANDLE;
+	renderData.rdOffscreenImage = VK_NULL_HANDLE;
+	renderData.rdOffscreenImageAlloc = VK_NULL_HANDLE;
+}
+
+bool OffscreenTarget::readPixels(VkRenderData& renderData, std::vector<unsigned char>& pixels) {
+	if (renderData.rdOffscreenImage == VK_NULL_HANDLE) {
+		LOG(Vulkan, 1, "%s error: no offscreen target, frames can only be read back in headless mode\n", __FUNCTION__);
+		return false;
+	}
+	VkExtent2D extent = renderData.rdRenderExtent;
+	VkDeviceSize readbackSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+	// Readback buffer
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = readbackSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	VmaAllocationCreateInfo bufferAllocInfo{};
+	bufferAllocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+	VkBuffer readbackBuffer;
+	VmaAllocation readbackBufferAlloc;
+	if (vmaCreateBuffer(renderData.rdAllocator, &bufferInfo, &bufferAllocInfo, &readbackBuffer, &readbackBufferAlloc, nullptr) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not allocate readback buffer\n", __FUNCTION__);
+		return false;
+	}
+
+	VkCommandBuffer readbackCommandBuffer;
+	if (!CommandBuffer::init(renderData, readbackCommandBuffer)) {
+		LOG(Vulkan, 1, "%s error: could not create readback command buffer\n", __FUNCTION__);
+		vmaDestroyBuffer(renderData.rdAllocator, readbackBuffer, readbackBufferAlloc);
+		return false;
+	}
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(readbackCommandBuffer, &beginInfo);
+
+	// The render graph leaves the image in TRANSFER_SRC, wait for its color writes
+	VkImageMemoryBarrier readBarrier{};
+	readBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	readBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	readBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	readBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	readBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	readBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	readBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	readBarrier.image = renderData.rdOffscreenImage;
+	readBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(readbackCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &readBarrier);
+
+	VkBufferImageCopy copyRegion{};
+	copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copyRegion.imageExtent = { extent.width, extent.height, 1 };
+	vkCmdCopyImageToBuffer(readbackCommandBuffer, renderData.rdOffscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &copyRegion);
+
+	// Make the transfer visible to the host
+	VkBufferMemoryBarrier hostBarrier{};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = readbackBuffer;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(readbackCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+	vkEndCommandBuffer(readbackCommandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence readbackFence;
+	vkCreateFence(renderData.rdVkbDevice.device, &fenceInfo, nullptr, &readbackFence);
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &readbackCommandBuffer;
+	bool result = vkQueueSubmit(renderData.rdGraphicsQueue, 1, &submitInfo, readbackFence) == VK_SUCCESS &&
+		vkWaitForFences(renderData.rdVkbDevice.device, 1, &readbackFence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+	if (result) {
+		void* data;
+		vmaMapMemory(renderData.rdAllocator, readbackBufferAlloc, &data);
+		vmaInvalidateAllocation(renderData.rdAllocator, readbackBufferAlloc, 0, VK_WHOLE_SIZE);
+		pixels.resize(static_cast<size_t>(readbackSize));
+		std::memcpy(pixels.data(), data, pixels.size());
+		vmaUnmapMemory(renderData.rdAllocator, readbackBufferAlloc);
+	} else {
+		LOG(Vulkan, 1, "%s error: offscreen readback failed\n", __FUNCTION__);
+	}
+
+	vkDestroyFence(renderData.rdVkbDevice.device, readbackFence, nullptr);
+	CommandBuffer::cleanup(renderData, readbackCommandBuffer);
+	vmaDestroyBuffer(renderData.rdAllocator, readbackBuffer, readbackBufferAlloc);
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* color image rendered to instead of a swapchain in headless mode */
+class OffscreenTarget {
+public:
+	static bool init(VkRenderData& renderData, unsigned int width, unsigned int height);
+	static void cleanup(VkRenderData& renderData);
+	/* copies the last rendered frame to tightly packed RGBA8 rows, waits for the GPU */
+	static bool readPixels(VkRenderData& renderData, std::vector<unsigned char>& pixels);
+};
\ No newline at end of file
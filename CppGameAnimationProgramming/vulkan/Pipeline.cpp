@@ -1,70 +1,59 @@
 #include <vector>
 #include <vkb/VkBootstrap.h>
 #include "Pipeline.h"
+#include "LayoutCache.h"
+#include "VertexFormat.h"
 #include "Logger.h"
-#include "Shader.h"
-
-bool Pipeline::init(VkRenderData& renderData, std::string vertexShaderFilename, std::string fragmentShaderFilename) {
-	// Pipeline layout
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &renderData.rdTextureLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	if (vkCreatePipelineLayout(renderData.rdVkbDevice.device, &pipelineLayoutInfo, nullptr, &renderData.rdPipelineLayout) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not create pipeline layout\n", __FUNCTION__);
-		return false;
-	}
 
-	// Shader
-	VkShaderModule vertexModule = Shader::loadShader(renderData.rdVkbDevice.device, vertexShaderFilename);
-	VkShaderModule fragmentModule = Shader::loadShader(renderData.rdVkbDevice.device, fragmentShaderFilename);
-	if (vertexModule == VK_NULL_HANDLE || fragmentModule == VK_NULL_HANDLE) {
-		Logger::log(1, "%s error: could not load shaders\n", __FUNCTION__);
+bool Pipeline::init(VkRenderData& renderData, const VkShaderStage& vertexShader, const VkShaderStage& fragmentShader) {
+	return create(renderData, vertexShader, fragmentShader, renderData.rdPipeline, renderData.rdPipelineLayout);
+}
+
+bool Pipeline::create(VkRenderData& renderData, const VkShaderStage& vertexShader, const VkShaderStage& fragmentShader,
+		VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, const VkSpecializationInfo* specializationInfo) {
+	// Pipeline layout, shared with every pipeline using the same descriptors and push constants
+	pipelineLayout = LayoutCache::getPipelineLayout(renderData, { vertexShader.reflection, fragmentShader.reflection });
+	if (pipelineLayout == VK_NULL_HANDLE) {
+		LOG(Vulkan, 1, "%s error: could not create pipeline layout\n", __FUNCTION__);
 		return false;
 	}
 
+	// Shader
 	VkPipelineShaderStageCreateInfo vertexStageInfo{};
 	vertexStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	vertexStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertexStageInfo.module = vertexModule;
+	vertexStageInfo.module = vertexShader.module;
 	vertexStageInfo.pName = "main";
+	vertexStageInfo.pSpecializationInfo = specializationInfo;
 
 	VkPipelineShaderStageCreateInfo fragmentStageInfo{};
 	fragmentStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragmentStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragmentStageInfo.module = fragmentModule;
+	fragmentStageInfo.module = fragmentShader.module;
 	fragmentStageInfo.pName = "main";
+	fragmentStageInfo.pSpecializationInfo = specializationInfo;
 
 	VkPipelineShaderStageCreateInfo shaderStagesInfo[] = { vertexStageInfo, fragmentStageInfo };
 
-	// Input description
+	// Input description, the attribute formats come from the vertex format and not from the shader types
+	std::vector<VkVertexInputAttributeDescription> attributes = vertexShader.reflection.inputs;
+	if (!VertexFormat::getAttributes(renderData.rdVertexFormat, attributes)) {
+		LOG(Vulkan, 1, "%s error: vertex shader inputs do not match the vertex format\n", __FUNCTION__);
+		return false;
+	}
+	uint32_t stride = VertexFormat::getStride(renderData.rdVertexFormat);
 	VkVertexInputBindingDescription mainBinding{};
 	mainBinding.binding = 0;
-	mainBinding.stride = sizeof(VkVertex);
+	mainBinding.stride = stride;
 	mainBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-	VkVertexInputAttributeDescription positionAttribute{};
-	positionAttribute.binding = 0;
-	positionAttribute.location = 0;
-	positionAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-	positionAttribute.offset = offsetof(VkVertex, position);
-
-	VkVertexInputAttributeDescription uvAttribute{};
-	uvAttribute.binding = 0;
-	uvAttribute.location = 1;
-	uvAttribute.format = VK_FORMAT_R32G32_SFLOAT;
-	uvAttribute.offset = offsetof(VkVertex, uv);
-
-	VkVertexInputAttributeDescription attributes[] = { positionAttribute, uvAttribute };
-
 	// Vertex input info
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
 	vertexInputInfo.pVertexBindingDescriptions = &mainBinding;
-	vertexInputInfo.vertexAttributeDescriptionCount = 2;
-	vertexInputInfo.pVertexAttributeDescriptions = attributes;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
 
 	// Input assembly
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
@@ -72,24 +61,11 @@ bool Pipeline::init(VkRenderData& renderData, std::string vertexShaderFilename,
 	inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
 
-	// Viewport
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(renderData.rdVkbSwapchain.extent.width);
-	viewport.height = static_cast<float>(renderData.rdVkbSwapchain.extent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	VkRect2D scissor{};
-	scissor.offset = { 0,0 };
-	scissor.extent = renderData.rdVkbSwapchain.extent;
-	
+	// Viewport and scissor are dynamic, only the count is baked in
 	VkPipelineViewportStateCreateInfo viewportStateInfo{};
 	viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportStateInfo.viewportCount = 1;
-	viewportStateInfo.pViewports = &viewport;
 	viewportStateInfo.scissorCount = 1;
-	viewportStateInfo.pScissors = &scissor;
 
 	// Rasterize
 	VkPipelineRasterizationStateCreateInfo rasterizerInfo{};
@@ -141,9 +117,17 @@ bool Pipeline::init(VkRenderData& renderData, std::string vertexShaderFilename,
 	dynStatesInfo.dynamicStateCount = static_cast<uint32_t>(dynStates.size());
 	dynStatesInfo.pDynamicStates = dynStates.data();
 
+	// Attachment formats, the render graph begins the rendering dynamically
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &renderData.rdColorFormat;
+	renderingInfo.depthAttachmentFormat = renderData.rdDepthFormat;
+
 	// Pipeline info
 	VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
 	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = &renderingInfo;
 	pipelineCreateInfo.stageCount = 2;
 	pipelineCreateInfo.pStages = shaderStagesInfo;
 	pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
@@ -154,25 +138,19 @@ bool Pipeline::init(VkRenderData& renderData, std::string vertexShaderFilename,
 	pipelineCreateInfo.pColorBlendState = &colorBlendingInfo;
 	pipelineCreateInfo.pDepthStencilState = &depthStencilInfo;
 	pipelineCreateInfo.pDynamicState = &dynStatesInfo;
-	pipelineCreateInfo.layout = renderData.rdPipelineLayout;
-	pipelineCreateInfo.renderPass = renderData.rdRenderpass;
-	pipelineCreateInfo.subpass = 0;
+	pipelineCreateInfo.layout = pipelineLayout;
+	pipelineCreateInfo.renderPass = VK_NULL_HANDLE;
 	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 
 	// Create pipeline
-	if (vkCreateGraphicsPipelines(renderData.rdVkbDevice.device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &renderData.rdPipeline) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not create rendering pipeline\n", __FUNCTION__);
-		vkDestroyPipelineLayout(renderData.rdVkbDevice.device, renderData.rdPipelineLayout, nullptr);
+	if (vkCreateGraphicsPipelines(renderData.rdVkbDevice.device, renderData.rdPipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create rendering pipeline\n", __FUNCTION__);
 		return false;
 	}
-
-	// Destroy shader modules after pipeline has been created
-	vkDestroyShaderModule(renderData.rdVkbDevice.device, fragmentModule, nullptr);
-	vkDestroyShaderModule(renderData.rdVkbDevice.device, vertexModule, nullptr);
 	return true;
 }
 
 void Pipeline::cleanup(VkRenderData& renderData) {
+	// The layout belongs to the LayoutCache
 	vkDestroyPipeline(renderData.rdVkbDevice.device, renderData.rdPipeline, nullptr);
-	vkDestroyPipelineLayout(renderData.rdVkbDevice.device, renderData.rdPipelineLayout, nullptr);
 }
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
-#include <string>
 #include <vulkan/vulkan.h>
 
 #include "VkRenderData.h"
 
 class Pipeline {
 public:
-	static bool init(VkRenderData& renderData, std::string vertexShaderFilename, std::string fragmentShaderFilename);
+	/* layout and vertex input come from the shader reflection, shader modules stay owned by the caller */
+	static bool init(VkRenderData& renderData, const VkShaderStage& vertexShader, const VkShaderStage& fragmentShader);
+	/* returns the handles instead of replacing the current ones, usable on a worker while rendering goes on
+	 * the specialization constants apply to both stages, IDs a stage does not use are ignored */
+	static bool create(VkRenderData& renderData, const VkShaderStage& vertexShader, const VkShaderStage& fragmentShader,
+		VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, const VkSpecializationInfo* specializationInfo = nullptr);
 	static void cleanup(VkRenderData& renderData);
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "PipelineCache.h"
+#include "Logger.h"
+
+namespace {
+	bool isCacheCompatible(VkRenderData& renderData, const std::vector<char>& cacheData) {
+		VkPipelineCacheHeaderVersionOne header{};
+		if (cacheData.size() < sizeof(header)) {
+			return false;
+		}
+		std::memcpy(&header, cacheData.data(), sizeof(header));
+		const VkPhysicalDeviceProperties& properties = renderData.rdVkbDevice.physical_device.properties;
+		return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+			std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
+
+bool PipelineCache::init(VkRenderData& renderData, std::string cacheFileName) {
+	std::vector<char> cacheData;
+	std::ifstream inFile(cacheFileName, std::ios::binary);
+	if (inFile.is_open()) {
+		cacheData.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+		inFile.close();
+	}
+	// A cache from another device or driver version is ignored
+	if (!cacheData.empty() && !isCacheCompatible(renderData, cacheData)) {
+		LOG(Vulkan, 1, "%s: pipeline cache '%s' does not match the device or driver, starting empty\n", __FUNCTION__, cacheFileName.c_str());
+		cacheData.clear();
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = cacheData.size();
+	cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+	if (vkCreatePipelineCache(renderData.rdVkbDevice.device, &cacheInfo, nullptr, &renderData.rdPipelineCache) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create pipeline cache\n", __FUNCTION__);
+		return false;
+	}
+	LOG(Vulkan, 1, "%s: pipeline cache created with %zu bytes of initial data\n", __FUNCTION__, cacheData.size());
+	return true;
+}
+
+void PipelineCache::cleanup(VkRenderData& renderData, std::string cacheFileName) {
+	if (renderData.rdPipelineCache == VK_NULL_HANDLE) {
+		return;
+	}
+	size_t cacheSize = 0;
+	std::vector<char> cacheData;
+	if (vkGetPipelineCacheData(renderData.rdVkbDevice.device, renderData.rdPipelineCache, &cacheSize, nullptr) == VK_SUCCESS && cacheSize > 0) {
+		cacheData.resize(cacheSize);
+		if (vkGetPipelineCacheData(renderData.rdVkbDevice.device, renderData.rdPipelineCache, &cacheSize, cacheData.data()) != VK_SUCCESS) {
+			cacheData.clear();
+		}
+	}
+	vkDestroyPipelineCache(renderData.rdVkbDevice.device, renderData.rdPipelineCache, nullptr);
+	renderData.rdPipelineCache = VK_NULL_HANDLE;
+
+	if (cacheData.empty()) {
+		return;
+	}
+	// Write to a temporary file first, an interrupted write must not leave a truncated cache
+	std::string tempFileName = cacheFileName + ".tmp";
+	std::ofstream outFile(tempFileName, std::ios::binary | std::ios::trunc);
+	if (!outFile.is_open()) {
+		LOG(Io, 1, "%s error: could not open pipeline cache file '%s'\n", __FUNCTION__, tempFileName.c_str());
+		return;
+	}
+	outFile.write(cacheData.data(), static_cast<std::streamsize>(cacheSize));
+	outFile.close();
+	if (outFile.fail()) {
+		LOG(Io, 1, "%s error: could not write pipeline cache file '%s'\n", __FUNCTION__, tempFileName.c_str());
+		std::remove(tempFileName.c_str());
+		return;
+	}
+	std::remove(cacheFileName.c_str());
+	if (std::rename(tempFileName.c_str(), cacheFileName.c_str()) != 0) {
+		LOG(Io, 1, "%s error: could not replace pipeline cache file '%s'\n", __FUNCTION__, cacheFileName.c_str());
+		return;
+	}
+	LOG(Vulkan, 1, "%s: saved %zu bytes of pipeline cache to '%s'\n", __FUNCTION__, cacheSize, cacheFileName.c_str());
+}
\ No newline at end of file
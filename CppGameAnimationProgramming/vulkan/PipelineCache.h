@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* pipeline cache persisted between runs, pre-warms pipeline creation */
+class PipelineCache {
+public:
+	/* starts from the cache file if it was written by the same device and driver */
+	static bool init(VkRenderData& renderData, std::string cacheFileName);
+	/* writes the cache back to disk and destroys it */
+	static void cleanup(VkRenderData& renderData, std::string cacheFileName);
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <vector>
+#include "PresentMode.h"
+#include "Logger.h"
+
+VkPresentModeKHR PresentMode::select(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkPresentPolicy policy) {
+	uint32_t modeCount = 0;
+	if (vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &modeCount, nullptr) != VK_SUCCESS || modeCount == 0) {
+		LOG(Vulkan, 1, "%s error: could not query present modes, using FIFO\n", __FUNCTION__);
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+	std::vector<VkPresentModeKHR> supportedModes(modeCount);
+	if (vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &modeCount, supportedModes.data()) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not query present modes, using FIFO\n", __FUNCTION__);
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+	for (VkPresentModeKHR mode : supportedModes) {
+		LOG(Vulkan, 2, "%s: surface supports %s\n", __FUNCTION__, getName(mode));
+	}
+
+	// FIFO is the only mode every surface has to support
+	std::vector<VkPresentModeKHR> preferredModes;
+	switch (policy) {
+	case VkPresentPolicy::VSync:
+		preferredModes = { VK_PRESENT_MODE_FIFO_KHR };
+		break;
+	case VkPresentPolicy::LowLatency:
+		preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+		break;
+	case VkPresentPolicy::LowestLatency:
+		preferredModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+		break;
+	}
+	for (VkPresentModeKHR mode : preferredModes) {
+		if (std::find(supportedModes.begin(), supportedModes.end(), mode) != supportedModes.end()) {
+			LOG(Vulkan, 1, "%s: policy '%s' selected %s\n", __FUNCTION__, getPolicyName(policy), getName(mode));
+			return mode;
+		}
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+const char* PresentMode::getName(VkPresentModeKHR presentMode) {
+	switch (presentMode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "FIFO_RELAXED";
+	default:
+		return "other";
+	}
+}
+
+const char* PresentMode::getPolicyName(VkPresentPolicy policy) {
+	switch (policy) {
+	case VkPresentPolicy::VSync:
+		return "vsync";
+	case VkPresentPolicy::LowLatency:
+		return "low-latency";
+	case VkPresentPolicy::LowestLatency:
+		return "lowest-latency";
+	}
+	return "unknown";
+}
\ No newline at end of file
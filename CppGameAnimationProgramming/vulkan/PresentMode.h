@@ -0,0 +1,12 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* present mode selection from a latency versus tearing policy */
+class PresentMode {
+public:
+	/* first mode of the policy that the surface supports, FIFO if the query fails */
+	static VkPresentModeKHR select(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkPresentPolicy policy);
+	static const char* getName(VkPresentModeKHR presentMode);
+	static const char* getPolicyName(VkPresentPolicy policy);
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "PresentWait.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	// Bounds a single wait, presents of a retired swapchain may never complete
+	constexpr uint64_t WAIT_TIMEOUT = 100000000;
+	constexpr unsigned int MAX_TIMEOUTS = 10;
+	// A few frames of queueing, more means the waits fell behind and new presents are skipped
+	constexpr size_t MAX_PENDING = 16;
+
+	struct PendingPresent {
+		VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+		uint64_t presentId = 0;
+		uint64_t inputTime = 0;
+	};
+
+	std::thread waitThread;
+	std::mutex waitMutex;
+	// Signals new presents to the thread and finished waits to releaseSwapchain
+	std::condition_variable waitCondition;
+	bool running = false;
+	std::deque<PendingPresent> pendingPresents;
+	VkSwapchainKHR waitingSwapchain = VK_NULL_HANDLE;
+	std::vector<float> completedLatencies;
+	std::atomic<bool> waitFailed{ false };
+
+	void waitLoop(VkDevice device, PFN_vkWaitForPresentKHR waitForPresent) {
+		unsigned int timeouts = 0;
+		std::unique_lock<std::mutex> lock(waitMutex);
+		while (true) {
+			waitCondition.wait(lock, [] { return !pendingPresents.empty() || !running; });
+			if (!running) {
+				return;
+			}
+			PendingPresent present = pendingPresents.front();
+			waitingSwapchain = present.swapchain;
+			lock.unlock();
+			VkResult result = waitForPresent(device, present.swapchain, present.presentId, WAIT_TIMEOUT);
+			uint64_t presentTime = Profiler::now();
+			lock.lock();
+			waitingSwapchain = VK_NULL_HANDLE;
+			waitCondition.notify_all();
+			if (result == VK_TIMEOUT && ++timeouts < MAX_TIMEOUTS) {
+				continue;
+			}
+			timeouts = 0;
+			// releaseSwapchain may have dropped it in the meantime
+			if (!pendingPresents.empty() && pendingPresents.front().presentId == present.presentId) {
+				pendingPresents.pop_front();
+			}
+			if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+				completedLatencies.push_back((presentTime - present.inputTime) / 1.0e6f);
+			}
+			else if (result != VK_TIMEOUT && result != VK_ERROR_OUT_OF_DATE_KHR) {
+				LOG(Vulkan, 1, "%s error: waiting for present %llu failed (%i), measuring until vkQueuePresentKHR returns\n", __FUNCTION__,
+					static_cast<unsigned long long>(present.presentId), result);
+				waitFailed.store(true, std::memory_order_relaxed);
+				pendingPresents.clear();
+			}
+		}
+	}
+}
+
+bool PresentWait::init(VkRenderData& renderData) {
+	VkPresentWaitData& presentWait = renderData.rdPresentWait;
+	if (!presentWait.supported) {
+		if (!renderData.rdHeadless) {
+			LOG(Vulkan, 1, "%s: no VK_KHR_present_wait, latency is measured until vkQueuePresentKHR returns\n", __FUNCTION__);
+		}
+		return true;
+	}
+	VkDevice device = renderData.rdVkbDevice.device;
+	presentWait.waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+	if (!presentWait.waitForPresent) {
+		LOG(Vulkan, 1, "%s error: could not load vkWaitForPresentKHR\n", __FUNCTION__);
+		presentWait.supported = false;
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		running = true;
+	}
+	waitFailed.store(false, std::memory_order_relaxed);
+	waitThread = std::thread(&waitLoop, device, presentWait.waitForPresent);
+	return true;
+}
+
+void PresentWait::cleanup(VkRenderData& renderData) {
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		running = false;
+		pendingPresents.clear();
+		completedLatencies.clear();
+	}
+	waitCondition.notify_all();
+	if (waitThread.joinable()) {
+		waitThread.join();
+	}
+	renderData.rdPresentWait.supported = false;
+}
+
+bool PresentWait::isActive(VkRenderData& renderData) {
+	return renderData.rdPresentWait.supported && !waitFailed.load(std::memory_order_relaxed);
+}
+
+uint64_t PresentWait::nextPresentId(VkRenderData& renderData) {
+	return renderData.rdPresentWait.nextPresentId++;
+}
+
+void PresentWait::track(VkRenderData& renderData, uint64_t presentId, uint64_t inputTime) {
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		if (pendingPresents.size() >= MAX_PENDING) {
+			return;
+		}
+		pendingPresents.push_back({ renderData.rdVkbSwapchain.swapchain, presentId, inputTime });
+	}
+	waitCondition.notify_all();
+}
+
+std::vector<float> PresentWait::getCompletedLatencies() {
+	std::lock_guard<std::mutex> lock(waitMutex);
+	std::vector<float> latencies;
+	latencies.swap(completedLatencies);
+	return latencies;
+}
+
+void PresentWait::releaseSwapchain(VkSwapchainKHR swapchain) {
+	std::unique_lock<std::mutex> lock(waitMutex);
+	pendingPresents.erase(std::remove_if(pendingPresents.begin(), pendingPresents.end(),
+		[swapchain](const PendingPresent& present) { return present.swapchain == swapchain; }), pendingPresents.end());
+	waitCondition.wait(lock, [swapchain] { return waitingSwapchain != swapchain; });
+}
\ No newline at end of file
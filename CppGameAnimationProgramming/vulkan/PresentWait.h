@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* time until the presentation engine shows a frame, a background thread waits for the present ids
+ * inactive unless the device enabled VK_KHR_present_id and VK_KHR_present_wait */
+class PresentWait {
+public:
+	/* an unsupported device only leaves it inactive, false on errors */
+	static bool init(VkRenderData& renderData);
+	static void cleanup(VkRenderData& renderData);
+	static bool isActive(VkRenderData& renderData);
+	/* value for VkPresentIdKHR of the next present */
+	static uint64_t nextPresentId(VkRenderData& renderData);
+	/* call after vkQueuePresentKHR accepted the present, inputTime in Profiler::now() nanoseconds */
+	static void track(VkRenderData& renderData, uint64_t presentId, uint64_t inputTime);
+	/* milliseconds from input to present of the frames shown since the last call */
+	static std::vector<float> getCompletedLatencies();
+	/* drops the pending presents of the swapchain and waits for a running wait on it, call before destroying it */
+	static void releaseSwapchain(VkSwapchainKHR swapchain);
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <vkb/VkBootstrap.h>
+#include "QueryPool.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+bool QueryPool::init(VkRenderData& renderData) {
+	VkQueryData& queries = renderData.rdQueries;
+
+	// Timestamps must be supported on the graphics queue, otherwise pass timing stays disabled
+	uint32_t graphicsQueueFamily = renderData.rdVkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+	uint32_t validBits = renderData.rdVkbDevice.queue_families.at(graphicsQueueFamily).timestampValidBits;
+	if (validBits == 0) {
+		LOG(Vulkan, 1, "%s: graphics queue has no timestamp support, GPU pass timing disabled\n", __FUNCTION__);
+		return true;
+	}
+	queries.timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+	queries.timestampPeriod = renderData.rdVkbDevice.physical_device.properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo timestampPoolInfo{};
+	timestampPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	timestampPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	timestampPoolInfo.queryCount = VkQueryData::FRAME_SLOTS * VkQueryData::MAX_PASSES * 2;
+	if (vkCreateQueryPool(renderData.rdVkbDevice.device, &timestampPoolInfo, nullptr, &queries.timestampPool) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create timestamp query pool\n", __FUNCTION__);
+		return false;
+	}
+
+	if (renderData.rdPipelineStatisticsSupported) {
+		VkQueryPoolCreateInfo statisticsPoolInfo{};
+		statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		statisticsPoolInfo.queryCount = VkQueryData::FRAME_SLOTS * VkQueryData::MAX_PASSES;
+		statisticsPoolInfo.pipelineStatistics = VkQueryData::STATISTICS;
+		if (vkCreateQueryPool(renderData.rdVkbDevice.device, &statisticsPoolInfo, nullptr, &queries.statisticsPool) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s: could not create pipeline statistics query pool, statistics disabled\n", __FUNCTION__);
+			queries.statisticsPool = VK_NULL_HANDLE;
+		}
+	}
+
+	LOG(Vulkan, 1, "%s: GPU pass timing enabled (%u valid bits, %f ns per tick, statistics %s)\n", __FUNCTION__,
+		validBits, queries.timestampPeriod, queries.statisticsPool != VK_NULL_HANDLE ? "on" : "off");
+	return true;
+}
+
+void QueryPool::cleanup(VkRenderData& renderData) {
+	vkDestroyQueryPool(renderData.rdVkbDevice.device, renderData.rdQueries.statisticsPool, nullptr);
+	vkDestroyQueryPool(renderData.rdVkbDevice.device, renderData.rdQueries.timestampPool, nullptr);
+	renderData.rdQueries.statisticsPool = VK_NULL_HANDLE;
+	renderData.rdQueries.timestampPool = VK_NULL_HANDLE;
+}
+
+void QueryPool::beginFrame(VkRenderData& renderData, VkCommandBuffer commandBuffer) {
+	VkQueryData& queries = renderData.rdQueries;
+	if (queries.timestampPool == VK_NULL_HANDLE) {
+		return;
+	}
+	uint32_t slot = queries.currentSlot;
+	if (queries.slotSubmitted.at(slot)) {
+		resolveSlot(renderData, slot);
+	}
+	queries.slotSubmitted.at(slot) = false;
+	queries.slotPassNames.at(slot).clear();
+	queries.passOpen = false;
+
+	vkCmdResetQueryPool(commandBuffer, queries.timestampPool, slot * VkQueryData::MAX_PASSES * 2, VkQueryData::MAX_PASSES * 2);
+	if (queries.statisticsPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, queries.statisticsPool, slot * VkQueryData::MAX_PASSES, VkQueryData::MAX_PASSES);
+	}
+}
+
+void QueryPool::beginPass(VkRenderData& renderData, VkCommandBuffer commandBuffer, const char* passName) {
+	VkQueryData& queries = renderData.rdQueries;
+	if (queries.timestampPool == VK_NULL_HANDLE || queries.passOpen) {
+		return;
+	}
+	uint32_t slot = queries.currentSlot;
+	std::vector<const char*>& passNames = queries.slotPassNames.at(slot);
+	if (passNames.size() == VkQueryData::MAX_PASSES) {
+		LOG(Vulkan, 4, "%s: more than %u passes, pass '%s' is not timed\n", __FUNCTION__, VkQueryData::MAX_PASSES, passName);
+		return;
+	}
+	uint32_t pass = static_cast<uint32_t>(passNames.size());
+	passNames.push_back(passName);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.timestampPool, (slot * VkQueryData::MAX_PASSES + pass) * 2);
+	if (queries.statisticsPool != VK_NULL_HANDLE) {
+		vkCmdBeginQuery(commandBuffer, queries.statisticsPool, slot * VkQueryData::MAX_PASSES + pass, 0);
+	}
+	queries.passOpen = true;
+}
+
+void QueryPool::endPass(VkRenderData& renderData, VkCommandBuffer commandBuffer) {
+	VkQueryData& queries = renderData.rdQueries;
+	if (!queries.passOpen) {
+		return;
+	}
+	uint32_t slot = queries.currentSlot;
+	uint32_t pass = static_cast<uint32_t>(queries.slotPassNames.at(slot).size()) - 1;
+
+	if (queries.statisticsPool != VK_NULL_HANDLE) {
+		vkCmdEndQuery(commandBuffer, queries.statisticsPool, slot * VkQueryData::MAX_PASSES + pass);
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries.timestampPool, (slot * VkQueryData::MAX_PASSES + pass) * 2 + 1);
+	queries.passOpen = false;
+}
+
+void QueryPool::endFrame(VkRenderData& renderData) {
+	VkQueryData& queries = renderData.rdQueries;
+	if (queries.timestampPool == VK_NULL_HANDLE) {
+		return;
+	}
+	uint32_t slot = queries.currentSlot;
+	queries.slotSubmitted.at(slot) = true;
+	queries.slotCpuTime.at(slot) = Profiler::now();
+	queries.currentSlot = (slot + 1) % VkQueryData::FRAME_SLOTS;
+}
+
+void QueryPool::resolveSlot(VkRenderData& renderData, uint32_t slot) {
+	VkQueryData& queries = renderData.rdQueries;
+	const std::vector<const char*>& passNames = queries.slotPassNames.at(slot);
+	uint32_t passCount = static_cast<uint32_t>(passNames.size());
+	if (passCount == 0) {
+		return;
+	}
+
+	// Value and availability per query, never wait for the GPU
+	std::vector<uint64_t> timestamps(passCount * 2 * 2);
+	VkResult result = vkGetQueryPoolResults(renderData.rdVkbDevice.device, queries.timestampPool,
+		slot * VkQueryData::MAX_PASSES * 2, passCount * 2, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+		2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		LOG(Vulkan, 1, "%s error: could not read timestamp queries (%i)\n", __FUNCTION__, result);
+		return;
+	}
+
+	// Three statistics plus availability per pass
+	std::vector<uint64_t> statistics;
+	if (queries.statisticsPool != VK_NULL_HANDLE) {
+		statistics.resize(passCount * 4);
+		result = vkGetQueryPoolResults(renderData.rdVkbDevice.device, queries.statisticsPool,
+			slot * VkQueryData::MAX_PASSES, passCount, statistics.size() * sizeof(uint64_t), statistics.data(),
+			4 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_SUCCESS && result != VK_NOT_READY) {
+			statistics.clear();
+		}
+	}
+
+	queries.passTimings.clear();
+	uint64_t frameStart = timestamps.at(0) & queries.timestampMask;
+	for (uint32_t pass = 0; pass < passCount; ++pass) {
+		if (timestamps.at(pass * 4 + 1) == 0 || timestamps.at(pass * 4 + 3) == 0) {
+			LOG(Vulkan, 4, "%s: timestamps of pass '%s' not available, dropped\n", __FUNCTION__, passNames.at(pass));
+			continue;
+		}
+		uint64_t passStart = timestamps.at(pass * 4) & queries.timestampMask;
+		uint64_t passEnd = timestamps.at(pass * 4 + 2) & queries.timestampMask;
+		uint64_t passNanoseconds = static_cast<uint64_t>(((passEnd - passStart) & queries.timestampMask) * static_cast<double>(queries.timestampPeriod));
+
+		VkGpuPassTiming timing{};
+		timing.name = passNames.at(pass);
+		timing.milliseconds = static_cast<float>(passNanoseconds / 1.0e6);
+		if (!statistics.empty() && statistics.at(pass * 4 + 3) != 0) {
+			timing.vertexInvocations = statistics.at(pass * 4);
+			timing.clippingPrimitives = statistics.at(pass * 4 + 1);
+			timing.fragmentInvocations = statistics.at(pass * 4 + 2);
+		}
+		queries.passTimings.push_back(timing);
+		LOG(Vulkan, 5, "%s: pass '%s' %f ms GPU\n", __FUNCTION__, timing.name, timing.milliseconds);
+
+		// GPU clock is not calibrated against the CPU clock, the frame is placed at its submit time
+		uint64_t offset = static_cast<uint64_t>(((passStart - frameStart) & queries.timestampMask) * static_cast<double>(queries.timestampPeriod));
+		uint64_t start = queries.slotCpuTime.at(slot) + offset;
+		Profiler::addGpuEvent(timing.name, start, start + passNanoseconds);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* per-pass GPU timestamps and optional pipeline statistics, read back without waiting */
+class QueryPool {
+public:
+	static bool init(VkRenderData& renderData);
+	static void cleanup(VkRenderData& renderData);
+	/* resolves the results of the slot about to be reused and resets it, call outside of a render pass */
+	static void beginFrame(VkRenderData& renderData, VkCommandBuffer commandBuffer);
+	/* passName must outlive the query results, use a string literal */
+	static void beginPass(VkRenderData& renderData, VkCommandBuffer commandBuffer, const char* passName);
+	static void endPass(VkRenderData& renderData, VkCommandBuffer commandBuffer);
+	/* call after the command buffer was submitted */
+	static void endFrame(VkRenderData& renderData);
+private:
+	static void resolveSlot(VkRenderData& renderData, uint32_t slot);
+};
\ No newline at end of file
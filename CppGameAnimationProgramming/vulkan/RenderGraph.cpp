@@ -0,0 +1,581 @@
+#include <algorithm>
+#include "RenderGraph.h"
+#include "DeletionQueue.h"
+#include "QueryPool.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	// Only writes have to be made available, read bits in a source access mask do nothing
+	constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT |
+		VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+	bool isDepthFormat(VkFormat format) {
+		return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+			format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	VkImageSubresourceRange subresourceRange(VkFormat format) {
+		VkImageAspectFlags aspect = isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		return { aspect, 0, 1, 0, 1 };
+	}
+
+	VkImageMemoryBarrier2 imageBarrier(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = subresourceRange(format);
+		return barrier;
+	}
+
+	bool rangesOverlap(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) {
+		return firstA <= lastB && firstB <= lastA;
+	}
+}
+
+void RenderGraph::reset() {
+	mResources.clear();
+	mPasses.clear();
+	mFinalBarriers.clear();
+	mExecutedPassCount = 0;
+}
+
+VkRenderGraphResource RenderGraph::importImage(const char* name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkImageLayout finalLayout) {
+	Resource resource{};
+	resource.name = name;
+	resource.isImage = true;
+	resource.image = image;
+	resource.view = view;
+	resource.format = format;
+	resource.extent = extent;
+	resource.initialLayout = initialLayout;
+	resource.finalLayout = finalLayout;
+	mResources.push_back(resource);
+	return static_cast<VkRenderGraphResource>(mResources.size() - 1);
+}
+
+VkRenderGraphResource RenderGraph::createImage(const char* name, VkFormat format, VkExtent2D extent) {
+	Resource resource{};
+	resource.name = name;
+	resource.isImage = true;
+	resource.transient = true;
+	resource.format = format;
+	resource.extent = extent;
+	mResources.push_back(resource);
+	return static_cast<VkRenderGraphResource>(mResources.size() - 1);
+}
+
+VkRenderGraphResource RenderGraph::importBuffer(const char* name, VkBuffer buffer) {
+	Resource resource{};
+	resource.name = name;
+	resource.buffer = buffer;
+	mResources.push_back(resource);
+	return static_cast<VkRenderGraphResource>(mResources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const char* name, std::function<bool(VkCommandBuffer)> record) {
+	Pass pass{};
+	pass.name = name;
+	pass.record = std::move(record);
+	mPasses.push_back(std::move(pass));
+	return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+RenderGraph::Access& RenderGraph::getAccess(uint32_t pass, VkRenderGraphResource resource) {
+	std::vector<Access>& accesses = mPasses.at(pass).accesses;
+	for (Access& access : accesses) {
+		if (access.resource == resource) {
+			return access;
+		}
+	}
+	Access access{};
+	access.resource = resource;
+	accesses.push_back(access);
+	return accesses.back();
+}
+
+void RenderGraph::readBuffer(uint32_t pass, VkRenderGraphResource buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access) {
+	Access& bufferAccess = getAccess(pass, buffer);
+	bufferAccess.stages |= stages;
+	bufferAccess.access |= access;
+	bufferAccess.read = true;
+}
+
+void RenderGraph::writeBuffer(uint32_t pass, VkRenderGraphResource buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access) {
+	Access& bufferAccess = getAccess(pass, buffer);
+	bufferAccess.stages |= stages;
+	bufferAccess.access |= access;
+	bufferAccess.write = true;
+}
+
+void RenderGraph::setColorAttachment(uint32_t pass, VkRenderGraphResource image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor) {
+	Attachment& attachment = mPasses.at(pass).colorAttachment;
+	attachment.image = image;
+	attachment.loadOp = loadOp;
+	attachment.clearValue.color = clearColor;
+	mResources.at(image).usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	Access& access = getAccess(pass, image);
+	access.stages |= VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	access.access |= VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+	access.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	access.write = true;
+	// Cleared or discarded contents do not depend on earlier passes
+	if (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) {
+		access.access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+		access.read = true;
+	}
+}
+
+void RenderGraph::setDepthAttachment(uint32_t pass, VkRenderGraphResource image, VkAttachmentLoadOp loadOp, float clearDepth) {
+	Attachment& attachment = mPasses.at(pass).depthAttachment;
+	attachment.image = image;
+	attachment.loadOp = loadOp;
+	attachment.clearValue.depthStencil = { clearDepth, 0 };
+	mResources.at(image).usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	// The depth test reads the attachment whatever the load op is
+	Access& access = getAccess(pass, image);
+	access.stages |= VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+	access.access |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	access.layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	access.write = true;
+	access.read = access.read || loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+}
+
+void RenderGraph::setSecondaryCommandBuffers(uint32_t pass) {
+	mPasses.at(pass).secondaryCommandBuffers = true;
+}
+
+void RenderGraph::markOutput(VkRenderGraphResource resource) {
+	mResources.at(resource).output = true;
+}
+
+uint32_t RenderGraph::getExecutedPassCount() {
+	return mExecutedPassCount;
+}
+
+bool RenderGraph::compile(VkRenderData& renderData) {
+	PROFILE_FUNCTION();
+	cullPasses();
+
+	// Lifetimes in pass order, culled passes do not keep a resource alive
+	for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex) {
+		if (mPasses.at(passIndex).culled) {
+			continue;
+		}
+		for (const Access& access : mPasses.at(passIndex).accesses) {
+			Resource& resource = mResources.at(access.resource);
+			resource.firstPass = std::min(resource.firstPass, passIndex);
+			resource.lastPass = std::max(resource.lastPass, passIndex);
+		}
+	}
+
+	std::vector<uint32_t> transientSlots;
+	std::vector<int32_t> aliasedPredecessors(mResources.size(), -1);
+	if (!allocateTransients(renderData, transientSlots, aliasedPredecessors)) {
+		return false;
+	}
+	for (size_t i = 0; i < transientSlots.size(); ++i) {
+		if (transientSlots.at(i) != UINT32_MAX) {
+			const TransientImage& transient = mTransientImages.at(transientSlots.at(i));
+			mResources.at(i).image = transient.image;
+			mResources.at(i).view = transient.view;
+		}
+	}
+
+	// Attachment contents nobody reads later are not written back to memory
+	for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex) {
+		Pass& pass = mPasses.at(passIndex);
+		for (Attachment* attachment : { &pass.colorAttachment, &pass.depthAttachment }) {
+			if (attachment->image == UINT32_MAX) {
+				continue;
+			}
+			bool readLater = mResources.at(attachment->image).output;
+			for (uint32_t laterPass = passIndex + 1; laterPass < mPasses.size() && !readLater; ++laterPass) {
+				if (mPasses.at(laterPass).culled) {
+					continue;
+				}
+				for (const Access& access : mPasses.at(laterPass).accesses) {
+					readLater = readLater || (access.resource == attachment->image && access.read);
+				}
+			}
+			attachment->storeOp = readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+	}
+
+	deriveBarriers(aliasedPredecessors);
+	return true;
+}
+
+void RenderGraph::cullPasses() {
+	// Walk back from the outputs, a pass is needed when it writes something a needed pass or an output reads
+	std::vector<bool> needed(mResources.size(), false);
+	for (size_t i = 0; i < mResources.size(); ++i) {
+		needed.at(i) = mResources.at(i).output;
+	}
+	mExecutedPassCount = 0;
+	for (size_t passIndex = mPasses.size(); passIndex-- > 0;) {
+		Pass& pass = mPasses.at(passIndex);
+		pass.culled = true;
+		for (const Access& access : pass.accesses) {
+			if (access.write && needed.at(access.resource)) {
+				pass.culled = false;
+			}
+		}
+		if (pass.culled) {
+			LOG(Vulkan, 5, "%s: pass '%s' culled, no output depends on it\n", __FUNCTION__, pass.name);
+			continue;
+		}
+		++mExecutedPassCount;
+		for (const Access& access : pass.accesses) {
+			if (access.read) {
+				needed.at(access.resource) = true;
+			}
+		}
+	}
+}
+
+bool RenderGraph::allocateTransients(VkRenderData& renderData, std::vector<uint32_t>& transientSlots, std::vector<int32_t>& aliasedPredecessors) {
+	// Transients in use this frame, in declaration order; the lifetimes decide the aliasing, so they are part of the signature
+	std::vector<uint32_t> transients;
+	std::string signature;
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		const Resource& resource = mResources.at(i);
+		if (!resource.transient || resource.firstPass == UINT32_MAX) {
+			continue;
+		}
+		if (resource.usage == 0) {
+			LOG(Vulkan, 1, "%s error: transient image '%s' is not used as an attachment\n", __FUNCTION__, resource.name);
+			return false;
+		}
+		transients.push_back(i);
+		signature += std::to_string(resource.format) + "," + std::to_string(resource.extent.width) + "x" + std::to_string(resource.extent.height) +
+			"," + std::to_string(resource.usage) + "," + std::to_string(resource.firstPass) + "-" + std::to_string(resource.lastPass) + ";";
+	}
+	transientSlots.assign(mResources.size(), UINT32_MAX);
+
+	if (signature != mTransientSignature || mTransientImages.size() != transients.size()) {
+		PROFILE_ZONE("createTransients");
+		releaseTransients(renderData, true);
+		VkDevice device = renderData.rdVkbDevice.device;
+		std::vector<VkMemoryRequirements> requirements(transients.size());
+		for (size_t i = 0; i < transients.size(); ++i) {
+			const Resource& resource = mResources.at(transients.at(i));
+			TransientImage transient{};
+			transient.format = resource.format;
+			transient.extent = resource.extent;
+			transient.usage = resource.usage;
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = resource.format;
+			imageInfo.extent = { resource.extent.width, resource.extent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = resource.usage;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+				LOG(Vulkan, 1, "%s error: could not create transient image '%s'\n", __FUNCTION__, resource.name);
+				return false;
+			}
+			vkGetImageMemoryRequirements(device, transient.image, &requirements.at(i));
+			mTransientImages.push_back(transient);
+		}
+
+		// Largest first, an image shares a block with others whose lifetimes it does not overlap
+		std::vector<size_t> order(transients.size());
+		for (size_t i = 0; i < order.size(); ++i) {
+			order.at(i) = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&requirements](size_t a, size_t b) {
+			return requirements.at(a).size > requirements.at(b).size;
+		});
+		std::vector<VkMemoryRequirements> blockRequirements;
+		std::vector<std::vector<size_t>> blockImages;
+		for (size_t i : order) {
+			const Resource& resource = mResources.at(transients.at(i));
+			uint32_t block = 0;
+			for (; block < blockRequirements.size(); ++block) {
+				bool compatible = (blockRequirements.at(block).memoryTypeBits & requirements.at(i).memoryTypeBits) != 0;
+				for (size_t other : blockImages.at(block)) {
+					const Resource& otherResource = mResources.at(transients.at(other));
+					compatible = compatible && !rangesOverlap(resource.firstPass, resource.lastPass, otherResource.firstPass, otherResource.lastPass);
+				}
+				if (compatible) {
+					break;
+				}
+			}
+			if (block == blockRequirements.size()) {
+				blockRequirements.push_back(requirements.at(i));
+				blockImages.emplace_back();
+			}
+			VkMemoryRequirements& blockRequirement = blockRequirements.at(block);
+			blockRequirement.size = std::max(blockRequirement.size, requirements.at(i).size);
+			blockRequirement.alignment = std::max(blockRequirement.alignment, requirements.at(i).alignment);
+			blockRequirement.memoryTypeBits &= requirements.at(i).memoryTypeBits;
+			blockImages.at(block).push_back(i);
+			mTransientImages.at(i).block = block;
+		}
+
+		VkDeviceSize totalSize = 0;
+		for (const VkMemoryRequirements& blockRequirement : blockRequirements) {
+			VmaAllocationCreateInfo allocInfo{};
+			allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+			allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			if (vmaAllocateMemory(renderData.rdAllocator, &blockRequirement, &allocInfo, &allocation, nullptr) != VK_SUCCESS) {
+				LOG(Vulkan, 1, "%s error: could not allocate %llu bytes of transient memory\n", __FUNCTION__,
+					static_cast<unsigned long long>(blockRequirement.size));
+				return false;
+			}
+			mTransientMemory.push_back(allocation);
+			totalSize += blockRequirement.size;
+		}
+
+		VkDeviceSize imageSize = 0;
+		for (size_t i = 0; i < mTransientImages.size(); ++i) {
+			TransientImage& transient = mTransientImages.at(i);
+			imageSize += requirements.at(i).size;
+			if (vmaBindImageMemory(renderData.rdAllocator, mTransientMemory.at(transient.block), transient.image) != VK_SUCCESS) {
+				LOG(Vulkan, 1, "%s error: could not bind transient image memory\n", __FUNCTION__);
+				return false;
+			}
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.image = transient.image;
+			viewInfo.format = transient.format;
+			viewInfo.subresourceRange = subresourceRange(transient.format);
+			if (vkCreateImageView(device, &viewInfo, nullptr, &transient.view) != VK_SUCCESS) {
+				LOG(Vulkan, 1, "%s error: could not create transient image view\n", __FUNCTION__);
+				return false;
+			}
+		}
+		mTransientSignature = signature;
+		LOG(Vulkan, 2, "%s: %zu transient images in %zu memory blocks, %llu of %llu bytes\n", __FUNCTION__, mTransientImages.size(),
+			mTransientMemory.size(), static_cast<unsigned long long>(totalSize), static_cast<unsigned long long>(imageSize));
+	}
+
+	for (size_t i = 0; i < transients.size(); ++i) {
+		transientSlots.at(transients.at(i)) = static_cast<uint32_t>(i);
+	}
+	// The previous user of the memory has to be done before an aliasing image is written
+	for (size_t i = 0; i < transients.size(); ++i) {
+		const Resource& resource = mResources.at(transients.at(i));
+		uint32_t latestEnd = 0;
+		for (size_t other = 0; other < transients.size(); ++other) {
+			const Resource& otherResource = mResources.at(transients.at(other));
+			if (other == i || mTransientImages.at(other).block != mTransientImages.at(i).block || otherResource.lastPass >= resource.firstPass) {
+				continue;
+			}
+			if (aliasedPredecessors.at(transients.at(i)) < 0 || otherResource.lastPass >= latestEnd) {
+				aliasedPredecessors.at(transients.at(i)) = static_cast<int32_t>(transients.at(other));
+				latestEnd = otherResource.lastPass;
+			}
+		}
+	}
+	return true;
+}
+
+void RenderGraph::releaseTransients(VkRenderData& renderData, bool retire) {
+	if (mTransientImages.empty() && mTransientMemory.empty()) {
+		return;
+	}
+	VkDevice device = renderData.rdVkbDevice.device;
+	VmaAllocator allocator = renderData.rdAllocator;
+	std::vector<TransientImage> images = mTransientImages;
+	std::vector<VmaAllocation> memory = mTransientMemory;
+	std::function<void()> destroyFunction = [device, allocator, images, memory]() {
+		for (const TransientImage& transient : images) {
+			vkDestroyImageView(device, transient.view, nullptr);
+			vkDestroyImage(device, transient.image, nullptr);
+		}
+		for (VmaAllocation allocation : memory) {
+			vmaFreeMemory(allocator, allocation);
+		}
+	};
+	// A submitted frame may still render into them
+	if (retire) {
+		DeletionQueue::push(renderData, destroyFunction);
+	}
+	else {
+		destroyFunction();
+	}
+	mTransientImages.clear();
+	mTransientMemory.clear();
+	mTransientSignature.clear();
+}
+
+void RenderGraph::deriveBarriers(const std::vector<int32_t>& aliasedPredecessors) {
+	std::vector<ResourceState> states(mResources.size());
+	for (size_t i = 0; i < mResources.size(); ++i) {
+		states.at(i).layout = mResources.at(i).initialLayout;
+	}
+
+	for (Pass& pass : mPasses) {
+		pass.memoryBarrier = VkMemoryBarrier2{};
+		pass.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		pass.imageBarriers.clear();
+		if (pass.culled) {
+			continue;
+		}
+		for (const Access& access : pass.accesses) {
+			const Resource& resource = mResources.at(access.resource);
+			ResourceState& state = states.at(access.resource);
+			if ((resource.isImage && resource.image == VK_NULL_HANDLE) || (!resource.isImage && resource.buffer == VK_NULL_HANDLE)) {
+				continue;
+			}
+
+			// Reads wait for the last write, writes also for the reads since then
+			VkPipelineStageFlags2 srcStages = state.writeStages;
+			VkAccessFlags2 srcAccess = state.writeAccess;
+			bool hazard = false;
+			if (access.write) {
+				srcStages |= state.readStages;
+				hazard = srcStages != 0;
+			}
+			else if (state.writeStages != 0) {
+				// Earlier reads were already made to wait for the same write
+				hazard = (access.stages & ~state.readStages) != 0 || (access.access & ~state.readAccess) != 0;
+			}
+
+			if (!resource.isImage) {
+				if (hazard) {
+					pass.memoryBarrier.srcStageMask |= srcStages;
+					pass.memoryBarrier.srcAccessMask |= srcAccess;
+					pass.memoryBarrier.dstStageMask |= access.stages;
+					pass.memoryBarrier.dstAccessMask |= access.access;
+				}
+			}
+			else if (hazard || state.layout != access.layout) {
+				// Discarded contents skip the layout transition
+				VkImageMemoryBarrier2 barrier = imageBarrier(resource.image, resource.format, access.read ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED, access.layout);
+				if (srcStages == 0 && aliasedPredecessors.at(access.resource) >= 0) {
+					const ResourceState& predecessor = states.at(aliasedPredecessors.at(access.resource));
+					srcStages = predecessor.writeStages | predecessor.readStages;
+					srcAccess = predecessor.writeAccess;
+				}
+				// First use this frame: the transition waits for the same stages, which chain to the submit wait semaphore
+				barrier.srcStageMask = srcStages != 0 ? srcStages : access.stages;
+				barrier.srcAccessMask = srcStages != 0 ? srcAccess : (access.access & WRITE_ACCESS);
+				barrier.dstStageMask = access.stages;
+				barrier.dstAccessMask = access.access;
+				pass.imageBarriers.push_back(barrier);
+				state.layout = access.layout;
+			}
+
+			if (access.write) {
+				state.writeStages = access.stages;
+				state.writeAccess = access.access & WRITE_ACCESS;
+				state.readStages = 0;
+				state.readAccess = 0;
+			}
+			else {
+				state.readStages |= access.stages;
+				state.readAccess |= access.access;
+			}
+		}
+	}
+
+	// Imported images are handed back in the layout their owner expects
+	for (size_t i = 0; i < mResources.size(); ++i) {
+		const Resource& resource = mResources.at(i);
+		const ResourceState& state = states.at(i);
+		if (!resource.isImage || resource.transient || resource.image == VK_NULL_HANDLE || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+			resource.finalLayout == state.layout) {
+			continue;
+		}
+		VkImageMemoryBarrier2 barrier = imageBarrier(resource.image, resource.format, state.layout, resource.finalLayout);
+		barrier.srcStageMask = state.writeStages | state.readStages;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		mFinalBarriers.push_back(barrier);
+	}
+}
+
+bool RenderGraph::execute(VkRenderData& renderData, VkCommandBuffer commandBuffer) {
+	PROFILE_FUNCTION();
+	for (Pass& pass : mPasses) {
+		if (pass.culled) {
+			continue;
+		}
+		bool memoryBarrier = pass.memoryBarrier.srcStageMask != 0;
+		if (memoryBarrier || !pass.imageBarriers.empty()) {
+			VkDependencyInfo dependencyInfo{};
+			dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			dependencyInfo.memoryBarrierCount = memoryBarrier ? 1 : 0;
+			dependencyInfo.pMemoryBarriers = &pass.memoryBarrier;
+			dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(pass.imageBarriers.size());
+			dependencyInfo.pImageMemoryBarriers = pass.imageBarriers.data();
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		}
+
+		QueryPool::beginPass(renderData, commandBuffer, pass.name);
+		bool rendering = pass.colorAttachment.image != UINT32_MAX || pass.depthAttachment.image != UINT32_MAX;
+		if (rendering) {
+			VkRenderingAttachmentInfo colorInfo{};
+			VkRenderingAttachmentInfo depthInfo{};
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.flags = pass.secondaryCommandBuffers ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+			renderingInfo.layerCount = 1;
+			for (const Attachment* attachment : { &pass.colorAttachment, &pass.depthAttachment }) {
+				if (attachment->image == UINT32_MAX) {
+					continue;
+				}
+				const Resource& resource = mResources.at(attachment->image);
+				bool depth = attachment == &pass.depthAttachment;
+				VkRenderingAttachmentInfo& info = depth ? depthInfo : colorInfo;
+				info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+				info.imageView = resource.view;
+				info.imageLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				info.loadOp = attachment->loadOp;
+				info.storeOp = attachment->storeOp;
+				info.clearValue = attachment->clearValue;
+				renderingInfo.renderArea.extent = resource.extent;
+				if (depth) {
+					renderingInfo.pDepthAttachment = &depthInfo;
+				}
+				else {
+					renderingInfo.colorAttachmentCount = 1;
+					renderingInfo.pColorAttachments = &colorInfo;
+				}
+			}
+			vkCmdBeginRendering(commandBuffer, &renderingInfo);
+		}
+		bool recorded = pass.record(commandBuffer);
+		if (rendering) {
+			vkCmdEndRendering(commandBuffer);
+		}
+		QueryPool::endPass(renderData, commandBuffer);
+		if (!recorded) {
+			LOG(Vulkan, 1, "%s error: could not record pass '%s'\n", __FUNCTION__, pass.name);
+			return false;
+		}
+	}
+
+	if (!mFinalBarriers.empty()) {
+		VkDependencyInfo dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(mFinalBarriers.size());
+		dependencyInfo.pImageMemoryBarriers = mFinalBarriers.data();
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	}
+	return true;
+}
+
+void RenderGraph::cleanup(VkRenderData& renderData) {
+	releaseTransients(renderData, false);
+	reset();
+}
\ No newline at end of file
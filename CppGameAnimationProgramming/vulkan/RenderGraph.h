@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+#include "VkRenderData.h"
+
+/* handle of a graph image or buffer, valid until the next reset */
+using VkRenderGraphResource = uint32_t;
+
+/* frame graph, declared again every frame: passes state what they read and write, the graph drops passes nothing
+ * of the outputs depends on, places one batched barrier in front of each pass and renders attachments with
+ * dynamic rendering; transient images of passes that do not overlap share memory, kept while the declaration is unchanged */
+class RenderGraph {
+public:
+	/* forgets the passes and resources of the last frame, the transient images stay allocated */
+	void reset();
+	/* image owned outside of the graph, in initialLayout before the first pass and left in finalLayout */
+	VkRenderGraphResource importImage(const char* name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkImageLayout finalLayout);
+	/* image only the passes of this frame use, created by compile */
+	VkRenderGraphResource createImage(const char* name, VkFormat format, VkExtent2D extent);
+	/* buffers are not transitioned, only ordered; a null buffer is allowed and never synchronized */
+	VkRenderGraphResource importBuffer(const char* name, VkBuffer buffer);
+	/* names must outlive the frame, use string literals; passes run in the order they are added */
+	uint32_t addPass(const char* name, std::function<bool(VkCommandBuffer)> record);
+	/* stages and access masks of a buffer use inside the pass, repeated uses are merged */
+	void readBuffer(uint32_t pass, VkRenderGraphResource buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access);
+	void writeBuffer(uint32_t pass, VkRenderGraphResource buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access);
+	/* the pass renders into the attachments, a pass reading LOAD attachments depends on their earlier writers */
+	void setColorAttachment(uint32_t pass, VkRenderGraphResource image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+	void setDepthAttachment(uint32_t pass, VkRenderGraphResource image, VkAttachmentLoadOp loadOp, float clearDepth = 1.0f);
+	/* the rendering of the pass only executes secondary command buffers, they inherit the attachment formats */
+	void setSecondaryCommandBuffers(uint32_t pass);
+	/* passes contributing to an output are kept, the others are culled */
+	void markOutput(VkRenderGraphResource resource);
+	/* culls passes, derives the barriers and binds the transient images */
+	bool compile(VkRenderData& renderData);
+	/* records every kept pass, each one is a query pass */
+	bool execute(VkRenderData& renderData, VkCommandBuffer commandBuffer);
+	/* passes kept by the last compile */
+	uint32_t getExecutedPassCount();
+	/* destroys the transient images, the GPU must be done with them */
+	void cleanup(VkRenderData& renderData);
+
+private:
+	struct Resource {
+		const char* name = nullptr;
+		bool isImage = false;
+		bool transient = false;
+		bool output = false;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageUsageFlags usage = 0;
+		// Kept passes using the resource, for the transient lifetimes
+		uint32_t firstPass = UINT32_MAX;
+		uint32_t lastPass = 0;
+	};
+
+	struct Access {
+		VkRenderGraphResource resource = 0;
+		VkPipelineStageFlags2 stages = 0;
+		VkAccessFlags2 access = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool write = false;
+		bool read = false;
+	};
+
+	struct Attachment {
+		VkRenderGraphResource image = UINT32_MAX;
+		VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		VkClearValue clearValue{};
+	};
+
+	struct Pass {
+		const char* name = nullptr;
+		std::function<bool(VkCommandBuffer)> record;
+		std::vector<Access> accesses;
+		Attachment colorAttachment{};
+		Attachment depthAttachment{};
+		bool secondaryCommandBuffers = false;
+		bool culled = false;
+		// Derived by compile, issued before the pass
+		VkMemoryBarrier2 memoryBarrier{};
+		std::vector<VkImageMemoryBarrier2> imageBarriers;
+	};
+
+	// Transient image bound to the start of a memory block, shared by images that are never alive together
+	struct TransientImage {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		VkImageUsageFlags usage = 0;
+		uint32_t block = 0;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+	};
+
+	// Last synchronized use of a resource while the barriers are derived
+	struct ResourceState {
+		VkPipelineStageFlags2 writeStages = 0;
+		VkAccessFlags2 writeAccess = 0;
+		VkPipelineStageFlags2 readStages = 0;
+		VkAccessFlags2 readAccess = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	std::vector<Resource> mResources;
+	std::vector<Pass> mPasses;
+	std::vector<VkImageMemoryBarrier2> mFinalBarriers;
+	uint32_t mExecutedPassCount = 0;
+	// Persist across frames
+	std::string mTransientSignature;
+	std::vector<TransientImage> mTransientImages;
+	std::vector<VmaAllocation> mTransientMemory;
+
+	Access& getAccess(uint32_t pass, VkRenderGraphResource resource);
+	void cullPasses();
+	bool allocateTransients(VkRenderData& renderData, std::vector<uint32_t>& transientSlots, std::vector<int32_t>& aliasedPredecessors);
+	void releaseTransients(VkRenderData& renderData, bool retire);
+	void deriveBarriers(const std::vector<int32_t>& aliasedPredecessors);
+};
\ No newline at end of file
@@ -1,9 +0,0 @@
-#pragma once
-#include <vulkan/vulkan.h>
-#include "VkRenderData.h"
-
-class Renderpass {
-public:
-	static bool init(VkRenderData& renderData);
-	static void cleanup(VkRenderData& renderData);
-};
\ No newline at end of file
@@ -1,13 +1,15 @@
+#include <cstring>
 #include <fstream>
 #include <vector>
 #include "Shader.h"
+#include "ShaderReflection.h"
 #include "Logger.h"
 #define _CRT_SECURE_NO_WARNINGS
 /*
 bool Shader::loadShaders(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
-	Logger::log(1, "%s: loading vertex shader '%s' and fragment shader '%s'\n", __FUNCTION__, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
+	LOG(Vulkan, 1, "%s: loading vertex shader '%s' and fragment shader '%s'\n", __FUNCTION__, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
 	if (!createShaderProgram(vertexShaderFileName, fragmentShaderFileName)) {
-		Logger::log(1, "%s error: shader program creation failed\n", __FUNCTION__);
+		LOG(Vulkan, 1, "%s error: shader program creation failed\n", __FUNCTION__);
 		return false;
 	}
 	return true;	
@@ -19,16 +21,16 @@ void Shader::use() {
 
 GLuint Shader::loadShader(std::string shaderFileName, GLuint shaderType) {
 	std::string shaderAsText = loadFileToString(shaderFileName);
-	Logger::log(4, "%s: loaded shader file '%s', size %i\n", __FUNCTION__, shaderFileName.c_str(), shaderAsText.size());
+	LOG(Vulkan, 4, "%s: loaded shader file '%s', size %i\n", __FUNCTION__, shaderFileName.c_str(), shaderAsText.size());
 	const char* shaderSource = shaderAsText.c_str();
 	GLuint shader = glCreateShader(shaderType);
 	glShaderSource(shader, 1, (const GLchar**)&shaderSource, 0);
 	glCompileShader(shader);
 	if (!checkCompileStats(shaderFileName, shader)) {
-		Logger::log(1, "%s error: compiling shader '%s' failed\n", __FUNCTION__, shaderFileName.c_str());
+		LOG(Vulkan, 1, "%s error: compiling shader '%s' failed\n", __FUNCTION__, shaderFileName.c_str());
 		return 0;
 	}
-	Logger::log(1, "%s: shader %#x loaded and compiled\n", __FUNCTION__, shader);
+	LOG(Vulkan, 1, "%s: shader %#x loaded and compiled\n", __FUNCTION__, shader);
 	return shader;
 }
 
@@ -48,14 +50,14 @@ bool Shader::createShaderProgram(std::string vertexShaderFileName, std::string f
 
 	// Checking
 	if (!checkLinkStats(vertexShaderFileName, fragmentShaderFileName, mShaderProgram)) {
-		Logger::log(1, "%s error: program linking from vertex shader '%s' / fragment shader '%s' failed\n", __FUNCTION__, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
+		LOG(Vulkan, 1, "%s error: program linking from vertex shader '%s' / fragment shader '%s' failed\n", __FUNCTION__, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
 		glDeleteShader(vertexShader);
 		glDeleteShader(fragmentShader);
 		return false;
 	}
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
-	Logger::log(1, "%s: shader program %#x successfully compiled from vertex shader '%s' and fragment shader '%s'\n", __FUNCTION__, mShaderProgram, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
+	LOG(Vulkan, 1, "%s: shader program %#x successfully compiled from vertex shader '%s' and fragment shader '%s'\n", __FUNCTION__, mShaderProgram, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
 	return true;
 }
 
@@ -73,8 +75,8 @@ bool Shader::checkCompileStats(std::string shaderFileName, GLuint shader) {
 		shaderLog = std::vector<char>(logMessageLength + 1);
 		glGetShaderInfoLog(shader, logMessageLength, &logMessageLength, shaderLog.data());
 		shaderLog.at(logMessageLength) = '\0';
-		Logger::log(1, "%s error: shader compile of shader '%s' failed\n", __FUNCTION__, shaderFileName.c_str());
-		Logger::log(1, "%s compile log:\n%s\n", __FUNCTION__, shaderLog.data());
+		LOG(Vulkan, 1, "%s error: shader compile of shader '%s' failed\n", __FUNCTION__, shaderFileName.c_str());
+		LOG(Vulkan, 1, "%s compile log:\n%s\n", __FUNCTION__, shaderLog.data());
 		return false;
 	}
 	return true;
@@ -90,30 +92,47 @@ bool Shader::checkLinkStats(std::string vertexShaderFileName, std::string fragme
 		programLog = std::vector<char>(logMessageLength + 1);
 		glGetProgramInfoLog(shaderProgram, logMessageLength, &logMessageLength, programLog.data());
 		programLog.at(logMessageLength) = '\0';
-		Logger::log(1, "%s error: program linking of shaders '%s' and '%s' failed\n", __FUNCTION__, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
-		Logger::log(1, "%s compile log:\n%s\n", __FUNCTION__, programLog.data());
+		LOG(Vulkan, 1, "%s error: program linking of shaders '%s' and '%s' failed\n", __FUNCTION__, vertexShaderFileName.c_str(), fragmentShaderFileName.c_str());
+		LOG(Vulkan, 1, "%s compile log:\n%s\n", __FUNCTION__, programLog.data());
 		return false;
 	}
 	return true;
 }
 */
 
-VkShaderModule Shader::loadShader(VkDevice device, std::string shaderFileName) {
-	std::string shaderAsText = loadFileToString(shaderFileName);
+bool Shader::loadShader(VkDevice device, std::string shaderFileName, VkShaderStage& shader, const std::vector<ShaderDefine>& defines) {
+	std::vector<uint32_t> spirv;
+	bool isSpirv = shaderFileName.size() > 4 && shaderFileName.compare(shaderFileName.size() - 4, 4, ".spv") == 0;
+	if (isSpirv) {
+		std::string shaderCode = loadFileToString(shaderFileName);
+		if (shaderCode.empty() || shaderCode.size() % sizeof(uint32_t) != 0) {
+			LOG(Vulkan, 1, "%s error: '%s' is not a SPIR-V file\n", __FUNCTION__, shaderFileName.c_str());
+			return false;
+		}
+		spirv.resize(shaderCode.size() / sizeof(uint32_t));
+		std::memcpy(spirv.data(), shaderCode.data(), shaderCode.size());
+	}
+	else if (!ShaderCompiler::loadSpirv(shaderFileName, defines, spirv)) {
+		return false;
+	}
+	if (!ShaderReflection::reflect(spirv, shader.reflection)) {
+		LOG(Vulkan, 1, "%s error: could not reflect shader '%s'\n", __FUNCTION__, shaderFileName.c_str());
+		return false;
+	}
 	VkShaderModuleCreateInfo shaderCreateInfo{};
 	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderCreateInfo.codeSize = shaderAsText.size();
-	shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderAsText.c_str());
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(device, &shaderCreateInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-		Logger::log(1, "%s: could not load shader'%s'\n", __FUNCTION__, shaderFileName.c_str());
-		return VK_NULL_HANDLE;
+	shaderCreateInfo.codeSize = spirv.size() * sizeof(uint32_t);
+	shaderCreateInfo.pCode = spirv.data();
+	if (vkCreateShaderModule(device, &shaderCreateInfo, nullptr, &shader.module) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s: could not load shader'%s'\n", __FUNCTION__, shaderFileName.c_str());
+		return false;
 	}
-	return shaderModule;
+	return true;
 }
 
 std::string Shader::loadFileToString(std::string fileName) {
-	std::ifstream inFile(fileName);
+	// Binary mode, SPIR-V must not go through newline translation
+	std::ifstream inFile(fileName, std::ios::binary);
 	std::string str;
 	// Read shader file
 	if (inFile.is_open()) {
@@ -125,18 +144,18 @@ std::string Shader::loadFileToString(std::string fileName) {
 		inFile.close();
 	}
 	else {
-		Logger::log(1, "%s error: could not open file %s\n", __FUNCTION__, fileName.c_str());
+		LOG(Io, 1, "%s error: could not open file %s\n", __FUNCTION__, fileName.c_str());
 		return std::string();
 	}
 
 	if (inFile.bad() || inFile.fail()) {
-		Logger::log(1, "%s error: error while reading file %s\n", __FUNCTION__, fileName.c_str());
+		LOG(Io, 1, "%s error: error while reading file %s\n", __FUNCTION__, fileName.c_str());
 		inFile.close();
 		return std::string();
 	}
 
 	// Closing when good
 	inFile.close();
-	Logger::log(1, "%s: file %s successfully read to string\n", __FUNCTION__, fileName.c_str());
+	LOG(Io, 4, "%s: file %s successfully read to string\n", __FUNCTION__, fileName.c_str());
 	return str;
 }
\ No newline at end of file
@@ -19,11 +19,14 @@ private:
 };
 */
 #include <string>
+#include <vector>
 #include <vulkan/vulkan.h>
+#include "ShaderCompiler.h"
+#include "VkRenderData.h"
 
 class Shader {
 public:
-	static VkShaderModule loadShader(VkDevice device, std::string shaderFileName);
-private:
+	/* .spv files are used as is, GLSL sources are compiled through the shader cache; fills module and reflection */
+	static bool loadShader(VkDevice device, std::string shaderFileName, VkShaderStage& shader, const std::vector<ShaderDefine>& defines = {});
 	static std::string loadFileToString(std::string fileName);
 };
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <shaderc/shaderc.hpp>
+#include "ShaderCompiler.h"
+#include "Shader.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	const std::string CACHE_DIRECTORY = "shader/cache";
+	// Bump when the cache file layout or the compile options change
+	constexpr uint32_t CACHE_VERSION = 1;
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+	constexpr size_t MAX_INCLUDE_DEPTH = 32;
+
+	uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+		// FNV-1a, the key only has to tell sources apart
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	uint64_t hashString(uint64_t hash, const std::string& text) {
+		// Length first, so "ab" + "c" and "a" + "bc" differ
+		uint64_t length = text.size();
+		hash = hashBytes(hash, &length, sizeof(length));
+		return hashBytes(hash, text.data(), text.size());
+	}
+
+	std::string getDirectory(const std::string& fileName) {
+		size_t separator = fileName.find_last_of("/\\");
+		return separator == std::string::npos ? std::string() : fileName.substr(0, separator + 1);
+	}
+
+	bool fileExists(const std::string& fileName) {
+		std::ifstream inFile(fileName);
+		return inFile.is_open();
+	}
+
+	bool getShaderKind(const std::string& fileName, shaderc_shader_kind& kind) {
+		std::string extension = fileName.substr(fileName.find_last_of('.') + 1);
+		if (extension == "vert") {
+			kind = shaderc_glsl_vertex_shader;
+		}
+		else if (extension == "frag") {
+			kind = shaderc_glsl_fragment_shader;
+		}
+		else if (extension == "comp") {
+			kind = shaderc_glsl_compute_shader;
+		}
+		else if (extension == "geom") {
+			kind = shaderc_glsl_geometry_shader;
+		}
+		else if (extension == "tesc") {
+			kind = shaderc_glsl_tess_control_shader;
+		}
+		else if (extension == "tese") {
+			kind = shaderc_glsl_tess_evaluation_shader;
+		}
+		else {
+			return false;
+		}
+		return true;
+	}
+
+	/* names of all files included by the source, quoted and angle bracket form */
+	std::vector<std::string> findIncludes(const std::string& source) {
+		std::vector<std::string> includes;
+		size_t lineStart = 0;
+		while (lineStart < source.size()) {
+			size_t lineEnd = source.find('\n', lineStart);
+			if (lineEnd == std::string::npos) {
+				lineEnd = source.size();
+			}
+			size_t pos = source.find_first_not_of(" \t", lineStart);
+			if (pos < lineEnd && source.at(pos) == '#') {
+				pos = source.find_first_not_of(" \t", pos + 1);
+				if (pos < lineEnd && source.compare(pos, 7, "include") == 0) {
+					size_t nameStart = source.find_first_of("\"<", pos + 7);
+					if (nameStart < lineEnd) {
+						char closing = source.at(nameStart) == '"' ? '"' : '>';
+						size_t nameEnd = source.find(closing, nameStart + 1);
+						if (nameEnd < lineEnd) {
+							includes.push_back(source.substr(nameStart + 1, nameEnd - nameStart - 1));
+						}
+					}
+				}
+			}
+			lineStart = lineEnd + 1;
+		}
+		return includes;
+	}
+
+	bool hashIncludes(uint64_t& hash, const std::string& source, const std::string& fileName, const std::string& rootFileName,
+			std::set<std::string>& visited, size_t depth) {
+		if (depth > MAX_INCLUDE_DEPTH) {
+			LOG(Vulkan, 1, "%s error: includes nested deeper than %zu in '%s'\n", __FUNCTION__, MAX_INCLUDE_DEPTH, rootFileName.c_str());
+			return false;
+		}
+		for (const std::string& include : findIncludes(source)) {
+			std::string includeFileName = ShaderCompiler::resolveInclude(include, fileName, rootFileName);
+			if (includeFileName.empty()) {
+				LOG(Vulkan, 1, "%s error: '%s' included from '%s' not found\n", __FUNCTION__, include.c_str(), fileName.c_str());
+				return false;
+			}
+			hash = hashString(hash, includeFileName);
+			// Guarded headers are included more than once, their content only counts once
+			if (!visited.insert(includeFileName).second) {
+				continue;
+			}
+			std::string includeSource = Shader::loadFileToString(includeFileName);
+			hash = hashString(hash, includeSource);
+			if (!hashIncludes(hash, includeSource, includeFileName, rootFileName, visited, depth + 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	class FileIncluder : public shaderc::CompileOptions::IncluderInterface {
+	public:
+		explicit FileIncluder(std::string rootFileName) : mRootFileName(std::move(rootFileName)) {}
+
+		shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type,
+				const char* requestingSource, size_t) override {
+			IncludeData* data = new IncludeData();
+			data->name = ShaderCompiler::resolveInclude(requestedSource, requestingSource, mRootFileName);
+			if (data->name.empty()) {
+				data->content = std::string("cannot find include file '") + requestedSource + "'";
+			}
+			else {
+				data->content = Shader::loadFileToString(data->name);
+			}
+			data->result.source_name = data->name.c_str();
+			data->result.source_name_length = data->name.size();
+			data->result.content = data->content.c_str();
+			data->result.content_length = data->content.size();
+			data->result.user_data = data;
+			return &data->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result* result) override {
+			delete static_cast<IncludeData*>(result->user_data);
+		}
+
+	private:
+		struct IncludeData {
+			std::string name;
+			std::string content;
+			shaderc_include_result result{};
+		};
+		std::string mRootFileName;
+	};
+
+	/* queried from the loaded shaderc library, the headers may be older than the DLL
+	 * the SPIR-V generator word carries the glslang code generator version */
+	const std::array<uint32_t, 3>& getCompilerVersion() {
+		static const std::array<uint32_t, 3> version = []() {
+			unsigned int spirvVersion = 0;
+			unsigned int spirvRevision = 0;
+			shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+			uint32_t generator = 0;
+			shaderc::Compiler compiler;
+			shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv("#version 450\nvoid main() {}\n",
+				shaderc_glsl_vertex_shader, "version", shaderc::CompileOptions());
+			if (result.GetCompilationStatus() == shaderc_compilation_status_success && result.cend() - result.cbegin() > 2) {
+				generator = result.cbegin()[2];
+			}
+			else {
+				LOG(Vulkan, 1, "%s error: could not query the shader compiler version\n", __FUNCTION__);
+			}
+			return std::array<uint32_t, 3>{ spirvVersion, spirvRevision, generator };
+		}();
+		return version;
+	}
+
+	bool readCacheFile(const std::string& cacheFileName, std::vector<uint32_t>& spirv) {
+		std::ifstream inFile(cacheFileName, std::ios::binary | std::ios::ate);
+		if (!inFile.is_open()) {
+			return false;
+		}
+		std::streamsize size = inFile.tellg();
+		if (size < static_cast<std::streamsize>(sizeof(uint32_t)) || size % sizeof(uint32_t) != 0) {
+			return false;
+		}
+		inFile.seekg(0, std::ios::beg);
+		spirv.resize(static_cast<size_t>(size) / sizeof(uint32_t));
+		inFile.read(reinterpret_cast<char*>(spirv.data()), size);
+		// A damaged entry is compiled again and overwritten
+		return !inFile.fail() && spirv.front() == SPIRV_MAGIC;
+	}
+
+	void writeCacheFile(const std::string& cacheFileName, const std::vector<uint32_t>& spirv) {
+		std::error_code error;
+		std::filesystem::create_directories(CACHE_DIRECTORY, error);
+		// Per thread temporary name, two init tasks may compile the same shader at once
+		std::string tempFileName = cacheFileName + "." + std::to_string(JobSystem::getCurrentThreadIndex()) + ".tmp";
+		std::ofstream outFile(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!outFile.is_open()) {
+			LOG(Io, 1, "%s error: could not open shader cache file '%s'\n", __FUNCTION__, tempFileName.c_str());
+			return;
+		}
+		outFile.write(reinterpret_cast<const char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+		outFile.close();
+		if (outFile.fail()) {
+			LOG(Io, 1, "%s error: could not write shader cache file '%s'\n", __FUNCTION__, tempFileName.c_str());
+			std::remove(tempFileName.c_str());
+			return;
+		}
+		std::remove(cacheFileName.c_str());
+		if (std::rename(tempFileName.c_str(), cacheFileName.c_str()) != 0) {
+			std::remove(tempFileName.c_str());
+		}
+	}
+}
+
+bool ShaderCompiler::loadSpirv(std::string fileName, const std::vector<ShaderDefine>& defines, std::vector<uint32_t>& spirv) {
+	PROFILE_FUNCTION();
+	uint64_t cacheKey = getCacheKey(fileName, defines);
+	if (cacheKey == 0) {
+		return false;
+	}
+	char keyString[17];
+	std::snprintf(keyString, sizeof(keyString), "%016llx", static_cast<unsigned long long>(cacheKey));
+	std::string cacheFileName = CACHE_DIRECTORY + "/" + keyString + ".spv";
+	if (readCacheFile(cacheFileName, spirv)) {
+		LOG(Vulkan, 2, "%s: '%s' loaded from shader cache\n", __FUNCTION__, fileName.c_str());
+		return true;
+	}
+
+	if (!compile(fileName, defines, spirv)) {
+		return false;
+	}
+	writeCacheFile(cacheFileName, spirv);
+	return true;
+}
+
+bool ShaderCompiler::compile(std::string fileName, const std::vector<ShaderDefine>& defines, std::vector<uint32_t>& spirv) {
+	PROFILE_FUNCTION();
+	uint64_t startTime = Profiler::now();
+	shaderc_shader_kind kind;
+	if (!getShaderKind(fileName, kind)) {
+		LOG(Vulkan, 1, "%s error: unknown shader stage for '%s'\n", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+	std::string source = Shader::loadFileToString(fileName);
+	if (source.empty()) {
+		return false;
+	}
+
+	shaderc::CompileOptions options;
+	for (const ShaderDefine& define : defines) {
+		options.AddMacroDefinition(define.name, define.value);
+	}
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+#ifdef NDEBUG
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+#else
+	options.SetGenerateDebugInfo();
+#endif
+	options.SetIncluder(std::make_unique<FileIncluder>(fileName));
+
+	// One compiler per call, the init tasks compile shaders in parallel
+	shaderc::Compiler compiler;
+	if (!compiler.IsValid()) {
+		LOG(Vulkan, 1, "%s error: could not create shader compiler\n", __FUNCTION__);
+		return false;
+	}
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, kind, fileName.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+		LOG(Vulkan, 1, "%s error: compiling '%s' failed:\n%s\n", __FUNCTION__, fileName.c_str(), result.GetErrorMessage().c_str());
+		return false;
+	}
+	spirv.assign(result.cbegin(), result.cend());
+	LOG(Vulkan, 1, "%s: compiled '%s' to %zu bytes of SPIR-V in %.2f ms\n", __FUNCTION__, fileName.c_str(),
+		spirv.size() * sizeof(uint32_t), (Profiler::now() - startTime) / 1.0e6);
+	return true;
+}
+
+uint64_t ShaderCompiler::getCacheKey(std::string fileName, const std::vector<ShaderDefine>& defines) {
+	std::string source = Shader::loadFileToString(fileName);
+	if (source.empty()) {
+		return 0;
+	}
+	uint64_t hash = 0xcbf29ce484222325ull;
+	// Compiler version and the options that change the generated code
+	const std::array<uint32_t, 3>& compilerVersion = getCompilerVersion();
+	hash = hashBytes(hash, compilerVersion.data(), compilerVersion.size() * sizeof(uint32_t));
+	uint32_t compileOptions[] = { CACHE_VERSION, static_cast<uint32_t>(shaderc_env_version_vulkan_1_0),
+#ifdef NDEBUG
+		1
+#else
+		0
+#endif
+	};
+	hash = hashBytes(hash, compileOptions, sizeof(compileOptions));
+	for (const ShaderDefine& define : defines) {
+		hash = hashString(hash, define.name);
+		hash = hashString(hash, define.value);
+	}
+	hash = hashString(hash, fileName);
+	hash = hashString(hash, source);
+	std::set<std::string> visited;
+	if (!hashIncludes(hash, source, fileName, fileName, visited, 0)) {
+		return 0;
+	}
+	// 0 marks a failure
+	return hash == 0 ? 1 : hash;
+}
+
+std::string ShaderCompiler::resolveInclude(std::string requestedName, std::string requestingFileName, std::string rootFileName) {
+	std::string candidate = getDirectory(requestingFileName) + requestedName;
+	if (fileExists(candidate)) {
+		return candidate;
+	}
+	candidate = getDirectory(rootFileName) + requestedName;
+	if (fileExists(candidate)) {
+		return candidate;
+	}
+	return std::string();
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* preprocessor define passed to the GLSL compiler, an empty value defines the name only */
+struct ShaderDefine {
+	std::string name;
+	std::string value;
+};
+
+/* GLSL to SPIR-V at runtime, results are cached on disk by a hash of everything that affects the output */
+class ShaderCompiler {
+public:
+	/* cached SPIR-V if source, includes, defines and compiler version match, compiles and stores it otherwise */
+	static bool loadSpirv(std::string fileName, const std::vector<ShaderDefine>& defines, std::vector<uint32_t>& spirv);
+	/* always runs the compiler, the cache is neither read nor written */
+	static bool compile(std::string fileName, const std::vector<ShaderDefine>& defines, std::vector<uint32_t>& spirv);
+	/* cache key over the source file and all files it includes, 0 if a file cannot be read */
+	static uint64_t getCacheKey(std::string fileName, const std::vector<ShaderDefine>& defines);
+	/* include lookup shared by the cache key and the compiler: next to the including file, then next to the root shader */
+	static std::string resolveInclude(std::string requestedName, std::string requestingFileName, std::string rootFileName);
+};
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include "ShaderPermutations.h"
+#include "Shader.h"
+#include "Pipeline.h"
+#include "DeletionQueue.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	// Lookups come from the render loop, results from the workers
+	std::mutex variantMutex;
+	JobCounter buildCounter;
+	std::string vertexShaderFile;
+	std::string fragmentShaderFile;
+	std::string usageFile;
+	// Written back on cleanup, the next run builds these before they are needed
+	std::set<uint32_t> usedFeatures;
+	// Refused variants are reported once, getPipeline runs every frame
+	bool unavailableReported = false;
+
+	/* layout of the specialization constants, constant_id order in the shaders */
+	struct SpecializationData {
+		uint32_t jointInfluences = 4;
+		VkBool32 alphaTest = VK_FALSE;
+		float alphaCutoff = 0.5f;
+	};
+
+	void buildVariant(VkRenderData& renderData, uint32_t features, uint64_t generation) {
+		PROFILE_ZONE("buildShaderVariant");
+		std::vector<ShaderDefine> defines = ShaderPermutations::getDefines(features);
+
+		SpecializationData data{};
+		data.jointInfluences = 1u << ((features & VkShaderFeatures::JOINT_INFLUENCE_MASK) >> VkShaderFeatures::JOINT_INFLUENCE_SHIFT);
+		data.alphaTest = (features & VkShaderFeatures::ALPHA_TEST) ? VK_TRUE : VK_FALSE;
+		VkSpecializationMapEntry entries[] = {
+			{ 0, offsetof(SpecializationData, jointInfluences), sizeof(uint32_t) },
+			{ 1, offsetof(SpecializationData, alphaTest), sizeof(VkBool32) },
+			{ 2, offsetof(SpecializationData, alphaCutoff), sizeof(float) }
+		};
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = 3;
+		specializationInfo.pMapEntries = entries;
+		specializationInfo.dataSize = sizeof(SpecializationData);
+		specializationInfo.pData = &data;
+
+		VkDevice device = renderData.rdVkbDevice.device;
+		VkShaderStage vertexShader{};
+		VkShaderStage fragmentShader{};
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		bool result = Shader::loadShader(device, vertexShaderFile, vertexShader, defines) &&
+			Shader::loadShader(device, fragmentShaderFile, fragmentShader, defines) &&
+			Pipeline::create(renderData, vertexShader, fragmentShader, pipeline, pipelineLayout, &specializationInfo);
+		vkDestroyShaderModule(device, fragmentShader.module, nullptr);
+		vkDestroyShaderModule(device, vertexShader.module, nullptr);
+
+		std::lock_guard<std::mutex> lock(variantMutex);
+		auto variant = renderData.rdPipelineVariants.find(features);
+		// Built from sources that changed in the meantime, never used by a frame
+		if (generation != renderData.rdPipelineVariantGeneration || variant == renderData.rdPipelineVariants.end()) {
+			vkDestroyPipeline(device, pipeline, nullptr);
+			return;
+		}
+		variant->second.building = false;
+		if (!result) {
+			LOG(Vulkan, 1, "%s error: could not build shader variant %#x, using the default pipeline\n", __FUNCTION__, features);
+			variant->second.failed = true;
+			return;
+		}
+		variant->second.pipeline = pipeline;
+		variant->second.pipelineLayout = pipelineLayout;
+		LOG(Vulkan, 2, "%s: shader variant %#x ready\n", __FUNCTION__, features);
+	}
+
+	/* needs variantMutex */
+	void requestVariantLocked(VkRenderData& renderData, uint32_t features) {
+		VkPipelineVariant& variant = renderData.rdPipelineVariants[features];
+		variant.building = true;
+		uint64_t generation = renderData.rdPipelineVariantGeneration;
+		JobSystem::submit([&renderData, features, generation]() { buildVariant(renderData, features, generation); }, &buildCounter);
+	}
+}
+
+void ShaderPermutations::init(VkRenderData& renderData, std::string vertexShaderFileName, std::string fragmentShaderFileName,
+		std::string usageFileName) {
+	vertexShaderFile = vertexShaderFileName;
+	fragmentShaderFile = fragmentShaderFileName;
+	usageFile = usageFileName;
+
+	std::ifstream inFile(usageFile);
+	if (!inFile.is_open()) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(variantMutex);
+	std::string line;
+	while (std::getline(inFile, line)) {
+		if (line.empty() || line.front() == '#') {
+			continue;
+		}
+		uint32_t features = normalize(static_cast<uint32_t>(std::strtoul(line.c_str(), nullptr, 16)));
+		if (features == 0 || (features & VkShaderFeatures::UNAVAILABLE) || !usedFeatures.insert(features).second) {
+			continue;
+		}
+		requestVariantLocked(renderData, features);
+	}
+	LOG(Vulkan, 1, "%s: precompiling %zu shader variants from '%s'\n", __FUNCTION__, usedFeatures.size(), usageFile.c_str());
+}
+
+uint32_t ShaderPermutations::normalize(uint32_t features) {
+	features &= VkShaderFeatures::ALL;
+	// Influence count only exists in the skinned shader
+	if (!(features & VkShaderFeatures::SKINNED)) {
+		features &= ~VkShaderFeatures::JOINT_INFLUENCE_MASK;
+	}
+	return features;
+}
+
+std::vector<ShaderDefine> ShaderPermutations::getDefines(uint32_t features) {
+	std::vector<ShaderDefine> defines;
+	if (features & VkShaderFeatures::SKINNED) {
+		defines.push_back({ "SKINNED", "" });
+	}
+	return defines;
+}
+
+bool ShaderPermutations::getPipeline(VkRenderData& renderData, uint32_t features, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout) {
+	pipeline = renderData.rdPipeline;
+	pipelineLayout = renderData.rdPipelineLayout;
+	features = normalize(features);
+	if (features == 0) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(variantMutex);
+	// A pipeline reading unbound sets would fault the device, draw without the feature
+	if (features & VkShaderFeatures::UNAVAILABLE) {
+		if (!unavailableReported) {
+			LOG(Vulkan, 1, "%s error: shader features %#x need buffers the renderer does not bind, using the default pipeline\n",
+				__FUNCTION__, features & VkShaderFeatures::UNAVAILABLE);
+			unavailableReported = true;
+		}
+		return false;
+	}
+	auto variant = renderData.rdPipelineVariants.find(features);
+	if (variant == renderData.rdPipelineVariants.end()) {
+		usedFeatures.insert(features);
+		requestVariantLocked(renderData, features);
+		return false;
+	}
+	if (variant->second.pipeline == VK_NULL_HANDLE) {
+		return false;
+	}
+	pipeline = variant->second.pipeline;
+	pipelineLayout = variant->second.pipelineLayout;
+	return true;
+}
+
+void ShaderPermutations::invalidate(VkRenderData& renderData) {
+	std::lock_guard<std::mutex> lock(variantMutex);
+	VkDevice device = renderData.rdVkbDevice.device;
+	for (const auto& variant : renderData.rdPipelineVariants) {
+		VkPipeline pipeline = variant.second.pipeline;
+		if (pipeline != VK_NULL_HANDLE) {
+			DeletionQueue::push(renderData, [device, pipeline]() {
+				vkDestroyPipeline(device, pipeline, nullptr);
+			});
+		}
+	}
+	renderData.rdPipelineVariants.clear();
+	++renderData.rdPipelineVariantGeneration;
+}
+
+void ShaderPermutations::cleanup(VkRenderData& renderData) {
+	JobSystem::wait(buildCounter);
+	for (const auto& variant : renderData.rdPipelineVariants) {
+		vkDestroyPipeline(renderData.rdVkbDevice.device, variant.second.pipeline, nullptr);
+	}
+	renderData.rdPipelineVariants.clear();
+
+	if (usedFeatures.empty() || usageFile.empty()) {
+		return;
+	}
+	// Same temporary file and rename as the caches, a partial list would drop variants
+	std::string tempFileName = usageFile + ".tmp";
+	std::ofstream outFile(tempFileName, std::ios::trunc);
+	if (!outFile.is_open()) {
+		LOG(Io, 1, "%s error: could not open shader variant list '%s'\n", __FUNCTION__, tempFileName.c_str());
+		return;
+	}
+	outFile << "# shader feature masks used by earlier runs, built at startup\n";
+	for (uint32_t features : usedFeatures) {
+		char line[16];
+		std::snprintf(line, sizeof(line), "%x\n", features);
+		outFile << line;
+	}
+	outFile.close();
+	if (outFile.fail()) {
+		LOG(Io, 1, "%s error: could not write shader variant list '%s'\n", __FUNCTION__, tempFileName.c_str());
+		std::remove(tempFileName.c_str());
+		return;
+	}
+	std::remove(usageFile.c_str());
+	if (std::rename(tempFileName.c_str(), usageFile.c_str()) != 0) {
+		LOG(Io, 1, "%s error: could not replace shader variant list '%s'\n", __FUNCTION__, usageFile.c_str());
+		return;
+	}
+	LOG(Vulkan, 1, "%s: recorded %zu shader variants in '%s'\n", __FUNCTION__, usedFeatures.size(), usageFile.c_str());
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "ShaderCompiler.h"
+#include "VkRenderData.h"
+
+/* pipelines for combinations of VkShaderFeatures, compiled lazily on workers
+ * interface changes become defines, everything else specialization constants on the same SPIR-V */
+class ShaderPermutations {
+public:
+	/* variants recorded by earlier runs start building right away, needs the attachment formats and the default pipeline */
+	static void init(VkRenderData& renderData, std::string vertexShaderFileName, std::string fragmentShaderFileName,
+		std::string usageFileName);
+	/* clears bits without effect, like joint influences of an unskinned variant */
+	static uint32_t normalize(uint32_t features);
+	static std::vector<ShaderDefine> getDefines(uint32_t features);
+	/* false if the variant is not built yet or needs VkShaderFeatures::UNAVAILABLE, the default pipeline is returned instead */
+	static bool getPipeline(VkRenderData& renderData, uint32_t features, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout);
+	/* drops all variants after a shader change, they are rebuilt on the next use; main thread only */
+	static void invalidate(VkRenderData& renderData);
+	/* waits for running builds and records the used variants for the next run */
+	static void cleanup(VkRenderData& renderData);
+};
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstdint>
+#include <spirv_cross/spirv_cross.hpp>
+#include "ShaderReflection.h"
+#include "Logger.h"
+
+namespace {
+	bool getStage(spv::ExecutionModel model, VkShaderStageFlagBits& stage) {
+		switch (model) {
+		case spv::ExecutionModelVertex:
+			stage = VK_SHADER_STAGE_VERTEX_BIT;
+			return true;
+		case spv::ExecutionModelFragment:
+			stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+			return true;
+		case spv::ExecutionModelGLCompute:
+			stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			return true;
+		case spv::ExecutionModelGeometry:
+			stage = VK_SHADER_STAGE_GEOMETRY_BIT;
+			return true;
+		case spv::ExecutionModelTessellationControl:
+			stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			return true;
+		case spv::ExecutionModelTessellationEvaluation:
+			stage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	VkFormat getInputFormat(const spirv_cross::SPIRType& type) {
+		if (type.columns != 1 || type.vecsize < 1 || type.vecsize > 4) {
+			return VK_FORMAT_UNDEFINED;
+		}
+		static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+		switch (type.basetype) {
+		case spirv_cross::SPIRType::Float:
+			return floatFormats[type.vecsize - 1];
+		case spirv_cross::SPIRType::Int:
+			return intFormats[type.vecsize - 1];
+		case spirv_cross::SPIRType::UInt:
+			return uintFormats[type.vecsize - 1];
+		default:
+			return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	void addBindings(const spirv_cross::Compiler& compiler, const spirv_cross::SmallVector<spirv_cross::Resource>& resources,
+			VkDescriptorType descriptorType, VkShaderReflection& reflection) {
+		for (const spirv_cross::Resource& resource : resources) {
+			VkShaderBinding binding{};
+			binding.set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+			binding.layoutBinding.binding = compiler.get_decoration(resource.id, spv::DecorationBinding);
+			binding.layoutBinding.descriptorType = descriptorType;
+			binding.layoutBinding.stageFlags = reflection.stage;
+			// Arrays of resources take one descriptor per element, a runtime array reports 0
+			const spirv_cross::SPIRType& type = compiler.get_type(resource.type_id);
+			uint32_t count = 1;
+			for (uint32_t size : type.array) {
+				count *= size;
+			}
+			binding.layoutBinding.descriptorCount = count;
+			reflection.bindings.push_back(binding);
+		}
+	}
+}
+
+bool ShaderReflection::reflect(const std::vector<uint32_t>& spirv, VkShaderReflection& reflection) {
+	reflection = VkShaderReflection{};
+	// spirv-cross reports malformed modules by exception
+	try {
+		spirv_cross::Compiler compiler(spirv);
+		if (!getStage(compiler.get_execution_model(), reflection.stage)) {
+			LOG(Vulkan, 1, "%s error: unsupported shader stage\n", __FUNCTION__);
+			return false;
+		}
+		spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+
+		// Only vertex inputs become attributes, the other stages are fed by the previous one
+		if (reflection.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+			for (const spirv_cross::Resource& input : resources.stage_inputs) {
+				VkVertexInputAttributeDescription attribute{};
+				attribute.location = compiler.get_decoration(input.id, spv::DecorationLocation);
+				attribute.format = getInputFormat(compiler.get_type(input.type_id));
+				if (attribute.format == VK_FORMAT_UNDEFINED) {
+					LOG(Vulkan, 1, "%s error: unsupported type of vertex input '%s'\n", __FUNCTION__, input.name.c_str());
+					return false;
+				}
+				reflection.inputs.push_back(attribute);
+			}
+			std::sort(reflection.inputs.begin(), reflection.inputs.end(),
+				[](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) { return a.location < b.location; });
+		}
+
+		addBindings(compiler, resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, reflection);
+		addBindings(compiler, resources.storage_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reflection);
+		addBindings(compiler, resources.sampled_images, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, reflection);
+		addBindings(compiler, resources.separate_images, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, reflection);
+		addBindings(compiler, resources.separate_samplers, VK_DESCRIPTOR_TYPE_SAMPLER, reflection);
+		addBindings(compiler, resources.storage_images, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, reflection);
+		addBindings(compiler, resources.subpass_inputs, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, reflection);
+
+		for (const spirv_cross::Resource& pushConstant : resources.push_constant_buffers) {
+			// Only the members the shader reads, other stages may own the rest of the block
+			size_t begin = SIZE_MAX;
+			size_t end = 0;
+			for (const spirv_cross::BufferRange& range : compiler.get_active_buffer_ranges(pushConstant.id)) {
+				begin = std::min(begin, range.offset);
+				end = std::max(end, range.offset + range.range);
+			}
+			if (begin < end) {
+				reflection.pushConstants.push_back({ static_cast<VkShaderStageFlags>(reflection.stage),
+					static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin) });
+			}
+		}
+	}
+	catch (const spirv_cross::CompilerError& error) {
+		LOG(Vulkan, 1, "%s error: could not reflect shader: %s\n", __FUNCTION__, error.what());
+		return false;
+	}
+	LOG(Vulkan, 2, "%s: %zu inputs, %zu descriptor bindings, %zu push constant ranges\n", __FUNCTION__,
+		reflection.inputs.size(), reflection.bindings.size(), reflection.pushConstants.size());
+	return true;
+}
+
+uint32_t ShaderReflection::getFormatSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_R32_SFLOAT:
+	case VK_FORMAT_R32_SINT:
+	case VK_FORMAT_R32_UINT:
+		return 4;
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_R32G32_SINT:
+	case VK_FORMAT_R32G32_UINT:
+		return 8;
+	case VK_FORMAT_R32G32B32_SFLOAT:
+	case VK_FORMAT_R32G32B32_SINT:
+	case VK_FORMAT_R32G32B32_UINT:
+		return 12;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+	case VK_FORMAT_R32G32B32A32_SINT:
+	case VK_FORMAT_R32G32B32A32_UINT:
+		return 16;
+	default:
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* stage inputs, descriptor bindings and push constants of a SPIR-V module, via spirv-cross */
+class ShaderReflection {
+public:
+	static bool reflect(const std::vector<uint32_t>& spirv, VkShaderReflection& reflection);
+	/* bytes per element of a vertex attribute format, 0 if unsupported */
+	static uint32_t getFormatSize(VkFormat format);
+};
\ No newline at end of file
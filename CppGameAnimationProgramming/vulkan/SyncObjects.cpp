@@ -0,0 +1,27 @@
+#include "SyncObjects.h"
+#include "Logger.h"
+#include <vkb/VkBootstrap.h>
+
+bool SyncObjects::init(VkRenderData& renderData) {
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	// Signaled, the first frame must not wait
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	if (vkCreateSemaphore(renderData.rdVkbDevice.device, &semaphoreInfo, nullptr, &renderData.rdPresentSemaphore) != VK_SUCCESS ||
+		vkCreateSemaphore(renderData.rdVkbDevice.device, &semaphoreInfo, nullptr, &renderData.rdRenderSemaphore) != VK_SUCCESS ||
+		vkCreateFence(renderData.rdVkbDevice.device, &fenceInfo, nullptr, &renderData.rdRenderFence) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create sync objects\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+void SyncObjects::cleanup(VkRenderData& renderData) {
+	vkDestroySemaphore(renderData.rdVkbDevice.device, renderData.rdPresentSemaphore, nullptr);
+	vkDestroySemaphore(renderData.rdVkbDevice.device, renderData.rdRenderSemaphore, nullptr);
+	vkDestroyFence(renderData.rdVkbDevice.device, renderData.rdRenderFence, nullptr);
+}
\ No newline at end of file
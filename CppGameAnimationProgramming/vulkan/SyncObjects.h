@@ -5,5 +5,5 @@
 class SyncObjects {
 public:
 	static bool init(VkRenderData& renderData);
-	static bool cleanup(VkRenderData& renderData);
+	static void cleanup(VkRenderData& renderData);
 };
\ No newline at end of file
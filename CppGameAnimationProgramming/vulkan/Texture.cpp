@@ -1,68 +1,57 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
-#include <cstring>
-#include "CommandBuffer.h"
+#include <algorithm>
+#include <cstdint>
 #include "Texture.h"
 #include <Logger.h>
 
-bool Texture::loadTexture(VkRenderData& renderData, std::string textureFilename) {
-	// Texture data
+namespace {
+	// 2x2 box filter, the last row or column is repeated for odd sizes
+	std::vector<unsigned char> downsample(const std::vector<unsigned char>& pixels, uint32_t width, uint32_t height) {
+		uint32_t mipWidth = std::max(width / 2, 1u);
+		uint32_t mipHeight = std::max(height / 2, 1u);
+		std::vector<unsigned char> mip(static_cast<size_t>(mipWidth) * mipHeight * 4);
+		for (uint32_t y = 0; y < mipHeight; ++y) {
+			uint32_t y0 = std::min(y * 2, height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < mipWidth; ++x) {
+				uint32_t x0 = std::min(x * 2, width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				for (uint32_t c = 0; c < 4; ++c) {
+					uint32_t sum = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c] + pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+						pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c] + pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+					mip[(static_cast<size_t>(y) * mipWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		return mip;
+	}
+}
+
+bool Texture::decodeTexture(std::string textureFilename, VkTextureData& textureData) {
 	int texWidth;
 	int texHeight;
 	int numberOfChannels;
-	unsigned char* textureData = stbi_load(textureFilename.c_str(), &texWidth, &texHeight, &numberOfChannels, STBI_rgb_alpha);
-	if (!textureData) {
-		Logger::log(1, "%s error: could not load file '%s'\n", __FUNCTION__, textureFilename.c_str());
-		stbi_image_free(textureData);
-		return false;
-	}
-
-	// Image
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.extent.width = static_cast<uint32_t>(texWidth);
-	imageInfo.extent.height = static_cast<uint32_t>(texHeight);
-	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
-	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-	imageInfo.tiling = VK_IMAGE_TILING_LINEAR;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	VmaAllocationCreateInfo imageAllocInfo{};
-	imageAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-	if (vmaCreateImage(renderData.rdAllocator, &imageInfo, &imageAllocInfo, &renderData.rdTextureImage, &renderData.rdTextureImageAlloc, nullptr) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not allocate texture image via VMA\n", __FUNCTION__);
+	unsigned char* pixels = stbi_load(textureFilename.c_str(), &texWidth, &texHeight, &numberOfChannels, STBI_rgb_alpha);
+	if (!pixels) {
+		LOG(Io, 1, "%s error: could not load file '%s'\n", __FUNCTION__, textureFilename.c_str());
 		return false;
 	}
+	textureData.fileName = textureFilename;
+	textureData.width = texWidth;
+	textureData.height = texHeight;
+	textureData.channels = numberOfChannels;
+	textureData.mipLevels.clear();
+	textureData.mipLevels.emplace_back(pixels, pixels + static_cast<size_t>(texWidth) * texHeight * 4);
+	stbi_image_free(pixels);
 
-	// Staging buffer
-	VkBufferCreateInfo stagingBufferInfo{};
-	stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	stagingBufferInfo.size = imageSize;
-	stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	VkBuffer stagingBuffer;
-	VmaAllocation stagingBufferAlloc;
-	VmaAllocationCreateInfo stagingAllocInfo{};
-	stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-	if (vmaCreateBuffer(renderData.rdAllocator, &stagingBufferInfo, &stagingAllocInfo, &stagingBuffer, &stagingBufferAlloc, nullptr) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not allocate texture staging buffer via VMA\n", __FUNCTION__);
-		return false;
+	// The streaming uploads mips from here, generated once while decoding
+	uint32_t width = static_cast<uint32_t>(texWidth);
+	uint32_t height = static_cast<uint32_t>(texHeight);
+	while (width > 1 || height > 1) {
+		textureData.mipLevels.push_back(downsample(textureData.mipLevels.back(), width, height));
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
 	}
-
-	// Map texture data to stagingBufferAlloc
-	void* data;
-	vmaMapMemory(renderData.rdAllocator, stagingBufferAlloc, &data);
-	std::memcpy(data, textureData, static_cast<uint32_t>(imageSize));
-	vmaUnmapMemory(renderData.rdAllocator, stagingBufferAlloc);
-	stbi_image_free(textureData);
-
-}
-
-void Texture::cleanup(VkRenderData& renderData) {
-
+	return true;
 }
\ No newline at end of file
@@ -5,6 +5,6 @@
 
 class Texture {
 public:
-	static bool loadTexture(VkRenderData& renderData, std::string textureFilename);
-	static void cleanup(VkRenderData& renderData);
+	/* CPU only, safe to run on any thread before the device exists; builds the full mip chain, TextureStreaming uploads it */
+	static bool decodeTexture(std::string textureFilename, VkTextureData& textureData);
 };
\ No newline at end of file
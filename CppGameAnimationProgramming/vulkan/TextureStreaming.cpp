@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include "TextureStreaming.h"
+#include "BindlessTextures.h"
+#include "MemoryManager.h"
+#include "DeletionQueue.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	// Textures may be added by init tasks on several threads
+	std::mutex texturesMutex;
+
+	uint32_t getMipSize(uint32_t size, uint32_t mip) {
+		return std::max(size >> mip, 1u);
+	}
+}
+
+bool TextureStreaming::init(VkRenderData& renderData) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	// One sampler for every texture, the images only hold the resident mips
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	if (vkCreateSampler(renderData.rdVkbDevice.device, &samplerInfo, nullptr, &streaming.sampler) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create texture sampler\n", __FUNCTION__);
+		return false;
+	}
+
+	// Out of budget the least recently used textures give back their finer mips first
+	MemoryManager::addEvictionHandler(renderData, [&renderData](uint32_t heapIndex, VkDeviceSize bytes) -> VkDeviceSize {
+		if (heapIndex != renderData.rdTextureStreaming.heapIndex) {
+			return 0;
+		}
+		return evict(renderData, bytes, UINT64_MAX);
+	});
+	LOG(Vulkan, 1, "%s: texture budget %.0f MiB\n", __FUNCTION__, streaming.budget / (1024.0 * 1024.0));
+	return true;
+}
+
+VkDeviceSize TextureStreaming::getMipBytes(const VkStreamedTexture& texture, uint32_t firstMip, uint32_t endMip) {
+	VkDeviceSize bytes = 0;
+	for (uint32_t mip = firstMip; mip < endMip; ++mip) {
+		bytes += texture.mipLevels.at(mip).size();
+	}
+	return bytes;
+}
+
+bool TextureStreaming::createImage(VkRenderData& renderData, VkStreamedTexture& texture, uint32_t firstMip, VkImage& image,
+		VmaAllocation& imageAlloc, VkImageView& imageView) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = getMipSize(texture.width, firstMip);
+	imageInfo.extent.height = getMipSize(texture.height, firstMip);
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = static_cast<uint32_t>(texture.mipLevels.size()) - firstMip;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// Source of the kept mips when the residency changes again
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	VmaAllocationCreateInfo imageAllocInfo{};
+	imageAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	VmaAllocationInfo allocationInfo{};
+	if (vmaCreateImage(renderData.rdAllocator, &imageInfo, &imageAllocInfo, &image, &imageAlloc, &allocationInfo) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not allocate texture image via VMA\n", __FUNCTION__);
+		return false;
+	}
+	if (streaming.heapIndex == UINT32_MAX) {
+		const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+		vmaGetMemoryProperties(renderData.rdAllocator, &properties);
+		streaming.heapIndex = properties->memoryTypes[allocationInfo.memoryType].heapIndex;
+	}
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(renderData.rdVkbDevice.device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+		LOG(Vulkan, 1, "%s error: could not create image view for texture\n", __FUNCTION__);
+		vmaDestroyImage(renderData.rdAllocator, image, imageAlloc);
+		return false;
+	}
+	return true;
+}
+
+uint32_t TextureStreaming::addTexture(VkRenderData& renderData, VkTextureData textureData) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	if (textureData.mipLevels.empty()) {
+		LOG(Vulkan, 1, "%s error: texture '%s' has no pixels\n", __FUNCTION__, textureData.fileName.c_str());
+		return UINT32_MAX;
+	}
+	VkStreamedTexture texture{};
+	texture.fileName = textureData.fileName;
+	texture.width = static_cast<uint32_t>(textureData.width);
+	texture.height = static_cast<uint32_t>(textureData.height);
+	texture.mipLevels = std::move(textureData.mipLevels);
+	uint32_t mipCount = static_cast<uint32_t>(texture.mipLevels.size());
+	while (texture.minimumMip + 1 < mipCount && std::max(getMipSize(texture.width, texture.minimumMip),
+		getMipSize(texture.height, texture.minimumMip)) > VkTextureStreamingData::INITIAL_MIP_SIZE) {
+		++texture.minimumMip;
+	}
+
+	if (!createImage(renderData, texture, texture.minimumMip, texture.image, texture.imageAlloc, texture.imageView)) {
+		return UINT32_MAX;
+	}
+	// Slot in the texture table, draws pass the index instead of binding a set
+	uint32_t textureIndex = BindlessTextures::addTexture(renderData, texture.imageView, streaming.sampler);
+	if (textureIndex == UINT32_MAX) {
+		LOG(Vulkan, 1, "%s error: could not add texture to the texture table\n", __FUNCTION__);
+		vkDestroyImageView(renderData.rdVkbDevice.device, texture.imageView, nullptr);
+		vmaDestroyImage(renderData.rdAllocator, texture.image, texture.imageAlloc);
+		return UINT32_MAX;
+	}
+	texture.residentMip = texture.minimumMip;
+	texture.residentBytes = getMipBytes(texture, texture.minimumMip, mipCount);
+	texture.lastUsedFrame = renderData.rdFrameNumber;
+	texture.uploadPending = true;
+
+	// Nothing to keep, every resident mip comes from the CPU
+	VkTextureUpload upload{};
+	upload.textureIndex = textureIndex;
+	upload.firstMip = texture.minimumMip;
+	upload.firstKeptMip = mipCount;
+	upload.oldResidentMip = mipCount;
+	upload.image = texture.image;
+	LOG(Vulkan, 1, "%s: texture '%s' (%ux%u, %d channels) added with %u of %u mips resident\n", __FUNCTION__, texture.fileName.c_str(),
+		texture.width, texture.height, textureData.channels, mipCount - texture.minimumMip, mipCount);
+
+	std::lock_guard<std::mutex> lock(texturesMutex);
+	streaming.residentBytes += texture.residentBytes;
+	streaming.coarseBytes += texture.residentBytes;
+	streaming.textures.emplace(textureIndex, std::move(texture));
+	streaming.uploads.push_back(upload);
+	return textureIndex;
+}
+
+void TextureStreaming::requestScreenSize(VkRenderData& renderData, uint32_t textureIndex, float pixels) {
+	auto textureIter = renderData.rdTextureStreaming.textures.find(textureIndex);
+	if (textureIter == renderData.rdTextureStreaming.textures.end() || pixels <= 0.0f) {
+		return;
+	}
+	VkStreamedTexture& texture = textureIter->second;
+	// Finest mip with at least one texel per pixel
+	float texelsPerPixel = static_cast<float>(std::max(texture.width, texture.height)) / pixels;
+	uint32_t mip = 0;
+	if (texelsPerPixel > 1.0f) {
+		mip = std::min(static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel))), texture.minimumMip);
+	}
+	texture.requestedMip = std::min(texture.requestedMip, mip);
+	texture.lastUsedFrame = renderData.rdFrameNumber;
+}
+
+bool TextureStreaming::changeResidency(VkRenderData& renderData, uint32_t textureIndex, VkStreamedTexture& texture, uint32_t residentMip) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation imageAlloc = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	if (!createImage(renderData, texture, residentMip, image, imageAlloc, imageView)) {
+		return false;
+	}
+	uint32_t mipCount = static_cast<uint32_t>(texture.mipLevels.size());
+	VkTextureUpload upload{};
+	upload.textureIndex = textureIndex;
+	upload.firstMip = residentMip;
+	upload.firstKeptMip = std::max(residentMip, texture.residentMip);
+	upload.oldResidentMip = texture.residentMip;
+	upload.image = image;
+	upload.oldImage = texture.image;
+	upload.oldImageAlloc = texture.imageAlloc;
+	upload.oldImageView = texture.imageView;
+	streaming.uploads.push_back(upload);
+
+	LOG(Vulkan, 3, "%s: texture %u mips %u -> %u\n", __FUNCTION__, textureIndex, texture.residentMip, residentMip);
+	VkDeviceSize residentBytes = getMipBytes(texture, residentMip, mipCount);
+	streaming.residentBytes = streaming.residentBytes - texture.residentBytes + residentBytes;
+	texture.residentBytes = residentBytes;
+	texture.residentMip = residentMip;
+	texture.image = image;
+	texture.imageAlloc = imageAlloc;
+	texture.imageView = imageView;
+	texture.uploadPending = true;
+	// Called after the frame fence wait, no frame in flight samples the slot
+	BindlessTextures::updateTexture(renderData, textureIndex, imageView, streaming.sampler);
+	return true;
+}
+
+VkDeviceSize TextureStreaming::evict(VkRenderData& renderData, VkDeviceSize bytes, uint64_t usedSince) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	std::vector<uint32_t> order;
+	for (const auto& entry : streaming.textures) {
+		if (!entry.second.uploadPending && entry.second.residentMip < entry.second.minimumMip) {
+			order.push_back(entry.first);
+		}
+	}
+	std::sort(order.begin(), order.end(), [&streaming](uint32_t a, uint32_t b) {
+		uint64_t lastUsedA = streaming.textures.at(a).lastUsedFrame;
+		uint64_t lastUsedB = streaming.textures.at(b).lastUsedFrame;
+		return lastUsedA != lastUsedB ? lastUsedA < lastUsedB : a < b;
+	});
+
+	VkDeviceSize freed = 0;
+	for (uint32_t textureIndex : order) {
+		if (freed >= bytes) {
+			break;
+		}
+		VkStreamedTexture& texture = streaming.textures.at(textureIndex);
+		// Textures still in view keep the mips they asked for
+		uint32_t keptMip = texture.minimumMip;
+		if (texture.lastUsedFrame >= usedSince) {
+			keptMip = std::min(texture.requestedMip, texture.minimumMip);
+		}
+		uint32_t residentMip = texture.residentMip;
+		VkDeviceSize dropped = 0;
+		while (residentMip < keptMip && freed + dropped < bytes) {
+			dropped += texture.mipLevels.at(residentMip).size();
+			++residentMip;
+		}
+		if (residentMip != texture.residentMip && changeResidency(renderData, textureIndex, texture, residentMip)) {
+			freed += dropped;
+		}
+	}
+	if (freed > 0) {
+		LOG(Vulkan, 2, "%s: released %.1f of %.1f MiB of texture mips\n", __FUNCTION__, freed / (1024.0 * 1024.0), bytes / (1024.0 * 1024.0));
+	}
+	return freed;
+}
+
+void TextureStreaming::update(VkRenderData& renderData) {
+	PROFILE_FUNCTION();
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	uint64_t frame = renderData.rdFrameNumber;
+	// Only the mips finer than the coarse ones count against the budget
+	auto getStreamedBytes = [&streaming]() {
+		return streaming.residentBytes - streaming.coarseBytes;
+	};
+	if (getStreamedBytes() > streaming.budget) {
+		evict(renderData, getStreamedBytes() - streaming.budget, frame);
+	}
+
+	// Largest gap between the resident and the requested mip first
+	std::vector<uint32_t> requests;
+	for (const auto& entry : streaming.textures) {
+		if (!entry.second.uploadPending && entry.second.requestedMip < entry.second.residentMip) {
+			requests.push_back(entry.first);
+		}
+	}
+	std::sort(requests.begin(), requests.end(), [&streaming](uint32_t a, uint32_t b) {
+		const VkStreamedTexture& textureA = streaming.textures.at(a);
+		const VkStreamedTexture& textureB = streaming.textures.at(b);
+		uint32_t gapA = textureA.residentMip - textureA.requestedMip;
+		uint32_t gapB = textureB.residentMip - textureB.requestedMip;
+		return gapA != gapB ? gapA > gapB : a < b;
+	});
+
+	VkDeviceSize uploadBytes = 0;
+	for (uint32_t textureIndex : requests) {
+		VkStreamedTexture& texture = streaming.textures.at(textureIndex);
+		if (texture.uploadPending) {
+			continue;
+		}
+		// One mip after the other, coarse ones first, until the upload budget of the frame is used up
+		uint32_t residentMip = texture.residentMip;
+		while (residentMip > texture.requestedMip) {
+			VkDeviceSize mipBytes = texture.mipLevels.at(residentMip - 1).size();
+			if (uploadBytes > 0 && uploadBytes + mipBytes > VkTextureStreamingData::MAX_UPLOAD_BYTES_PER_FRAME) {
+				break;
+			}
+			uploadBytes += mipBytes;
+			--residentMip;
+		}
+		if (residentMip == texture.residentMip) {
+			break;
+		}
+		VkDeviceSize addedBytes = getMipBytes(texture, residentMip, texture.residentMip);
+		if (getStreamedBytes() + addedBytes > streaming.budget) {
+			evict(renderData, getStreamedBytes() + addedBytes - streaming.budget, frame);
+			if (getStreamedBytes() + addedBytes > streaming.budget) {
+				LOG(Vulkan, 5, "%s: no room for mip %u of texture %u\n", __FUNCTION__, residentMip, textureIndex);
+				continue;
+			}
+		}
+		changeResidency(renderData, textureIndex, texture, residentMip);
+	}
+
+	for (auto& entry : streaming.textures) {
+		entry.second.requestedMip = UINT32_MAX;
+	}
+}
+
+bool TextureStreaming::recordUploads(VkRenderData& renderData, VkCommandBuffer commandBuffer) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	if (streaming.uploads.empty()) {
+		return true;
+	}
+	PROFILE_FUNCTION();
+
+	// One staging buffer for the mips of every upload of the frame
+	VkDeviceSize stagingSize = 0;
+	for (const VkTextureUpload& upload : streaming.uploads) {
+		stagingSize += getMipBytes(streaming.textures.at(upload.textureIndex), upload.firstMip, upload.firstKeptMip);
+	}
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VmaAllocation stagingBufferAlloc = VK_NULL_HANDLE;
+	unsigned char* stagingData = nullptr;
+	if (stagingSize > 0) {
+		VkBufferCreateInfo stagingBufferInfo{};
+		stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		stagingBufferInfo.size = stagingSize;
+		stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		VmaAllocationCreateInfo stagingAllocInfo{};
+		stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+		if (vmaCreateBuffer(renderData.rdAllocator, &stagingBufferInfo, &stagingAllocInfo, &stagingBuffer, &stagingBufferAlloc, nullptr) != VK_SUCCESS) {
+			LOG(Vulkan, 1, "%s error: could not allocate texture staging buffer via VMA\n", __FUNCTION__);
+			return false;
+		}
+		VmaAllocator allocator = renderData.rdAllocator;
+		DeletionQueue::push(renderData, [allocator, stagingBuffer, stagingBufferAlloc]() {
+			vmaDestroyBuffer(allocator, stagingBuffer, stagingBufferAlloc);
+		});
+		void* data = nullptr;
+		vmaMapMemory(renderData.rdAllocator, stagingBufferAlloc, &data);
+		stagingData = static_cast<unsigned char*>(data);
+	}
+
+	VkImageSubresourceRange allMips{};
+	allMips.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	allMips.levelCount = VK_REMAINING_MIP_LEVELS;
+	allMips.layerCount = 1;
+	VkImageMemoryBarrier2 imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.subresourceRange = allMips;
+
+	// The old images were last sampled by frames the fence wait has completed
+	std::vector<VkImageMemoryBarrier2> transferBarriers;
+	std::vector<VkImageMemoryBarrier2> shaderBarriers;
+	for (const VkTextureUpload& upload : streaming.uploads) {
+		imageBarrier.image = upload.image;
+		imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		imageBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+		imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		transferBarriers.push_back(imageBarrier);
+		if (upload.oldImage != VK_NULL_HANDLE) {
+			imageBarrier.image = upload.oldImage;
+			imageBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			transferBarriers.push_back(imageBarrier);
+		}
+		imageBarrier.image = upload.image;
+		imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		imageBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		shaderBarriers.push_back(imageBarrier);
+	}
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(transferBarriers.size());
+	dependencyInfo.pImageMemoryBarriers = transferBarriers.data();
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	// Finer mips from the CPU, the coarser ones the texture already had are copied on the GPU
+	VkDeviceSize stagingOffset = 0;
+	std::vector<VkBufferImageCopy> bufferCopies;
+	std::vector<VkImageCopy> imageCopies;
+	for (const VkTextureUpload& upload : streaming.uploads) {
+		const VkStreamedTexture& texture = streaming.textures.at(upload.textureIndex);
+		uint32_t mipCount = static_cast<uint32_t>(texture.mipLevels.size());
+		bufferCopies.clear();
+		imageCopies.clear();
+		for (uint32_t mip = upload.firstMip; mip < mipCount; ++mip) {
+			VkExtent3D extent = { getMipSize(texture.width, mip), getMipSize(texture.height, mip), 1 };
+			if (mip < upload.firstKeptMip) {
+				const std::vector<unsigned char>& pixels = texture.mipLevels.at(mip);
+				std::copy(pixels.begin(), pixels.end(), stagingData + stagingOffset);
+				VkBufferImageCopy bufferCopy{};
+				bufferCopy.bufferOffset = stagingOffset;
+				bufferCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopy.imageSubresource.mipLevel = mip - upload.firstMip;
+				bufferCopy.imageSubresource.layerCount = 1;
+				bufferCopy.imageExtent = extent;
+				bufferCopies.push_back(bufferCopy);
+				stagingOffset += pixels.size();
+			}
+			else {
+				VkImageCopy imageCopy{};
+				imageCopy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				imageCopy.srcSubresource.mipLevel = mip - upload.oldResidentMip;
+				imageCopy.srcSubresource.layerCount = 1;
+				imageCopy.dstSubresource = imageCopy.srcSubresource;
+				imageCopy.dstSubresource.mipLevel = mip - upload.firstMip;
+				imageCopy.extent = extent;
+				imageCopies.push_back(imageCopy);
+			}
+		}
+		if (!bufferCopies.empty()) {
+			vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(bufferCopies.size()), bufferCopies.data());
+		}
+		if (!imageCopies.empty()) {
+			vkCmdCopyImage(commandBuffer, upload.oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(imageCopies.size()), imageCopies.data());
+		}
+	}
+	if (stagingData) {
+		vmaUnmapMemory(renderData.rdAllocator, stagingBufferAlloc);
+	}
+
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(shaderBarriers.size());
+	dependencyInfo.pImageMemoryBarriers = shaderBarriers.data();
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	// The old images are read by the copies of this frame
+	VkDevice device = renderData.rdVkbDevice.device;
+	VmaAllocator allocator = renderData.rdAllocator;
+	for (const VkTextureUpload& upload : streaming.uploads) {
+		streaming.textures.at(upload.textureIndex).uploadPending = false;
+		if (upload.oldImage == VK_NULL_HANDLE) {
+			continue;
+		}
+		VkImage oldImage = upload.oldImage;
+		VmaAllocation oldImageAlloc = upload.oldImageAlloc;
+		VkImageView oldImageView = upload.oldImageView;
+		DeletionQueue::push(renderData, [device, allocator, oldImage, oldImageAlloc, oldImageView]() {
+			vkDestroyImageView(device, oldImageView, nullptr);
+			vmaDestroyImage(allocator, oldImage, oldImageAlloc);
+		});
+	}
+	LOG(Vulkan, 5, "%s: %zu textures changed, %.1f KiB uploaded\n", __FUNCTION__, streaming.uploads.size(), stagingSize / 1024.0);
+	streaming.uploads.clear();
+	return true;
+}
+
+void TextureStreaming::cleanup(VkRenderData& renderData) {
+	VkTextureStreamingData& streaming = renderData.rdTextureStreaming;
+	VkDevice device = renderData.rdVkbDevice.device;
+	// Images replaced since the last frame was recorded are not retired yet
+	for (const VkTextureUpload& upload : streaming.uploads) {
+		if (upload.oldImage != VK_NULL_HANDLE) {
+			vkDestroyImageView(device, upload.oldImageView, nullptr);
+			vmaDestroyImage(renderData.rdAllocator, upload.oldImage, upload.oldImageAlloc);
+		}
+	}
+	for (auto& entry : streaming.textures) {
+		vkDestroyImageView(device, entry.second.imageView, nullptr);
+		vmaDestroyImage(renderData.rdAllocator, entry.second.image, entry.second.imageAlloc);
+	}
+	vkDestroySampler(device, streaming.sampler, nullptr);
+	streaming = VkTextureStreamingData{};
+}
\ No newline at end of file
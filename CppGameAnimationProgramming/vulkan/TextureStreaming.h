@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+#include "VkRenderData.h"
+
+/* mip residency of the textures: only the coarse mips are uploaded at first, finer ones are streamed in once draws
+ * need them on screen and evicted again finest first, least recently used textures first, to stay within the budget */
+class TextureStreaming {
+public:
+	/* shared sampler, registers an eviction handler with the MemoryManager */
+	static bool init(VkRenderData& renderData);
+	/* takes the mip chain, the mips up to VkTextureStreamingData::INITIAL_MIP_SIZE are copied with the next frame;
+	 * texture table index, UINT32_MAX on error */
+	static uint32_t addTexture(VkRenderData& renderData, VkTextureData textureData);
+	/* the texture covers about this many pixels along its larger side, the largest request of a frame counts */
+	static void requestScreenSize(VkRenderData& renderData, uint32_t textureIndex, float pixels);
+	/* call after the frame fence wait and the requests: streams in requested mips and evicts over the budget */
+	static void update(VkRenderData& renderData);
+	/* records the copies of the residency changes, before any pass samples the textures */
+	static bool recordUploads(VkRenderData& renderData, VkCommandBuffer commandBuffer);
+	/* drops the finest mips of textures not requested since usedSince, oldest first; returns the bytes released */
+	static VkDeviceSize evict(VkRenderData& renderData, VkDeviceSize bytes, uint64_t usedSince);
+	static void cleanup(VkRenderData& renderData);
+private:
+	static bool createImage(VkRenderData& renderData, VkStreamedTexture& texture, uint32_t firstMip, VkImage& image,
+		VmaAllocation& imageAlloc, VkImageView& imageView);
+	/* new image holding the mips from residentMip on, filled by the next recordUploads */
+	static bool changeResidency(VkRenderData& renderData, uint32_t textureIndex, VkStreamedTexture& texture, uint32_t residentMip);
+	static VkDeviceSize getMipBytes(const VkStreamedTexture& texture, uint32_t firstMip, uint32_t endMip);
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <glm/gtc/packing.hpp>
+#include "VertexFormat.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace {
+	struct AttributeFormat {
+		VkFormat format;
+		uint32_t offset;
+	};
+
+	// Indexed by shader location
+	const AttributeFormat floatAttributes[] = {
+		{ VK_FORMAT_R32G32B32_SFLOAT, offsetof(VkVertex, position) },
+		{ VK_FORMAT_R32G32_SFLOAT, offsetof(VkVertex, uv) },
+	};
+	// Three component 16 bit formats are rarely supported for vertex input, the position takes four
+	const AttributeFormat quantizedAttributes[] = {
+		{ VK_FORMAT_R16G16B16A16_SNORM, offsetof(VkQuantizedVertex, position) },
+		{ VK_FORMAT_R16G16_SFLOAT, offsetof(VkQuantizedVertex, uv) },
+	};
+}
+
+uint32_t VertexFormat::getStride(VkVertexFormat format) {
+	switch (format) {
+	case VkVertexFormat::Quantized:
+		return sizeof(VkQuantizedVertex);
+	default:
+		return sizeof(VkVertex);
+	}
+}
+
+bool VertexFormat::getAttributes(VkVertexFormat format, std::vector<VkVertexInputAttributeDescription>& attributes) {
+	const AttributeFormat* formats = format == VkVertexFormat::Quantized ? quantizedAttributes : floatAttributes;
+	const uint32_t formatCount = 2;
+	for (VkVertexInputAttributeDescription& attribute : attributes) {
+		if (attribute.location >= formatCount) {
+			LOG(Vulkan, 1, "%s error: vertex input location %u is not part of the vertex format\n", __FUNCTION__, attribute.location);
+			return false;
+		}
+		attribute.binding = 0;
+		attribute.format = formats[attribute.location].format;
+		attribute.offset = formats[attribute.location].offset;
+	}
+	return true;
+}
+
+void VertexFormat::encode(VkVertexFormat format, const std::vector<VkVertex>& vertices, std::vector<uint8_t>& data,
+		glm::vec4& positionDequantization) {
+	PROFILE_FUNCTION();
+	if (format != VkVertexFormat::Quantized) {
+		data.resize(vertices.size() * sizeof(VkVertex));
+		if (!vertices.empty()) {
+			std::memcpy(data.data(), vertices.data(), data.size());
+		}
+		positionDequantization = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		return;
+	}
+
+	// One scale for all axes keeps the dequantization a uniform scale
+	glm::vec3 minimum(std::numeric_limits<float>::max());
+	glm::vec3 maximum(std::numeric_limits<float>::lowest());
+	for (const VkVertex& vertex : vertices) {
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+	glm::vec3 center = vertices.empty() ? glm::vec3(0.0f) : (minimum + maximum) * 0.5f;
+	float scale = vertices.empty() ? 0.0f : std::max(std::max(maximum.x - center.x, maximum.y - center.y), maximum.z - center.z);
+	if (scale <= 0.0f) {
+		scale = 1.0f;
+	}
+	positionDequantization = glm::vec4(center, scale);
+
+	data.resize(vertices.size() * sizeof(VkQuantizedVertex));
+	VkQuantizedVertex* quantized = reinterpret_cast<VkQuantizedVertex*>(data.data());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		glm::vec3 position = (vertices[i].position - center) / scale;
+		for (int axis = 0; axis < 3; ++axis) {
+			quantized[i].position[axis] = static_cast<int16_t>(glm::packSnorm1x16(position[axis]));
+		}
+		quantized[i].position[3] = 0;
+		quantized[i].uv[0] = glm::packHalf1x16(vertices[i].uv.x);
+		quantized[i].uv[1] = glm::packHalf1x16(vertices[i].uv.y);
+	}
+}
+
+bool VertexFormat::packJointInfluences(const std::vector<uint32_t>& joints, const std::vector<float>& weights, uint32_t influencesPerVertex,
+		std::vector<uint32_t>& packedJoints, std::vector<uint32_t>& packedWeights) {
+	if (influencesPerVertex == 0 || joints.size() != weights.size() || joints.size() % influencesPerVertex != 0) {
+		LOG(Vulkan, 1, "%s error: %zu joints and %zu weights do not fit %u influences per vertex\n", __FUNCTION__,
+			joints.size(), weights.size(), influencesPerVertex);
+		return false;
+	}
+	packedJoints.assign((joints.size() + 3) / 4, 0);
+	packedWeights.assign((joints.size() + 3) / 4, 0);
+	std::vector<float> vertexWeights(influencesPerVertex);
+	std::vector<uint32_t> quantizedWeights(influencesPerVertex);
+	for (size_t vertex = 0; vertex < joints.size(); vertex += influencesPerVertex) {
+		// Normalized first, exporters do not always keep the sum at 1
+		float weightSum = 0.0f;
+		size_t largest = 0;
+		for (uint32_t i = 0; i < influencesPerVertex; ++i) {
+			vertexWeights[i] = std::clamp(weights[vertex + i], 0.0f, 1.0f);
+			weightSum += vertexWeights[i];
+			if (vertexWeights[i] > vertexWeights[largest]) {
+				largest = i;
+			}
+		}
+		if (!(weightSum > 0.0f)) {
+			LOG(Vulkan, 1, "%s error: all joint weights of vertex %zu are zero\n", __FUNCTION__, vertex / influencesPerVertex);
+			return false;
+		}
+
+		// The rounding error goes to the largest weight, it changes the least there
+		uint32_t sum = 0;
+		for (uint32_t i = 0; i < influencesPerVertex; ++i) {
+			quantizedWeights[i] = static_cast<uint32_t>(std::lround(vertexWeights[i] / weightSum * 255.0f));
+			sum += quantizedWeights[i];
+		}
+		// At least 255 / influencesPerVertex, far more than the rounding error of up to 8 influences
+		quantizedWeights[largest] = quantizedWeights[largest] + 255 - sum;
+
+		for (uint32_t i = 0; i < influencesPerVertex; ++i) {
+			size_t influence = vertex + i;
+			if (joints[influence] > 255) {
+				LOG(Vulkan, 1, "%s error: joint %u does not fit into 8 bits\n", __FUNCTION__, joints[influence]);
+				return false;
+			}
+			uint32_t shift = static_cast<uint32_t>(influence % 4) * 8;
+			packedJoints[influence / 4] |= joints[influence] << shift;
+			packedWeights[influence / 4] |= quantizedWeights[i] << shift;
+		}
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include "VkRenderData.h"
+
+/* GPU layouts of VkVertex, location 0 is the position and location 1 the UV in every format */
+class VertexFormat {
+public:
+	/* bytes per vertex in the vertex buffer */
+	static uint32_t getStride(VkVertexFormat format);
+	/* sets format and offset of the reflected vertex shader inputs, fails on a location the format does not store */
+	static bool getAttributes(VkVertexFormat format, std::vector<VkVertexInputAttributeDescription>& attributes);
+	/* vertex buffer contents, positionDequantization goes into VkDrawData for draws from this buffer */
+	static void encode(VkVertexFormat format, const std::vector<VkVertex>& vertices, std::vector<uint8_t>& data,
+		glm::vec4& positionDequantization);
+	/* skinning buffers: joints as UINT8 and weights as UNORM8, four influences per word
+	 * weights are normalized per vertex and the rounded ones add up to exactly 255, fails if all are zero */
+	static bool packJointInfluences(const std::vector<uint32_t>& joints, const std::vector<float>& weights, uint32_t influencesPerVertex,
+		std::vector<uint32_t>& packedJoints, std::vector<uint32_t>& packedWeights);
+};
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
 #include <vector>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <string>
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <vkb/VkBootstrap.h>
@@ -10,8 +16,444 @@ struct VkVertex {
 	glm::vec2 uv;
 };
 
+/* vertex buffer layouts the pipeline can be built for, meshes stay VkVertex on the CPU */
+enum class VkVertexFormat : uint32_t {
+	// VkVertex as is, 20 bytes
+	Float,
+	// VkQuantizedVertex, 12 bytes
+	Quantized
+};
+
+/* position as SNORM16 inside the mesh bounds, w only pads to 8 bytes; UV as half floats */
+struct VkQuantizedVertex {
+	int16_t position[4];
+	uint16_t uv[2];
+};
+
+/* index range of one level of detail, std430 layout shared with the culling shader */
+struct VkMeshLod {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	// Largest deviation from the full mesh, in mesh units
+	float error = 0.0f;
+	uint32_t padding = 0;
+};
+
 struct VkMesh {
 	std::vector<VkVertex> vertices;
+	// Empty draws the vertices in order
+	std::vector<uint32_t> indices;
+	// Finest first, all levels index the same vertices; empty is a single level with every index
+	std::vector<VkMeshLod> lods;
+};
+
+/* placement of one mesh instance, std430 layout shared with the shaders */
+struct VkInstanceData {
+	// World position in xyz, uniform scale in w
+	glm::vec4 positionScale = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	uint32_t meshIndex = 0;
+	uint32_t textureIndex = 0;
+	uint32_t padding[2]{};
+};
+
+/* index range and bounds of a mesh in the shared vertex and index buffers, std430 */
+struct VkMeshDrawData {
+	static constexpr uint32_t MAX_LODS = 8;
+	// Center in xyz, radius in w, in mesh space
+	glm::vec4 boundingSphere = glm::vec4(0.0f);
+	int32_t vertexOffset = 0;
+	uint32_t lodCount = 0;
+	uint32_t padding[2]{};
+	VkMeshLod lods[MAX_LODS]{};
+};
+
+/* cluster of at most 64 vertices and 124 triangles, std430 layout shared with the cluster culling shader */
+struct VkMeshlet {
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+	// Center in xyz, radius in w, in mesh space
+	glm::vec4 boundingSphere = glm::vec4(0.0f);
+	// Average triangle normal in xyz, w is the sine of the widest angle to it; 1 never passes the backface test
+	glm::vec4 normalCone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	uint32_t vertexOffset = 0;
+	uint32_t triangleOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t triangleCount = 0;
+};
+
+/* meshlets of one indexed mesh, vertex and index buffers of the mesh stay as they are */
+struct VkMeshletMesh {
+	std::vector<VkMeshlet> meshlets;
+	// Mesh vertex index for each meshlet local vertex
+	std::vector<uint32_t> vertices;
+	// One entry per triangle, three 8 bit meshlet local vertex indices
+	std::vector<uint32_t> triangles;
+};
+
+/* instances and draw commands for the GPU culling pass, a visible instance becomes one indexed draw */
+struct VkCullingData {
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout instanceSetLayout = VK_NULL_HANDLE;
+	// Storage buffers for the compute pass and the instance set read by the vertex shader
+	VkDescriptorSet cullSet = VK_NULL_HANDLE;
+	VkDescriptorSet instanceSet = VK_NULL_HANDLE;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	VmaAllocation instanceBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer meshBuffer = VK_NULL_HANDLE;
+	VmaAllocation meshBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer drawBuffer = VK_NULL_HANDLE;
+	VmaAllocation drawBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer countBuffer = VK_NULL_HANDLE;
+	VmaAllocation countBufferAlloc = VK_NULL_HANDLE;
+	uint32_t instanceCapacity = 0;
+	uint32_t meshCapacity = 0;
+	uint32_t instanceCount = 0;
+	// Coarser LODs are drawn while their error stays below this many pixels on screen
+	float lodErrorPixels = 1.0f;
+};
+
+/* one static mesh split into meshlets, the surviving meshlets are written to an index stream drawn with one indirect call */
+struct VkClusterCullingData {
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet cullSet = VK_NULL_HANDLE;
+	// Single identity instance, the mesh is in world space
+	VkDescriptorSet instanceSet = VK_NULL_HANDLE;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	VmaAllocation instanceBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VmaAllocation vertexBufferAlloc = VK_NULL_HANDLE;
+	glm::vec4 positionDequantization = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	VkBuffer meshletBuffer = VK_NULL_HANDLE;
+	VmaAllocation meshletBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer meshletVertexBuffer = VK_NULL_HANDLE;
+	VmaAllocation meshletVertexBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer meshletTriangleBuffer = VK_NULL_HANDLE;
+	VmaAllocation meshletTriangleBufferAlloc = VK_NULL_HANDLE;
+	// Written by the culling pass, sized for every triangle of the mesh
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VmaAllocation indexBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer drawBuffer = VK_NULL_HANDLE;
+	VmaAllocation drawBufferAlloc = VK_NULL_HANDLE;
+	uint32_t meshletCount = 0;
+};
+
+/* RGBA8 pixels decoded from an image file */
+struct VkTextureData {
+	std::string fileName;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	// Full mip chain down to 1x1, level 0 is the decoded image
+	std::vector<std::vector<unsigned char>> mipLevels;
+};
+
+/* descriptor binding used by a shader, set and binding come from its decorations */
+struct VkShaderBinding {
+	uint32_t set = 0;
+	VkDescriptorSetLayoutBinding layoutBinding{};
+};
+
+/* interface of one shader stage, extracted from its SPIR-V */
+struct VkShaderReflection {
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	// Location and format only, the pipeline packs the offsets
+	std::vector<VkVertexInputAttributeDescription> inputs;
+	std::vector<VkShaderBinding> bindings;
+	std::vector<VkPushConstantRange> pushConstants;
+};
+
+struct VkShaderStage {
+	VkShaderModule module = VK_NULL_HANDLE;
+	VkShaderReflection reflection;
+};
+
+/* feature toggles selecting a shader permutation, combined into a compact bitmask */
+struct VkShaderFeatures {
+	// #define SKINNED, changes the vertex shader interface
+	static constexpr uint32_t SKINNED = 1u << 0;
+	// Specialization constant, fragments below the alpha cutoff are discarded
+	static constexpr uint32_t ALPHA_TEST = 1u << 1;
+	// Specialization constant, joint influences per vertex are 1 << value, skinned only
+	static constexpr uint32_t JOINT_INFLUENCE_SHIFT = 2;
+	static constexpr uint32_t JOINT_INFLUENCE_MASK = 3u << JOINT_INFLUENCE_SHIFT;
+	static constexpr uint32_t ALL = SKINNED | ALPHA_TEST | JOINT_INFLUENCE_MASK;
+	// Features compiled as defines, everything else shares the SPIR-V
+	static constexpr uint32_t DEFINE_MASK = SKINNED;
+	// Need descriptor sets the renderer does not bind yet, SKINNED reads the joints from set 2
+	static constexpr uint32_t UNAVAILABLE = SKINNED;
+};
+
+/* pipeline of one shader permutation, built on a worker on first use */
+struct VkPipelineVariant {
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	bool building = false;
+	// Not retried until the shaders change
+	bool failed = false;
+};
+
+/* GPU time and pipeline statistics of one pass, resolved a few frames after submit */
+struct VkGpuPassTiming {
+	const char* name = nullptr;
+	float milliseconds = 0.0f;
+	uint64_t vertexInvocations = 0;
+	uint64_t clippingPrimitives = 0;
+	uint64_t fragmentInvocations = 0;
+};
+
+struct VkQueryData {
+	static constexpr uint32_t MAX_PASSES = 16;
+	// Results are written in bit order: vertex invocations, clipping primitives, fragment invocations
+	static constexpr VkQueryPipelineStatisticFlags STATISTICS = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+	// Ring of query ranges, a slot is read back when it is reused
+	static constexpr uint32_t FRAME_SLOTS = 3;
+	VkQueryPool timestampPool = VK_NULL_HANDLE;
+	VkQueryPool statisticsPool = VK_NULL_HANDLE;
+	float timestampPeriod = 1.0f;
+	uint64_t timestampMask = ~0ull;
+	uint32_t currentSlot = 0;
+	bool passOpen = false;
+	std::array<std::vector<const char*>, FRAME_SLOTS> slotPassNames{};
+	std::array<uint64_t, FRAME_SLOTS> slotCpuTime{};
+	std::array<bool, FRAME_SLOTS> slotSubmitted{};
+	std::vector<VkGpuPassTiming> passTimings;
+};
+
+/* VMA budget of one memory heap, usage includes other processes when VK_EXT_memory_budget is enabled */
+struct VkHeapBudget {
+	VkDeviceSize usage = 0;
+	VkDeviceSize budget = 0;
+	// Bytes of this process in live allocations and in VkDeviceMemory blocks, the difference is free space inside the blocks
+	VkDeviceSize allocationBytes = 0;
+	VkDeviceSize blockBytes = 0;
+	bool deviceLocal = false;
+};
+
+/* buffer the defragmentation may move, the owner's handle is replaced once the copy is done */
+struct VkMovableBuffer {
+	VkBuffer* buffer = nullptr;
+	VkBufferCreateInfo createInfo{};
+};
+
+struct VkMemoryData {
+	// Fractions of the heap budget: warn above the first, ask the eviction handlers to get back below it above the second
+	static constexpr float WARNING_USAGE = 0.85f;
+	static constexpr float EVICTION_USAGE = 0.95f;
+	// Fragmentation is checked every few seconds, moves are spread over frames
+	static constexpr uint64_t DEFRAGMENTATION_INTERVAL = 600;
+	static constexpr VkDeviceSize DEFRAGMENTATION_MIN_FREE_BYTES = 16 * 1024 * 1024;
+	static constexpr uint32_t MAX_MOVES_PER_FRAME = 16;
+	static constexpr VkDeviceSize MAX_MOVE_BYTES_PER_FRAME = 32 * 1024 * 1024;
+	// Passes of one run, moves VMA proposes for allocations nobody registered are ignored and may come back
+	static constexpr uint32_t MAX_PASSES_PER_RUN = 64;
+	bool budgetExtension = false;
+	std::vector<VkHeapBudget> heapBudgets;
+	std::vector<bool> heapWarned;
+	// Called with the heap and the bytes to free, return the bytes actually released
+	std::vector<std::function<VkDeviceSize(uint32_t heapIndex, VkDeviceSize bytes)>> evictionHandlers;
+	std::unordered_map<VmaAllocation, VkMovableBuffer> movableBuffers;
+	// Graphics and transfer family, movable buffers are shared by both when they differ
+	std::array<uint32_t, 2> queueFamilies{};
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+	VkFence transferFence = VK_NULL_HANDLE;
+	VmaDefragmentationContext defragmentation = VK_NULL_HANDLE;
+	VmaDefragmentationPassMoveInfo passInfo{};
+	// New buffer of each move of the pass in flight, null for ignored moves
+	std::vector<VkBuffer> movedBuffers;
+	bool passInFlight = false;
+	uint32_t passCount = 0;
+	uint64_t lastDefragmentationFrame = 0;
+	uint64_t lastEvictionFrame = 0;
+};
+
+/* texture whose finer mips are streamed in and out, the image only holds the levels from residentMip on */
+struct VkStreamedTexture {
+	std::string fileName;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	// RGBA8 mip chain kept on the CPU, the mips are streamed from here
+	std::vector<std::vector<unsigned char>> mipLevels;
+	// Coarsest mip that stays resident, everything from here on is uploaded by addTexture
+	uint32_t minimumMip = 0;
+	uint32_t residentMip = 0;
+	// Finest mip the draws asked for since the last update, UINT32_MAX if the texture was not seen
+	uint32_t requestedMip = UINT32_MAX;
+	uint64_t lastUsedFrame = 0;
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation imageAlloc = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	VkDeviceSize residentBytes = 0;
+	// Set until the copies into a new image are recorded, the residency does not change again before
+	bool uploadPending = false;
+};
+
+/* residency change recorded into the next frame: mips from the CPU and the levels kept from the old image */
+struct VkTextureUpload {
+	uint32_t textureIndex = 0;
+	// Levels of the full chain
+	uint32_t firstMip = 0;
+	uint32_t firstKeptMip = 0;
+	uint32_t oldResidentMip = 0;
+	VkImage image = VK_NULL_HANDLE;
+	VkImage oldImage = VK_NULL_HANDLE;
+	VmaAllocation oldImageAlloc = VK_NULL_HANDLE;
+	VkImageView oldImageView = VK_NULL_HANDLE;
+};
+
+struct VkTextureStreamingData {
+	// Mips up to this size are loaded right away and never evicted
+	static constexpr uint32_t INITIAL_MIP_SIZE = 64;
+	static constexpr VkDeviceSize DEFAULT_BUDGET = 256 * 1024 * 1024;
+	// Staging bytes per frame, a single larger mip is still uploaded alone
+	static constexpr VkDeviceSize MAX_UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024;
+	// Bytes of the mips finer than the coarse ones, evicted in LRU order above it
+	VkDeviceSize budget = DEFAULT_BUDGET;
+	VkDeviceSize residentBytes = 0;
+	// Part of residentBytes in the coarse mips, not counted against the budget
+	VkDeviceSize coarseBytes = 0;
+	VkSampler sampler = VK_NULL_HANDLE;
+	// Memory heap of the texture images, eviction requests for other heaps are ignored
+	uint32_t heapIndex = UINT32_MAX;
+	// By texture table index
+	std::unordered_map<uint32_t, VkStreamedTexture> textures;
+	std::vector<VkTextureUpload> uploads;
+};
+
+/* latency versus tearing trade-off used to pick the swapchain present mode */
+enum class VkPresentPolicy {
+	// FIFO only, never tears, frames can queue up behind vblank
+	VSync,
+	// MAILBOX, FIFO_RELAXED, FIFO: no tearing unless a frame is late
+	LowLatency,
+	// IMMEDIATE first, tears to show every frame as early as possible
+	LowestLatency
+};
+
+/* time from input sampling at frame start until the frame was shown */
+struct VkFrameLatency {
+	float lastMilliseconds = 0.0f;
+	float averageMilliseconds = 0.0f;
+	float maximumMilliseconds = 0.0f;
+	// Without VK_KHR_present_wait only until vkQueuePresentKHR returned, the CPU submit latency without the present queue
+	bool presentMeasured = false;
+};
+
+/* present ids and the present wait entry point, only with VK_KHR_present_id and VK_KHR_present_wait */
+struct VkPresentWaitData {
+	bool supported = false;
+	PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+	// Ids only have to increase per swapchain, one counter serves all of them
+	uint64_t nextPresentId = 1;
+};
+
+/* destroy call deferred until the GPU completed frame number 'frame' */
+struct VkDeletionEntry {
+	uint64_t frame = 0;
+	std::function<void()> destroyFunction;
+};
+
+/* pools of one lifetime, full pools stay chained until the next reset */
+struct VkDescriptorPoolChain {
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> usedPools;
+	std::vector<VkDescriptorPool> freePools;
+};
+
+/* contents of one binding, image or buffer info depending on the type */
+struct VkDescriptorBindingData {
+	uint32_t binding = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	VkDescriptorImageInfo imageInfo{};
+	VkDescriptorBufferInfo bufferInfo{};
+};
+
+struct VkCachedDescriptorSet {
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	// Destroying one of these drops the entry, the handle may be reused by a new buffer
+	std::vector<VkBuffer> buffers;
+};
+
+struct VkDescriptorAllocatorData {
+	static constexpr uint32_t SETS_PER_POOL = 256;
+	// At least the number of frames in flight, a slot is reset when its frame comes around again
+	static constexpr uint32_t FRAME_SLOTS = 3;
+	VkDescriptorPoolChain staticPools;
+	std::array<VkDescriptorPoolChain, FRAME_SLOTS> framePools;
+	uint32_t currentSlot = 0;
+	// Static sets by layout and binding contents
+	std::unordered_map<std::string, VkCachedDescriptorSet> cachedSets;
+	// Sets of invalidated entries by layout, rewritten before the static pools grow
+	std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeCachedSets;
+};
+
+/* one descriptor set with every texture, shaders index it with a texture index from the draw data */
+struct VkBindlessTextureData {
+	static constexpr uint32_t MAX_TEXTURES = 4096;
+	// MAX_TEXTURES or less if the device limits are lower
+	uint32_t capacity = 0;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	uint32_t nextIndex = 0;
+	std::vector<uint32_t> freeIndices;
+};
+
+/* command pool of one recording thread in one frame, reset as a whole when the frame comes around again */
+struct VkThreadCommandPool {
+	VkCommandPool pool = VK_NULL_HANDLE;
+	// Kept over resets, usedCount starts at 0 again every frame
+	std::vector<VkCommandBuffer> secondaryBuffers;
+	uint32_t usedCount = 0;
+};
+
+/* per-frame, per-thread command pools, thread 0 is the render thread */
+struct VkCommandPoolData {
+	// draw() waits for the previous frame's fence first, so a single set of pools is never in use while reset
+	static constexpr uint32_t FRAME_COUNT = 1;
+	uint32_t threadCount = 0;
+	uint32_t frameIndex = 0;
+	// frameIndex * threadCount + thread index of the job system
+	std::vector<VkThreadCommandPool> pools;
+	// One primary buffer per frame from the render thread pool
+	std::vector<VkCommandBuffer> primaryBuffers;
+};
+
+/* push constants of the graphics pipelines, must match the vertex shader */
+struct VkDrawData {
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	// Offset in xyz and scale in w of the bound vertex buffer positions, identity for VkVertexFormat::Float
+	glm::vec4 positionDequantization = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+};
+
+/* push constants of the culling compute shader */
+struct VkCullData {
+	// Plane normals point inside, xyz normal and w distance
+	glm::vec4 frustumPlanes[6];
+	// Row of the view projection giving clip space w, the view distance for perspective projections
+	glm::vec4 clipW = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	uint32_t instanceCount = 0;
+	// Pixels per mesh unit at clip space w 1
+	float pixelsPerUnit = 0.0f;
+	float lodErrorPixels = 1.0f;
+};
+
+/* push constants of the cluster culling compute shader */
+struct VkClusterCullData {
+	glm::vec4 frustumPlanes[6];
+	// Camera position with w 1, or the view direction with w 0 for parallel projections
+	glm::vec4 viewOrigin = glm::vec4(0.0f);
+	// 1 when front faces have their normals pointing away from the viewer, -1 otherwise
+	float frontFaceSign = 1.0f;
+	uint32_t meshletCount = 0;
 };
 
 struct VkRenderData {
@@ -19,37 +461,65 @@ struct VkRenderData {
 	vkb::Instance rdVkbInstance{};
 	vkb::Device rdVkbDevice{};
 	vkb::Swapchain rdVkbSwapchain{};
+	// Render target, the swapchain images or the offscreen image in headless mode
+	bool rdHeadless = false;
+	VkFormat rdColorFormat = VK_FORMAT_UNDEFINED;
+	VkExtent2D rdRenderExtent{};
+	VkImage rdOffscreenImage = VK_NULL_HANDLE;
+	VkImageView rdOffscreenImageView = VK_NULL_HANDLE;
+	VmaAllocation rdOffscreenImageAlloc = VK_NULL_HANDLE;
+	VkPresentPolicy rdPresentPolicy = VkPresentPolicy::LowLatency;
+	VkPresentModeKHR rdPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+	VkPresentWaitData rdPresentWait{};
 	std::vector<VkImage> rdSwapchainImages;
 	std::vector<VkImageView> rdSwapchainImageViews;
-	std::vector<VkFramebuffer> rdFramebuffers;
-	// Queues
+	// Queues, the transfer queue is the graphics queue if the device has no separate one
 	VkQueue rdGraphicsQueue = VK_NULL_HANDLE;
 	VkQueue rdPresentQueue = VK_NULL_HANDLE;
-	// Depth
-	VkImage rdDepthImage = VK_NULL_HANDLE;
-	VkImageView rdDepthImageView = VK_NULL_HANDLE;
-	VkFormat rdDepthFormat;
-	VmaAllocation rdDepthImageAlloc = VK_NULL_HANDLE;
-	// Renderpass
-	VkRenderPass rdRenderpass = VK_NULL_HANDLE;
-	// Pipeline and Pipeline layout
+	VkQueue rdTransferQueue = VK_NULL_HANDLE;
+	uint32_t rdGraphicsQueueFamily = 0;
+	uint32_t rdTransferQueueFamily = 0;
+	// Depth, a transient image of the render graph
+	VkFormat rdDepthFormat = VK_FORMAT_D32_SFLOAT;
+	// Pipeline and Pipeline layout, every graphics pipeline reads this vertex layout
+	VkVertexFormat rdVertexFormat = VkVertexFormat::Quantized;
 	VkPipelineLayout rdPipelineLayout = VK_NULL_HANDLE;
 	VkPipeline rdPipeline = VK_NULL_HANDLE;
-	// Command pool and Command buffer
+	// Command pool for one-shot uploads and readbacks
 	VkCommandPool rdCommandPool = VK_NULL_HANDLE;
+	// Frame recording pools and the primary buffer of the current frame
+	VkCommandPoolData rdFrameCommandPools{};
 	VkCommandBuffer rdCommandBuffer = VK_NULL_HANDLE;
 	// Semaphore
 	VkSemaphore rdPresentSemaphore = VK_NULL_HANDLE;
 	VkSemaphore rdRenderSemaphore = VK_NULL_HANDLE;
 	// Fence
 	VkFence rdRenderFence = VK_NULL_HANDLE;
+	// Set by the submit, the fence is only waited for then: a frame failing after the reset never signals it
+	bool rdFrameSubmitted = false;
+	// GPU driven culling and indirect draws
+	VkCullingData rdCulling{};
+	VkClusterCullingData rdClusterCulling{};
 	// Textures
-	VkImage rdTextureImage = VK_NULL_HANDLE;
-	VkImageView rdTextureImageView = VK_NULL_HANDLE;
-	VkSampler rdTextureSampler = VK_NULL_HANDLE;
-	VmaAllocation rdTextureImageAlloc = VK_NULL_HANDLE;
+	uint32_t rdTextureIndex = 0;
+	VkTextureStreamingData rdTextureStreaming{};
+	VkBindlessTextureData rdBindlessTextures{};
 	// Descriptor
-	VkDescriptorPool rdDescriptorPool = VK_NULL_HANDLE;
-	VkDescriptorSetLayout rdTextureLayout = VK_NULL_HANDLE;
-	VkDescriptorSet rdDescriptorSet = VK_NULL_HANDLE;
+	VkDescriptorAllocatorData rdDescriptorAllocator{};
+	// Submitted frames and resources waiting for them to finish
+	uint64_t rdFrameNumber = 0;
+	std::deque<VkDeletionEntry> rdDeletionQueue;
+	// Layouts built from shader reflection, shared by every pipeline with the same interface
+	std::unordered_map<std::string, VkDescriptorSetLayout> rdDescriptorSetLayouts;
+	std::unordered_map<std::string, VkPipelineLayout> rdPipelineLayouts;
+	// Shader permutations by feature bitmask, the default pipeline stands in until one is built
+	std::unordered_map<uint32_t, VkPipelineVariant> rdPipelineVariants;
+	uint64_t rdPipelineVariantGeneration = 0;
+	// Pipeline cache, loaded from and saved to disk
+	VkPipelineCache rdPipelineCache = VK_NULL_HANDLE;
+	// GPU timestamp and pipeline statistics queries
+	bool rdPipelineStatisticsSupported = false;
+	VkQueryData rdQueries{};
+	// Heap budgets, eviction and defragmentation
+	VkMemoryData rdMemory{};
 };
\ No newline at end of file
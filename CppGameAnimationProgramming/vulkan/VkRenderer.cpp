@@ -1,94 +1,278 @@
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #define VMA_IMPLEMENTATION
 #include <vma/vk_mem_alloc.h>
 #include "VkRenderer.h"
 #include "Logger.h"
+#include "Profiler.h"
+#include "TaskGraph.h"
+#include "VertexFormat.h"
 
 VkRenderer::VkRenderer(GLFWwindow* window) {
 	mWindow = window;
+	mRenderData.rdHeadless = (window == nullptr);
+}
+
+void VkRenderer::setPresentPolicy(VkPresentPolicy policy, float frameRateLimit) {
+	mRenderData.rdPresentPolicy = policy;
+	mFrameRateLimit = frameRateLimit;
+}
+
+void VkRenderer::setVertexFormat(VkVertexFormat format) {
+	mRenderData.rdVertexFormat = format;
 }
 
 bool VkRenderer::init(unsigned int width, unsigned int height) {
-	if (!mWindow) {
-		Logger::log(1, "%s error: invalid GLFWwindow handle\n", __FUNCTION__);
-		return false;
-	}
-	if (!deviceInit()) {
-		return false;
+	PROFILE_FUNCTION();
+	mWidth = width;
+	mHeight = height;
+	if (mRenderData.rdHeadless) {
+		LOG(Renderer, 1, "%s: no window, rendering headless to an offscreen image\n", __FUNCTION__);
 	}
-	if (!initVma()) {
-		return false;
+	else {
+		// GLFW monitor queries are main thread only, the init tasks run on workers
+		const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		mRefreshRate = videoMode ? videoMode->refreshRate : 0;
 	}
-	if (!getQueue()) {
+	TaskGraph initGraph;
+	addInitTasks(initGraph, false);
+	bool result = initGraph.run();
+	initGraph.logReport("VkRenderer::init");
+	if (!result) {
+		LOG(Renderer, 1, "%s error: renderer initialization failed\n", __FUNCTION__);
 		return false;
 	}
-	if (!createSwapchain()) {
-		return false;
+	ShaderPermutations::init(mRenderData, mVertexShaderFileName, mFragmentShaderFileName, mShaderVariantFileName);
+	// One-shot headless runs have nothing to reload
+	if (!mRenderData.rdHeadless) {
+		initShaderReload();
 	}
-	// Needs data from Swapchain
-	if (!createDepthBuffer()) {
-		return false;
-	}
-	if (!createCommandPool()) {
-		return false;
+
+	LOG(Renderer, 1, "%s: Vulkan renderer initialized to %ix%i\n", __FUNCTION__, width, height);
+	return true;
+}
+
+void VkRenderer::addInitTasks(TaskGraph& initGraph, bool dryRun) {
+	// A dry run only checks the declaration, every step succeeds without touching the device
+	auto addTask = [&initGraph, dryRun](const char* name, std::vector<const char*> dependencies, std::function<bool()> task) {
+		initGraph.addTask(name, std::move(dependencies), dryRun ? std::function<bool()>([]() { return true; }) : std::move(task));
+	};
+	// Every step waits only for the steps whose data it uses, independent steps run in parallel
+	addTask("deviceInit", {}, [this]() { return deviceInit(); });
+	addTask("decodeTexture", {}, [this]() { return decodeTexture(); });
+	addTask("initVma", { "deviceInit" }, [this]() { return initVma(); });
+	addTask("getQueue", { "deviceInit" }, [this]() { return getQueue(); });
+	addTask("createPipelineCache", { "deviceInit" }, [this]() { return createPipelineCache(); });
+	addTask("loadVertexShader", { "deviceInit" }, [this]() { return loadShader(mVertexShaderFileName, mVertexShader); });
+	addTask("loadFragmentShader", { "deviceInit" }, [this]() { return loadShader(mFragmentShaderFileName, mFragmentShader); });
+	addTask("createBindlessTextures", { "deviceInit" }, [this]() { return createBindlessTextures(); });
+	addTask("createDescriptorAllocator", { "deviceInit" }, [this]() { return createDescriptorAllocator(); });
+	addTask("createGpuCulling", { "initVma", "createPipelineCache", "createDescriptorAllocator" }, [this]() { return createGpuCulling(); });
+	addTask("createRenderTarget", { "deviceInit", "initVma" }, [this]() { return createRenderTarget(); });
+	addTask("createCommandPool", { "deviceInit" }, [this]() { return createCommandPool(); });
+	addTask("createMemoryManager", { "initVma", "getQueue" }, [this]() { return createMemoryManager(); });
+	addTask("createTextureStreaming", { "createMemoryManager" }, [this]() { return createTextureStreaming(); });
+	// Only creates the image, the coarse mips are copied by the first frame
+	addTask("uploadTexture", { "decodeTexture", "createBindlessTextures", "createTextureStreaming" },
+		[this]() { return uploadTexture(); });
+	// Pipelines are built for the attachment formats, the color format comes with the render target
+	addTask("createPipeline", { "createRenderTarget", "createPipelineCache", "loadVertexShader", "loadFragmentShader", "createBindlessTextures" },
+		[this]() { return createPipeline(); });
+	addTask("createSyncObjects", { "deviceInit" }, [this]() { return createSyncObjects(); });
+	addTask("createQueryPool", { "deviceInit" }, [this]() { return createQueryPool(); });
+	addTask("createPresentWait", { "deviceInit" }, [this]() { return createPresentWait(); });
+}
+
+bool VkRenderer::checkInitGraph() {
+	VkRenderer renderer(nullptr);
+	TaskGraph initGraph;
+	renderer.addInitTasks(initGraph, true);
+	return initGraph.run();
+}
+
+void VkRenderer::initShaderReload() {
+	mVertexShaderKey = ShaderCompiler::getCacheKey(mVertexShaderFileName, {});
+	mFragmentShaderKey = ShaderCompiler::getCacheKey(mFragmentShaderFileName, {});
+	if (!mShaderWatcher.init({ "shader" })) {
+		LOG(Renderer, 1, "%s: shader hot reload disabled\n", __FUNCTION__);
 	}
-	if (!createCommandBuffer()) {
-		return false;
+}
+
+void VkRenderer::updateShaderReload() {
+	// Called after the fence wait, the old pipeline is retired through the deletion queue
+	if (mReloadReady.load(std::memory_order_acquire)) {
+		VkDevice device = mRenderData.rdVkbDevice.device;
+		VkPipeline oldPipeline = mRenderData.rdPipeline;
+		DeletionQueue::push(mRenderData, [device, oldPipeline]() {
+			vkDestroyPipeline(device, oldPipeline, nullptr);
+		});
+		mRenderData.rdPipeline = mReloadedPipeline;
+		mReloadedPipeline = VK_NULL_HANDLE;
+		mReloadReady.store(false, std::memory_order_relaxed);
+		ShaderPermutations::invalidate(mRenderData);
+		LOG(Renderer, 1, "%s: reloaded shaders are active\n", __FUNCTION__);
 	}
-	// Needs command pool
-	if (!loadTexture()) {
-		return false;
+
+	if (!mShaderWatcher.getChangedFiles().empty()) {
+		mReloadRequested = true;
 	}
-	if (!createRenderPass()) {
-		return false;
+	// One reload at a time, changes during a running reload start the next one afterwards
+	if (mReloadRequested && !mReloadReady.load(std::memory_order_relaxed) &&
+			mReloadCounter.pending.load(std::memory_order_acquire) == 0) {
+		mReloadRequested = false;
+		JobSystem::submit([this]() { reloadShaders(); }, &mReloadCounter);
 	}
-	if (!createPipeline()) {
-		return false;
+}
+
+void VkRenderer::reloadShaders() {
+	PROFILE_FUNCTION();
+	// The keys cover includes too, unrelated files in the directory end here
+	uint64_t vertexShaderKey = ShaderCompiler::getCacheKey(mVertexShaderFileName, {});
+	uint64_t fragmentShaderKey = ShaderCompiler::getCacheKey(mFragmentShaderFileName, {});
+	if (vertexShaderKey == 0 || fragmentShaderKey == 0 ||
+			(vertexShaderKey == mVertexShaderKey && fragmentShaderKey == mFragmentShaderKey)) {
+		return;
 	}
-	if (!createFramebuffer()) {
-		return false;
+	// Remember the sources even if they fail, the next edit retries
+	mVertexShaderKey = vertexShaderKey;
+	mFragmentShaderKey = fragmentShaderKey;
+
+	VkDevice device = mRenderData.rdVkbDevice.device;
+	VkShaderStage vertexShader{};
+	VkShaderStage fragmentShader{};
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	bool result = Shader::loadShader(device, mVertexShaderFileName, vertexShader) &&
+		Shader::loadShader(device, mFragmentShaderFileName, fragmentShader) &&
+		Pipeline::create(mRenderData, vertexShader, fragmentShader, pipeline, pipelineLayout);
+	vkDestroyShaderModule(device, fragmentShader.module, nullptr);
+	vkDestroyShaderModule(device, vertexShader.module, nullptr);
+	if (!result) {
+		LOG(Renderer, 1, "%s error: shader reload failed, keeping the current pipeline\n", __FUNCTION__);
+		return;
 	}
-	if (!createSyncObjects()) {
-		return false;
+	// The descriptor set was allocated for the current layout
+	if (pipelineLayout != mRenderData.rdPipelineLayout) {
+		LOG(Renderer, 1, "%s error: shader descriptors or push constants changed, restart to apply\n", __FUNCTION__);
+		vkDestroyPipeline(device, pipeline, nullptr);
+		return;
 	}
-
-	Logger::log(1, "%s: Vulkan renderer initialized to %ix%i\n", __FUNCTION__, width, height);
-	return true;
+	mReloadedPipeline = pipeline;
+	mReloadReady.store(true, std::memory_order_release);
 }
 
 bool VkRenderer::deviceInit() {
+	PROFILE_FUNCTION();
 	// Build instance with VkBootstrap
 	vkb::InstanceBuilder instBuild;
-	auto instRet = instBuild.use_default_debug_messenger().request_validation_layers().build();
+	// Descriptor indexing for the texture table is core in Vulkan 1.2, synchronization2 and dynamic rendering in 1.3
+	auto instRet = instBuild.use_default_debug_messenger().request_validation_layers().set_headless(mRenderData.rdHeadless)
+		.require_api_version(1, 3, 0).build();
 	if (!instRet) {
-		Logger::log(1, "%s error: could not build vkb instance\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not build vkb instance\n", __FUNCTION__);
 		return false;
 	}
 	mRenderData.rdVkbInstance = instRet.value();
 
-	// Create surface
-	VkResult result = VK_ERROR_UNKNOWN;
-	result = glfwCreateWindowSurface(mRenderData.rdVkbInstance, mWindow, nullptr, &mSurface);
-	if (result != VK_SUCCESS) {
-		Logger::log(1, "%s error: Could not create Vulkan surface\n", __FUNCTION__);
-		return false;
+	// Create surface, a headless instance selects the device without one
+	if (!mRenderData.rdHeadless) {
+		VkResult result = VK_ERROR_UNKNOWN;
+		result = glfwCreateWindowSurface(mRenderData.rdVkbInstance, mWindow, nullptr, &mSurface);
+		if (result != VK_SUCCESS) {
+			LOG(Renderer, 1, "%s error: Could not create Vulkan surface\n", __FUNCTION__);
+			return false;
+		}
 	}
 
 	// Device
 	vkb::PhysicalDeviceSelector physicalDevSel{ mRenderData.rdVkbInstance };
-	auto physicalDevSelRet = physicalDevSel.set_surface(mSurface).select();
+	if (!mRenderData.rdHeadless) {
+		physicalDevSel.set_surface(mSurface);
+	}
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.descriptorIndexing = VK_TRUE;
+	features12.runtimeDescriptorArray = VK_TRUE;
+	features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features12.descriptorBindingPartiallyBound = VK_TRUE;
+	features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	// GPU culling writes one indexed draw per instance and the draw count
+	features12.drawIndirectCount = VK_TRUE;
+	VkPhysicalDeviceFeatures features{};
+	features.multiDrawIndirect = VK_TRUE;
+	features.drawIndirectFirstInstance = VK_TRUE;
+	// The render graph records its barriers and attachments without render pass objects
+	VkPhysicalDeviceVulkan13Features features13{};
+	features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	features13.synchronization2 = VK_TRUE;
+	features13.dynamicRendering = VK_TRUE;
+	physicalDevSel.set_minimum_version(1, 3).set_required_features(features).set_required_features_12(features12)
+		.set_required_features_13(features13);
+	// Driver reported heap budgets, VMA estimates them without the extension
+	physicalDevSel.add_desired_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	// Present ids to wait for, the latency measurement then includes the frames queued for presentation
+	if (!mRenderData.rdHeadless) {
+		physicalDevSel.add_desired_extension(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		physicalDevSel.add_desired_extension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	}
+	auto physicalDevSelRet = physicalDevSel.select();
 	if (!physicalDevSelRet) {
-		Logger::log(1, "%s error: could not get physical devices\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not get physical devices\n", __FUNCTION__);
 		return false;
 	}
 	mPhysDevice = physicalDevSelRet.value();
-	Logger::log(1, "%s: found physical device '%s'\n", __FUNCTION__, mPhysDevice.name.c_str());
+	LOG(Renderer, 1, "%s: found physical device '%s'\n", __FUNCTION__, mPhysDevice.name.c_str());
+	std::vector<std::string> extensions = mPhysDevice.get_extensions();
+	mRenderData.rdMemory.budgetExtension =
+		std::find(extensions.begin(), extensions.end(), VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) != extensions.end();
+
+	// The extensions alone are not enough, both features have to be enabled
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	if (std::find(extensions.begin(), extensions.end(), VK_KHR_PRESENT_ID_EXTENSION_NAME) != extensions.end() &&
+		std::find(extensions.begin(), extensions.end(), VK_KHR_PRESENT_WAIT_EXTENSION_NAME) != extensions.end()) {
+		presentIdFeatures.pNext = &presentWaitFeatures;
+		VkPhysicalDeviceFeatures2 supportedFeatures2{};
+		supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures2.pNext = &presentIdFeatures;
+		vkGetPhysicalDeviceFeatures2(mPhysDevice.physical_device, &supportedFeatures2);
+		presentIdFeatures.pNext = nullptr;
+		mRenderData.rdPresentWait.supported = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+	}
+
+	// Pipeline statistics are optional, enable them if the device has them
+	// The main pass runs in secondary command buffers, they have to inherit the active query
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(mPhysDevice.physical_device, &supportedFeatures);
+	if (supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries) {
+		mPhysDevice.features.pipelineStatisticsQuery = VK_TRUE;
+		mPhysDevice.features.inheritedQueries = VK_TRUE;
+		mRenderData.rdPipelineStatisticsSupported = true;
+	}
+
+	// Texture table size, update-after-bind descriptors have their own limits
+	VkPhysicalDeviceVulkan12Properties properties12{};
+	properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &properties12;
+	vkGetPhysicalDeviceProperties2(mPhysDevice.physical_device, &properties);
+	mRenderData.rdBindlessTextures.capacity = std::min({ VkBindlessTextureData::MAX_TEXTURES,
+		properties12.maxPerStageDescriptorUpdateAfterBindSamplers, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		properties12.maxDescriptorSetUpdateAfterBindSamplers, properties12.maxDescriptorSetUpdateAfterBindSampledImages });
 
 	// Device builder
 	vkb::DeviceBuilder devBuilder{ mPhysDevice };
+	if (mRenderData.rdPresentWait.supported) {
+		devBuilder.add_pNext(&presentIdFeatures).add_pNext(&presentWaitFeatures);
+	}
 	auto devBuilderRet = devBuilder.build();
 	if (!devBuilderRet) {
-		Logger::log(1, "%s error: could not get devices\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not get devices\n", __FUNCTION__);
 		return false;
 	}
 	mRenderData.rdVkbDevice = devBuilderRet.value();
@@ -96,171 +280,915 @@ bool VkRenderer::deviceInit() {
 }
 
 bool VkRenderer::getQueue() {
+	PROFILE_FUNCTION();
 	// Graph queue
 	auto graphQueueRet = mRenderData.rdVkbDevice.get_queue(vkb::QueueType::graphics);
 	if (!graphQueueRet.has_value()) {
-		Logger::log(1, "%s error: could not get graphics queue\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not get graphics queue\n", __FUNCTION__);
 		return false;
 	}
 	mRenderData.rdGraphicsQueue = graphQueueRet.value();
+	mRenderData.rdGraphicsQueueFamily = mRenderData.rdVkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+	// Transfer queue for the defragmentation copies, a family without graphics if there is one
+	mRenderData.rdTransferQueue = mRenderData.rdGraphicsQueue;
+	mRenderData.rdTransferQueueFamily = mRenderData.rdGraphicsQueueFamily;
+	auto dedicatedQueueRet = mRenderData.rdVkbDevice.get_dedicated_queue(vkb::QueueType::transfer);
+	auto transferQueueRet = mRenderData.rdVkbDevice.get_queue(vkb::QueueType::transfer);
+	if (dedicatedQueueRet.has_value()) {
+		mRenderData.rdTransferQueue = dedicatedQueueRet.value();
+		mRenderData.rdTransferQueueFamily = mRenderData.rdVkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+	}
+	else if (transferQueueRet.has_value()) {
+		mRenderData.rdTransferQueue = transferQueueRet.value();
+		mRenderData.rdTransferQueueFamily = mRenderData.rdVkbDevice.get_queue_index(vkb::QueueType::transfer).value();
+	}
+	if (mRenderData.rdHeadless) {
+		return true;
+	}
 	// Present queue
 	auto presentQueueRet = mRenderData.rdVkbDevice.get_queue(vkb::QueueType::present);
 	if (!presentQueueRet.has_value()) {
-		Logger::log(1, "%s error: could not get present queue\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not get present queue\n", __FUNCTION__);
 		return false;
 	}
 	mRenderData.rdPresentQueue = presentQueueRet.value();
 	return true;
 }
 
-bool VkRenderer::createDepthBuffer() {
-	VkExtent3D depthImageExtent = {
-		mRenderData.rdVkbSwapchain.extent.width, 
-		mRenderData.rdVkbSwapchain.extent.height,
-		1
-	};
-	// Image Depth
-	mRenderData.rdDepthFormat = VK_FORMAT_D32_SFLOAT;
-	VkImageCreateInfo depthImageInfo{};
-	depthImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	depthImageInfo.imageType = VK_IMAGE_TYPE_2D;
-	depthImageInfo.format = mRenderData.rdDepthFormat;
-	depthImageInfo.extent = depthImageExtent;
-	depthImageInfo.mipLevels = 1;
-	depthImageInfo.arrayLayers = 1;
-	depthImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	depthImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-	VmaAllocationCreateInfo depthAllocInfo{};
-	depthAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	depthAllocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	if (vmaCreateImage(mRenderData.rdAllocator, &depthImageInfo, &depthAllocInfo, &mRenderData.rdDepthImage, &mRenderData.rdDepthImageAlloc, nullptr) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not allocate depth buffer memory\n", __FUNCTION__);
-		return false;
-	}
-
-	// ImageView Depth
-	VkImageViewCreateInfo depthImageViewinfo{};
-	depthImageViewinfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	depthImageViewinfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	depthImageViewinfo.image = mRenderData.rdDepthImage;
-	depthImageViewinfo.format = mRenderData.rdDepthFormat;
-	depthImageViewinfo.subresourceRange.baseMipLevel = 0;
-	depthImageViewinfo.subresourceRange.levelCount = 1;
-	depthImageViewinfo.subresourceRange.baseArrayLayer = 0;
-	depthImageViewinfo.subresourceRange.layerCount = 1;
-	depthImageViewinfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-	if (vkCreateImageView(mRenderData.rdVkbDevice.device, &depthImageViewinfo, nullptr, &mRenderData.rdDepthImageView) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not create depth buffer image view\n", __FUNCTION__);
+bool VkRenderer::createRenderTarget() {
+	if (!mRenderData.rdHeadless) {
+		return createSwapchain();
+	}
+	PROFILE_FUNCTION();
+	if (!OffscreenTarget::init(mRenderData, mWidth, mHeight)) {
+		LOG(Renderer, 1, "%s error: could not create offscreen target\n", __FUNCTION__);
 		return false;
 	}
-
+	configureFrameLimiter();
 	return true;
 }
 
 bool VkRenderer::createSwapchain() {
+	PROFILE_FUNCTION();
+	VkPresentModeKHR presentMode = PresentMode::select(mPhysDevice.physical_device, mSurface, mRenderData.rdPresentPolicy);
+	// Mailbox needs a spare image to replace, every other mode queues less with two
+	uint32_t imageCount = presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? vkb::SwapchainBuilder::TRIPLE_BUFFERING : vkb::SwapchainBuilder::DOUBLE_BUFFERING;
 	vkb::SwapchainBuilder swapChainBuild{ mRenderData.rdVkbDevice };
-	auto swapChainBuildRet = swapChainBuild.set_old_swapchain(mRenderData.rdVkbSwapchain).set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR).build();
+	swapChainBuild.set_old_swapchain(mRenderData.rdVkbSwapchain).set_desired_present_mode(presentMode)
+		.set_desired_min_image_count(imageCount).set_desired_extent(mWidth, mHeight);
+	// A rebuilt swapchain has to stay compatible with the existing pipelines
+	if (mRenderData.rdVkbSwapchain.swapchain != VK_NULL_HANDLE) {
+		swapChainBuild.set_desired_format({ mRenderData.rdVkbSwapchain.image_format, mRenderData.rdVkbSwapchain.color_space });
+	}
+	auto swapChainBuildRet = swapChainBuild.build();
 	if (!swapChainBuildRet) {
-		Logger::log(1, "%s error: could not init swapchain\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not init swapchain\n", __FUNCTION__);
 		return false;
 	}
-	vkb::destroy_swapchain(mRenderData.rdVkbSwapchain);
+	if (mRenderData.rdVkbSwapchain.swapchain != VK_NULL_HANDLE) {
+		// The presentation engine may still show old images, keep them for a full swapchain cycle
+		vkb::Swapchain oldSwapchain = mRenderData.rdVkbSwapchain;
+		std::vector<VkImageView> oldImageViews = mRenderData.rdSwapchainImageViews;
+		DeletionQueue::push(mRenderData, [oldSwapchain, oldImageViews]() mutable {
+			PresentWait::releaseSwapchain(oldSwapchain.swapchain);
+			oldSwapchain.destroy_image_views(oldImageViews);
+			vkb::destroy_swapchain(oldSwapchain);
+		}, oldSwapchain.image_count);
+	}
 	mRenderData.rdVkbSwapchain = swapChainBuildRet.value();
+
+	auto imagesRet = mRenderData.rdVkbSwapchain.get_images();
+	auto imageViewsRet = mRenderData.rdVkbSwapchain.get_image_views();
+	if (!imagesRet || !imageViewsRet) {
+		LOG(Renderer, 1, "%s error: could not get swapchain images\n", __FUNCTION__);
+		return false;
+	}
+	mRenderData.rdSwapchainImages = imagesRet.value();
+	mRenderData.rdSwapchainImageViews = imageViewsRet.value();
+	if (mRenderData.rdColorFormat != VK_FORMAT_UNDEFINED && mRenderData.rdColorFormat != mRenderData.rdVkbSwapchain.image_format) {
+		LOG(Renderer, 1, "%s error: swapchain format changed, pipelines are incompatible\n", __FUNCTION__);
+		return false;
+	}
+	mRenderData.rdColorFormat = mRenderData.rdVkbSwapchain.image_format;
+	mRenderData.rdRenderExtent = mRenderData.rdVkbSwapchain.extent;
+	mRenderData.rdPresentMode = mRenderData.rdVkbSwapchain.present_mode;
+	LOG(Renderer, 1, "%s: %s with %u images\n", __FUNCTION__, PresentMode::getName(mRenderData.rdPresentMode), mRenderData.rdVkbSwapchain.image_count);
+	configureFrameLimiter();
 	return true;
 }
 
+void VkRenderer::configureFrameLimiter() {
+	uint64_t frameTime = 0;
+	if (mFrameRateLimit > 0.0f) {
+		frameTime = static_cast<uint64_t>(1.0e9 / mFrameRateLimit);
+	}
+	// FIFO blocks on vblank anyway, pacing to the refresh keeps the queue empty so input is sampled late
+	bool fifoMode = mRenderData.rdPresentMode == VK_PRESENT_MODE_FIFO_KHR || mRenderData.rdPresentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	if (!mRenderData.rdHeadless && fifoMode && mRefreshRate > 0) {
+		frameTime = std::max(frameTime, static_cast<uint64_t>(1.0e9 / mRefreshRate));
+	}
+	mFrameLimiter.setTargetFrameTime(frameTime);
+	if (frameTime > 0) {
+		LOG(Renderer, 1, "%s: pacing frames to %.2f ms\n", __FUNCTION__, frameTime / 1.0e6);
+	}
+}
+
 bool VkRenderer::recreateSwapchain() {
+	PROFILE_FUNCTION();
+	uint64_t startTime = Profiler::now();
+	// A minimized window has no extent, draw() skips frames until it is restored
+	if (mResizePending && (mPendingWidth == 0 || mPendingHeight == 0)) {
+		return true;
+	}
+	if (mResizePending) {
+		mWidth = mPendingWidth;
+		mHeight = mPendingHeight;
+		mResizePending = false;
+	}
+
+	// The render graph replaces the depth buffer once it is declared with the new extent
+	if (!createSwapchain()) {
+		LOG(Renderer, 1, "%s error: could not recreate swapchain\n", __FUNCTION__);
+		return false;
+	}
+	LOG(Renderer, 2, "%s: swapchain recreated at %ux%u in %.2f ms\n", __FUNCTION__,
+		mRenderData.rdRenderExtent.width, mRenderData.rdRenderExtent.height, (Profiler::now() - startTime) / 1.0e6);
 	return true;
 }
 
-bool VkRenderer::createRenderPass() {
+bool VkRenderer::createPipeline() {
+	PROFILE_FUNCTION();
+	bool result = Pipeline::init(mRenderData, mVertexShader, mFragmentShader);
+	// Shader modules are not needed once the pipeline exists
+	vkDestroyShaderModule(mRenderData.rdVkbDevice.device, mFragmentShader.module, nullptr);
+	vkDestroyShaderModule(mRenderData.rdVkbDevice.device, mVertexShader.module, nullptr);
+	mFragmentShader = VkShaderStage{};
+	mVertexShader = VkShaderStage{};
+	if (!result) {
+		LOG(Renderer, 1, "%s error: could not init pipeline\n", __FUNCTION__);
+		return false;
+	}
 	return true;
 }
 
-bool VkRenderer::createPipeline() {
-	std::string vertexShaderFile = "shader/basic.vert.spv";
-	std::string fragmentShaderFile = "shader/basic.frag.spv";
-	if (!Pipeline::init(mRenderData, vertexShaderFile, fragmentShaderFile)) {
-		Logger::log(1, "%s error: could not init pipeline\n", __FUNCTION__);
+bool VkRenderer::createPipelineCache() {
+	PROFILE_FUNCTION();
+	if (!PipelineCache::init(mRenderData, mPipelineCacheFileName)) {
+		LOG(Renderer, 1, "%s error: could not create pipeline cache\n", __FUNCTION__);
 		return false;
 	}
 	return true;
 }
 
-bool VkRenderer::createFramebuffer() {
+bool VkRenderer::loadShader(std::string shaderFileName, VkShaderStage& shader) {
+	PROFILE_FUNCTION();
+	if (!Shader::loadShader(mRenderData.rdVkbDevice.device, shaderFileName, shader)) {
+		LOG(Renderer, 1, "%s error: could not load shader '%s'\n", __FUNCTION__, shaderFileName.c_str());
+		return false;
+	}
 	return true;
 }
 
 bool VkRenderer::createCommandPool() {
+	PROFILE_FUNCTION();
 	if (!CommandPool::init(mRenderData)) {
-		Logger::log(1, "%s error: could not craete command pool\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not craete command pool\n", __FUNCTION__);
 		return false;
 	}
 	return true;
 }
 
-bool VkRenderer::createCommandBuffer() {
-	if (!CommandBuffer::init(mRenderData, mRenderData.rdCommandBuffer)) {
-		Logger::log(1, "% s error : could not create command buffer\n", __FUNCTION__);
+bool VkRenderer::createSyncObjects() {
+	PROFILE_FUNCTION();
+	if (!SyncObjects::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not create sync objects\n", __FUNCTION__);
 		return false;
 	}
 	return true;
 }
 
-bool VkRenderer::createSyncObjects() {
+bool VkRenderer::createQueryPool() {
+	PROFILE_FUNCTION();
+	if (!QueryPool::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not create query pools\n", __FUNCTION__);
+		return false;
+	}
 	return true;
 }
 
-bool VkRenderer::loadTexture() {
+bool VkRenderer::createPresentWait() {
+	PROFILE_FUNCTION();
+	if (!PresentWait::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not start present wait thread\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::decodeTexture() {
+	PROFILE_FUNCTION();
 	std::string textureFileName = "textures/crate.png";
-	if (!Texture::loadTexture(mRenderData, textureFileName)) {
-		Logger::log(1, "% s error : could not load texture\n", __FUNCTION__);
+	if (!Texture::decodeTexture(textureFileName, mTextureData)) {
+		LOG(Renderer, 1, "%s error: could not load texture\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::createBindlessTextures() {
+	PROFILE_FUNCTION();
+	if (!BindlessTextures::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not create texture table\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::createDescriptorAllocator() {
+	PROFILE_FUNCTION();
+	if (!DescriptorAllocator::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not create descriptor allocator\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::createGpuCulling() {
+	PROFILE_FUNCTION();
+	if (!GpuCulling::init(mRenderData, mCullShaderFileName, mClusterCullShaderFileName)) {
+		LOG(Renderer, 1, "%s error: could not init GPU culling\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::uploadTexture() {
+	PROFILE_FUNCTION();
+	// The streaming keeps the mip chain
+	mRenderData.rdTextureIndex = TextureStreaming::addTexture(mRenderData, std::move(mTextureData));
+	mTextureData = VkTextureData{};
+	if (mRenderData.rdTextureIndex == UINT32_MAX) {
+		LOG(Renderer, 1, "%s error: could not upload texture\n", __FUNCTION__);
 		return false;
 	}
 	return true;
 }
 
 bool VkRenderer::initVma() {
+	PROFILE_FUNCTION();
 	VmaAllocatorCreateInfo allocatorInfo{};
 	allocatorInfo.physicalDevice = mPhysDevice.physical_device;
 	allocatorInfo.device = mRenderData.rdVkbDevice.device;
 	allocatorInfo.instance = mRenderData.rdVkbInstance.instance;
+	allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+	if (mRenderData.rdMemory.budgetExtension) {
+		allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	}
 	if (vmaCreateAllocator(&allocatorInfo, &mRenderData.rdAllocator) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not init VMA\n", __FUNCTION__);
+		LOG(Renderer, 1, "%s error: could not init VMA\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::createTextureStreaming() {
+	PROFILE_FUNCTION();
+	if (!TextureStreaming::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not init texture streaming\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::createMemoryManager() {
+	PROFILE_FUNCTION();
+	if (!MemoryManager::init(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not init memory manager\n", __FUNCTION__);
 		return false;
 	}
 	return true;
 }
 
 void VkRenderer::setSize(unsigned int width, unsigned int height) {
-	Logger::log(1, "%s: resized window to %ix%i\n", __FUNCTION__, width, height);
+	LOG(Renderer, 2, "%s: resized window to %ix%i\n", __FUNCTION__, width, height);
+	mPendingWidth = width;
+	mPendingHeight = height;
+	mResizeRequestTime = Profiler::now();
+	mResizePending = true;
 }
 
 bool VkRenderer::uploadData(VkMesh vertexData) {
+	PROFILE_FUNCTION();
+	if (vertexData.indices.empty()) {
+		vertexData.indices.resize(vertexData.vertices.size());
+		for (size_t i = 0; i < vertexData.indices.size(); ++i) {
+			vertexData.indices.at(i) = static_cast<uint32_t>(i);
+		}
+	}
+	// Replace the previous buffers, the GPU may still be reading them
+	retireBuffer(mVertexBuffer, mVertexBufferAlloc);
+	retireBuffer(mIndexBuffer, mIndexBufferAlloc);
+	// Repeated uploads without drawing must not pile up buffers, nothing is in flight when the fence is signaled
+	if (!mRenderData.rdFrameSubmitted || vkGetFenceStatus(mRenderData.rdVkbDevice.device, mRenderData.rdRenderFence) == VK_SUCCESS) {
+		DeletionQueue::flush(mRenderData);
+	}
+	std::vector<uint8_t> encodedVertices;
+	VertexFormat::encode(mRenderData.rdVertexFormat, vertexData.vertices, encodedVertices, mPositionDequantization);
+	if (!createHostBuffer(encodedVertices.data(), encodedVertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			mVertexBuffer, mVertexBufferAlloc) ||
+		!createHostBuffer(vertexData.indices.data(), vertexData.indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			mIndexBuffer, mIndexBufferAlloc)) {
+		LOG(Renderer, 1, "%s error: could not upload mesh\n", __FUNCTION__);
+		return false;
+	}
+
+	// Bounding sphere around the box center, good enough for culling
+	glm::vec3 minimum(std::numeric_limits<float>::max());
+	glm::vec3 maximum(std::numeric_limits<float>::lowest());
+	for (const VkVertex& vertex : vertexData.vertices) {
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+	glm::vec3 center = vertexData.vertices.empty() ? glm::vec3(0.0f) : (minimum + maximum) * 0.5f;
+	float radius = 0.0f;
+	for (const VkVertex& vertex : vertexData.vertices) {
+		radius = std::max(radius, glm::length(vertex.position - center));
+	}
+	VkMeshDrawData mesh{};
+	mesh.boundingSphere = glm::vec4(center, radius);
+	mesh.vertexOffset = 0;
+	if (vertexData.lods.empty()) {
+		vertexData.lods.push_back({ 0, static_cast<uint32_t>(vertexData.indices.size()), 0.0f });
+	}
+	mesh.lodCount = std::min<uint32_t>(static_cast<uint32_t>(vertexData.lods.size()), VkMeshDrawData::MAX_LODS);
+	for (uint32_t i = 0; i < mesh.lodCount; ++i) {
+		mesh.lods[i] = vertexData.lods.at(i);
+	}
+	mMeshes = { mesh };
+	if (!mInstancesSet) {
+		VkInstanceData instance{};
+		instance.textureIndex = mRenderData.rdTextureIndex;
+		mInstances = { instance };
+	}
+	mSceneChanged = true;
+	return true;
+}
+
+bool VkRenderer::uploadEnvironment(VkMesh mesh) {
+	PROFILE_FUNCTION();
+	if (!GpuCulling::uploadClusters(mRenderData, mesh, mRenderData.rdTextureIndex)) {
+		LOG(Renderer, 1, "%s error: could not upload environment mesh\n", __FUNCTION__);
+		return false;
+	}
+	// Bounds for the texture streaming, the mesh is drawn in world space
+	mEnvironmentSphere = glm::vec4(0.0f);
+	if (!mesh.vertices.empty()) {
+		glm::vec3 minPosition = mesh.vertices.front().position;
+		glm::vec3 maxPosition = minPosition;
+		for (const VkVertex& vertex : mesh.vertices) {
+			minPosition = glm::min(minPosition, vertex.position);
+			maxPosition = glm::max(maxPosition, vertex.position);
+		}
+		glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+		float radius = 0.0f;
+		for (const VkVertex& vertex : mesh.vertices) {
+			radius = std::max(radius, glm::length(vertex.position - center));
+		}
+		mEnvironmentSphere = glm::vec4(center, radius);
+	}
+	return true;
+}
+
+void VkRenderer::setInstances(std::vector<VkInstanceData> instances) {
+	mInstances = std::move(instances);
+	mInstancesSet = true;
+	mSceneChanged = true;
+}
+
+void VkRenderer::setViewProjection(const glm::mat4& viewProjection) {
+	mViewProjection = viewProjection;
+}
+
+void VkRenderer::setLodErrorThreshold(float pixels) {
+	mRenderData.rdCulling.lodErrorPixels = pixels;
+}
+
+bool VkRenderer::createHostBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& bufferAlloc) {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = vertexData.vertices.size() * sizeof(VkVertex);
-	bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	// The defragmentation may move the buffer, draws read the handle again every frame
+	MemoryManager::prepareMovableBuffer(mRenderData, bufferInfo);
 	VmaAllocationCreateInfo vmaAllocInfo{};
 	vmaAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-	if (vmaCreateBuffer(mRenderData.rdAllocator, &bufferInfo, &vmaAllocInfo, &mVertexBuffer, &mVertexBufferAlloc, nullptr) != VK_SUCCESS) {
-		Logger::log(1, "%s error: could not allocate vertex buffer via VMA\n", __FUNCTION__);
+	if (vmaCreateBuffer(mRenderData.rdAllocator, &bufferInfo, &vmaAllocInfo, &buffer, &bufferAlloc, nullptr) != VK_SUCCESS) {
+		LOG(Renderer, 1, "%s error: could not allocate buffer via VMA\n", __FUNCTION__);
 		return false;
 	}
+	MemoryManager::registerMovableBuffer(mRenderData, buffer, bufferAlloc, bufferInfo);
 
-	void* data;
-	vmaMapMemory(mRenderData.rdAllocator, mVertexBufferAlloc, &data);
-	std::memcpy(data, vertexData.vertices.data(), vertexData.vertices.size() * sizeof(VkVertex));
-	vmaUnmapMemory(mRenderData.rdAllocator, mVertexBufferAlloc);
-	mTriangleCount = vertexData.vertices.size() / 3;
+	void* mappedData;
+	vmaMapMemory(mRenderData.rdAllocator, bufferAlloc, &mappedData);
+	std::memcpy(mappedData, data, size);
+	vmaUnmapMemory(mRenderData.rdAllocator, bufferAlloc);
 	return true;
 }
 
+void VkRenderer::retireBuffer(VkBuffer& buffer, VmaAllocation& bufferAlloc) {
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	MemoryManager::unregisterMovableBuffer(mRenderData, bufferAlloc);
+	VkBuffer oldBuffer = buffer;
+	VmaAllocation oldBufferAlloc = bufferAlloc;
+	DeletionQueue::push(mRenderData, [&renderData = mRenderData, oldBuffer, oldBufferAlloc]() {
+		DescriptorAllocator::invalidate(renderData, oldBuffer);
+		vmaDestroyBuffer(renderData.rdAllocator, oldBuffer, oldBufferAlloc);
+	});
+	buffer = VK_NULL_HANDLE;
+	bufferAlloc = VK_NULL_HANDLE;
+}
+
+void VkRenderer::setTextureBudget(VkDeviceSize bytes) {
+	mRenderData.rdTextureStreaming.budget = bytes;
+}
+
+void VkRenderer::setCpuDrawList(bool enabled) {
+	mCpuDrawList = enabled;
+	mSceneChanged = true;
+}
+
+void VkRenderer::setShaderFeatures(uint32_t features) {
+	mShaderFeatures = features;
+}
+
+void VkRenderer::waitForFrameStart() {
+	mFrameLimiter.waitForFrameStart();
+	mInputTime = Profiler::now();
+}
+
 bool VkRenderer::draw() {
+	PROFILE_FUNCTION();
+	// Input was polled after waitForFrameStart, callers without it start the frame here
+	uint64_t drawStart = Profiler::now();
+	uint64_t frameStart = mInputTime != 0 ? mInputTime : drawStart;
+	mInputTime = 0;
+	{
+		PROFILE_ZONE("waitForFence");
+		if (mRenderData.rdFrameSubmitted &&
+			vkWaitForFences(mRenderData.rdVkbDevice.device, 1, &mRenderData.rdRenderFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+			LOG(Renderer, 1, "%s error: waiting for fence failed\n", __FUNCTION__);
+			return false;
+		}
+		mRenderData.rdFrameSubmitted = false;
+	}
+	DeletionQueue::flush(mRenderData);
+	MemoryManager::beginFrame(mRenderData);
+	DescriptorAllocator::beginFrame(mRenderData);
+	if (!CommandPool::beginFrame(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not reset command pools\n", __FUNCTION__);
+		return false;
+	}
+	// The culling buffers are only read by the frame that just completed
+	if (mSceneChanged) {
+		mSceneChanged = false;
+		if (!GpuCulling::uploadScene(mRenderData, mInstances, mMeshes)) {
+			LOG(Renderer, 1, "%s error: could not upload instances\n", __FUNCTION__);
+			return false;
+		}
+		if (mCpuDrawList) {
+			buildSceneBvh();
+		}
+	}
+	// Residency changes are copied at the start of this frame
+	requestTextureMips();
+	TextureStreaming::update(mRenderData);
+	if (!mRenderData.rdHeadless) {
+		updateShaderReload();
+	}
+
+	if (mResizePending) {
+		// Nothing to render into while minimized
+		if (mPendingWidth == 0 || mPendingHeight == 0) {
+			return true;
+		}
+		if (Profiler::now() - mResizeRequestTime >= RESIZE_DEBOUNCE_TIME && !recreateSwapchain()) {
+			return false;
+		}
+	}
+
+	// Headless mode always renders to the single offscreen image
+	uint32_t imageIndex = 0;
+	if (!mRenderData.rdHeadless) {
+		PROFILE_ZONE("acquireImage");
+		VkResult result = vkAcquireNextImageKHR(mRenderData.rdVkbDevice.device, mRenderData.rdVkbSwapchain.swapchain, UINT64_MAX,
+			mRenderData.rdPresentSemaphore, VK_NULL_HANDLE, &imageIndex);
+		// The old swapchain cannot be used at all, rebuild without waiting for the debounce
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			return recreateSwapchain();
+		}
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			LOG(Renderer, 1, "%s error: failed to acquire swapchain image (%i)\n", __FUNCTION__, result);
+			return false;
+		}
+	}
+	uint64_t blockedTime = Profiler::now() - drawStart;
+	if (vkResetFences(mRenderData.rdVkbDevice.device, 1, &mRenderData.rdRenderFence) != VK_SUCCESS) {
+		LOG(Renderer, 1, "%s error: fence reset failed\n", __FUNCTION__);
+		return false;
+	}
+
+	{
+		PROFILE_ZONE("recordCommands");
+		// Reset with its pool in CommandPool::beginFrame
+		VkCommandBufferBeginInfo cmdBeginInfo{};
+		cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(mRenderData.rdCommandBuffer, &cmdBeginInfo) != VK_SUCCESS) {
+			LOG(Renderer, 1, "%s error: failed to begin command buffer\n", __FUNCTION__);
+			return false;
+		}
+		QueryPool::beginFrame(mRenderData, mRenderData.rdCommandBuffer);
+		if (!TextureStreaming::recordUploads(mRenderData, mRenderData.rdCommandBuffer)) {
+			LOG(Renderer, 1, "%s error: could not record texture uploads\n", __FUNCTION__);
+			return false;
+		}
+
+		if (mCpuDrawList) {
+			PROFILE_ZONE("cullInstances");
+			mVisibleInstances.clear();
+			mSceneBvh.cullParallel(Frustum::fromViewProjection(mViewProjection), mVisibleInstances);
+			// Deterministic draw order, the parallel cull appends in any order
+			std::sort(mVisibleInstances.begin(), mVisibleInstances.end());
+		}
+		if (!buildRenderGraph(imageIndex) || !mRenderGraph.execute(mRenderData, mRenderData.rdCommandBuffer)) {
+			LOG(Renderer, 1, "%s error: could not record the frame\n", __FUNCTION__);
+			return false;
+		}
+
+		if (vkEndCommandBuffer(mRenderData.rdCommandBuffer) != VK_SUCCESS) {
+			LOG(Renderer, 1, "%s error: failed to end command buffer\n", __FUNCTION__);
+			return false;
+		}
+	}
+
+	{
+		PROFILE_ZONE("submit");
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		// Nothing is acquired or presented in headless mode
+		submitInfo.waitSemaphoreCount = mRenderData.rdHeadless ? 0 : 1;
+		submitInfo.pWaitSemaphores = &mRenderData.rdPresentSemaphore;
+		submitInfo.signalSemaphoreCount = mRenderData.rdHeadless ? 0 : 1;
+		submitInfo.pSignalSemaphores = &mRenderData.rdRenderSemaphore;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &mRenderData.rdCommandBuffer;
+		if (vkQueueSubmit(mRenderData.rdGraphicsQueue, 1, &submitInfo, mRenderData.rdRenderFence) != VK_SUCCESS) {
+			LOG(Renderer, 1, "%s error: failed to submit draw command buffer\n", __FUNCTION__);
+			return false;
+		}
+		mRenderData.rdFrameSubmitted = true;
+		++mRenderData.rdFrameNumber;
+		QueryPool::endFrame(mRenderData);
+	}
+
+	if (!mRenderData.rdHeadless) {
+		PROFILE_ZONE("present");
+		VkPresentInfoKHR presentInfo{};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &mRenderData.rdRenderSemaphore;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &mRenderData.rdVkbSwapchain.swapchain;
+		presentInfo.pImageIndices = &imageIndex;
+		uint64_t presentIdValue = 0;
+		VkPresentIdKHR presentId{};
+		if (PresentWait::isActive(mRenderData)) {
+			presentIdValue = PresentWait::nextPresentId(mRenderData);
+			presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+			presentId.swapchainCount = 1;
+			presentId.pPresentIds = &presentIdValue;
+			presentInfo.pNext = &presentId;
+		}
+		VkResult result = vkQueuePresentKHR(mRenderData.rdPresentQueue, &presentInfo);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			return recreateSwapchain();
+		}
+		// Still presentable, let the debounce pick up the new size
+		if (result == VK_SUBOPTIMAL_KHR && !mResizePending) {
+			setSize(mRenderData.rdRenderExtent.width, mRenderData.rdRenderExtent.height);
+		}
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			LOG(Renderer, 1, "%s error: failed to present swapchain image\n", __FUNCTION__);
+			return false;
+		}
+		if (presentIdValue != 0) {
+			PresentWait::track(mRenderData, presentIdValue, frameStart);
+		}
+	}
+	uint64_t frameEnd = Profiler::now();
+	mFrameLimiter.frameDone(frameEnd - frameStart, blockedTime);
+	// With FIFO present returns long before the frame is shown, only the present wait sees the queued frames
+	mFrameLatency.presentMeasured = PresentWait::isActive(mRenderData);
+	if (mFrameLatency.presentMeasured) {
+		for (float latency : PresentWait::getCompletedLatencies()) {
+			addLatencySample(latency);
+		}
+	}
+	else {
+		addLatencySample((frameEnd - frameStart) / 1.0e6f);
+	}
+
+	if (!mFirstFramePresented) {
+		mFirstFramePresented = true;
+		LOG(Renderer, 1, "%s: first frame %s %.2f ms after startup\n", __FUNCTION__, mRenderData.rdHeadless ? "submitted" : "presented", Profiler::now() / 1.0e6);
+	}
 	return true;
 }
 
-void VkRenderer::cleanup() {
+std::vector<VkGpuPassTiming> VkRenderer::getGpuPassTimings() {
+	return mRenderData.rdQueries.passTimings;
+}
+
+std::vector<VkHeapBudget> VkRenderer::getMemoryBudgets() {
+	return MemoryManager::getHeapBudgets(mRenderData);
+}
 
+bool VkRenderer::readPixels(std::vector<unsigned char>& pixels, unsigned int& width, unsigned int& height) {
+	PROFILE_FUNCTION();
+	if (!OffscreenTarget::readPixels(mRenderData, pixels)) {
+		return false;
+	}
+	width = mRenderData.rdRenderExtent.width;
+	height = mRenderData.rdRenderExtent.height;
+	return true;
+}
+
+bool VkRenderer::buildRenderGraph(uint32_t imageIndex) {
+	PROFILE_FUNCTION();
+	mRenderGraph.reset();
+	// Headless mode always renders to the single offscreen image, it is read back by a transfer
+	VkRenderGraphResource color = mRenderData.rdHeadless ?
+		mRenderGraph.importImage("color", mRenderData.rdOffscreenImage, mRenderData.rdOffscreenImageView, mRenderData.rdColorFormat,
+			mRenderData.rdRenderExtent, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) :
+		mRenderGraph.importImage("color", mRenderData.rdSwapchainImages.at(imageIndex), mRenderData.rdSwapchainImageViews.at(imageIndex),
+			mRenderData.rdColorFormat, mRenderData.rdRenderExtent, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	mRenderGraph.markOutput(color);
+	VkRenderGraphResource depth = mRenderGraph.createImage("depth", mRenderData.rdDepthFormat, mRenderData.rdRenderExtent);
+	VkCullingData& culling = mRenderData.rdCulling;
+	VkClusterCullingData& clusters = mRenderData.rdClusterCulling;
+	VkRenderGraphResource drawCommands = mRenderGraph.importBuffer("drawCommands", culling.drawBuffer);
+	VkRenderGraphResource drawCount = mRenderGraph.importBuffer("drawCount", culling.countBuffer);
+	VkRenderGraphResource clusterIndices = mRenderGraph.importBuffer("clusterIndices", clusters.indexBuffer);
+	VkRenderGraphResource clusterDraw = mRenderGraph.importBuffer("clusterDraw", clusters.drawBuffer);
+
+	// Nothing reads the indirect draws while the CPU draw list is used, the graph culls the pass then
+	uint32_t instanceCulling = mRenderGraph.addPass("instanceCulling", [this](VkCommandBuffer commandBuffer) {
+		GpuCulling::recordCulling(mRenderData, commandBuffer, mViewProjection);
+		return true;
+	});
+	mRenderGraph.writeBuffer(instanceCulling, drawCommands, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	mRenderGraph.writeBuffer(instanceCulling, drawCount, VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	uint32_t clusterCulling = mRenderGraph.addPass("clusterCulling", [this](VkCommandBuffer commandBuffer) {
+		GpuCulling::recordClusterCulling(mRenderData, commandBuffer, mViewProjection);
+		return true;
+	});
+	mRenderGraph.writeBuffer(clusterCulling, clusterIndices, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	mRenderGraph.writeBuffer(clusterCulling, clusterDraw, VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	uint32_t mainPass = mRenderGraph.addPass("mainPass", [this](VkCommandBuffer commandBuffer) {
+		if (!recordMainPass(mRenderData.rdColorFormat, mRenderData.rdDepthFormat)) {
+			return false;
+		}
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(mSecondaryBuffers.size()), mSecondaryBuffers.data());
+		return true;
+	});
+	mRenderGraph.setColorAttachment(mainPass, color, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.1f, 0.1f, 0.1f, 1.0f } });
+	mRenderGraph.setDepthAttachment(mainPass, depth, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f);
+	mRenderGraph.setSecondaryCommandBuffers(mainPass);
+	if (!mCpuDrawList) {
+		mRenderGraph.readBuffer(mainPass, drawCommands, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+		mRenderGraph.readBuffer(mainPass, drawCount, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+	}
+	mRenderGraph.readBuffer(mainPass, clusterDraw, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+	mRenderGraph.readBuffer(mainPass, clusterIndices, VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
+
+	if (!mRenderGraph.compile(mRenderData)) {
+		LOG(Renderer, 1, "%s error: could not compile the render graph\n", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool VkRenderer::recordMainPass(VkFormat colorFormat, VkFormat depthFormat) {
+	PROFILE_FUNCTION();
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	ShaderPermutations::getPipeline(mRenderData, mShaderFeatures, pipeline, pipelineLayout);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(mRenderData.rdRenderExtent.width);
+	viewport.height = static_cast<float>(mRenderData.rdRenderExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = mRenderData.rdRenderExtent;
+	VkDrawData drawData{};
+	drawData.viewProjection = mViewProjection;
+	drawData.positionDequantization = mPositionDequantization;
+	VkCullData cullData = GpuCulling::getCullData(mRenderData, mViewProjection);
+
+	bool drawInstances = mVertexBuffer != VK_NULL_HANDLE && mRenderData.rdCulling.instanceSet != VK_NULL_HANDLE;
+	size_t drawCount = drawInstances && mCpuDrawList ? mVisibleInstances.size() : 0;
+	// Chunk 0 has the GPU driven draws, the CPU draw list follows in fixed size chunks, executed in chunk order
+	size_t chunkCount = 1 + (drawCount + DRAWS_PER_CHUNK - 1) / DRAWS_PER_CHUNK;
+	mSecondaryBuffers.assign(chunkCount, VK_NULL_HANDLE);
+	std::atomic<bool> failed{ false };
+	JobSystem::parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; ++chunk) {
+			VkCommandBuffer commandBuffer = CommandPool::beginSecondary(mRenderData, colorFormat, depthFormat);
+			if (commandBuffer == VK_NULL_HANDLE) {
+				failed.store(true, std::memory_order_relaxed);
+				continue;
+			}
+			// Nothing is inherited from the primary buffer or other secondary buffers
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			// Texture table and view are shared by the instanced and the meshlet draws
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
+				&mRenderData.rdBindlessTextures.set, 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VkDrawData), &drawData);
+			if (drawInstances && (chunk > 0 || !mCpuDrawList)) {
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1,
+					&mRenderData.rdCulling.instanceSet, 0, nullptr);
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mVertexBuffer, &offset);
+				vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			}
+
+			if (chunk == 0) {
+				// The culling pass wrote one draw per visible instance
+				if (drawInstances && !mCpuDrawList) {
+					GpuCulling::recordDraws(mRenderData, commandBuffer);
+				}
+				GpuCulling::recordClusterDraws(mRenderData, commandBuffer, pipelineLayout);
+			}
+			else {
+				// firstInstance is the index into the instance buffer, like in the indirect draws
+				size_t first = (chunk - 1) * DRAWS_PER_CHUNK;
+				size_t last = std::min(first + DRAWS_PER_CHUNK, drawCount);
+				for (size_t i = first; i < last; ++i) {
+					uint32_t instanceIndex = mVisibleInstances[i];
+					const VkInstanceData& instance = mInstances[instanceIndex];
+					const VkMeshDrawData& mesh = mMeshes[instance.meshIndex];
+					const VkMeshLod& lod = mesh.lods[GpuCulling::selectLod(cullData, mesh, instance)];
+					vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, mesh.vertexOffset, instanceIndex);
+				}
+			}
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				failed.store(true, std::memory_order_relaxed);
+				continue;
+			}
+			mSecondaryBuffers[chunk] = commandBuffer;
+		}
+	});
+	return !failed.load(std::memory_order_relaxed);
+}
+
+void VkRenderer::buildSceneBvh() {
+	PROFILE_FUNCTION();
+	// Boxes around the bounding spheres, instances of a missing mesh are skipped by an empty box at their position
+	std::vector<Aabb> bounds(mInstances.size());
+	for (size_t i = 0; i < mInstances.size(); ++i) {
+		const VkInstanceData& instance = mInstances[i];
+		glm::vec3 center = glm::vec3(instance.positionScale);
+		float radius = 0.0f;
+		if (instance.meshIndex < mMeshes.size()) {
+			const glm::vec4& sphere = mMeshes[instance.meshIndex].boundingSphere;
+			center += glm::vec3(sphere) * instance.positionScale.w;
+			radius = sphere.w * instance.positionScale.w;
+		}
+		bounds[i] = { center - glm::vec3(radius), center + glm::vec3(radius) };
+	}
+	mSceneBvh.build(bounds);
+}
+
+void VkRenderer::requestTextureMips() {
+	PROFILE_FUNCTION();
+	Frustum frustum = Frustum::fromViewProjection(mViewProjection);
+	VkCullData cullData = GpuCulling::getCullData(mRenderData, mViewProjection);
+	// Diameter in pixels at the nearest point of the bounds, the texture is mapped across it once; 0 outside the view
+	auto getScreenSize = [&frustum, &cullData](glm::vec3 center, float radius) {
+		for (const glm::vec4& plane : frustum.planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return 0.0f;
+			}
+		}
+		float nearestW = glm::dot(glm::vec3(cullData.clipW), center) + cullData.clipW.w - radius * glm::length(glm::vec3(cullData.clipW));
+		if (nearestW <= 0.0f) {
+			return std::numeric_limits<float>::max();
+		}
+		return 2.0f * radius * cullData.pixelsPerUnit / nearestW;
+	};
+
+	// Instances share a few textures, only the largest size of each is requested
+	std::vector<std::pair<uint32_t, float>> screenSizes;
+	auto addScreenSize = [&screenSizes](uint32_t textureIndex, float pixels) {
+		if (pixels <= 0.0f) {
+			return;
+		}
+		for (auto& screenSize : screenSizes) {
+			if (screenSize.first == textureIndex) {
+				screenSize.second = std::max(screenSize.second, pixels);
+				return;
+			}
+		}
+		screenSizes.emplace_back(textureIndex, pixels);
+	};
+	for (const VkInstanceData& instance : mInstances) {
+		if (instance.meshIndex >= mMeshes.size()) {
+			continue;
+		}
+		const glm::vec4& sphere = mMeshes[instance.meshIndex].boundingSphere;
+		glm::vec3 center = glm::vec3(sphere) * instance.positionScale.w + glm::vec3(instance.positionScale);
+		addScreenSize(instance.textureIndex, getScreenSize(center, sphere.w * instance.positionScale.w));
+	}
+	if (mEnvironmentSphere.w > 0.0f) {
+		addScreenSize(mRenderData.rdTextureIndex, getScreenSize(glm::vec3(mEnvironmentSphere), mEnvironmentSphere.w));
+	}
+	for (const auto& screenSize : screenSizes) {
+		TextureStreaming::requestScreenSize(mRenderData, screenSize.first, screenSize.second);
+	}
+}
+
+void VkRenderer::addLatencySample(float milliseconds) {
+	mFrameLatency.lastMilliseconds = milliseconds;
+	mFrameLatency.maximumMilliseconds = std::max(mFrameLatency.maximumMilliseconds, milliseconds);
+	mLatencySum += milliseconds;
+	++mLatencyFrames;
+	mFrameLatency.averageMilliseconds = static_cast<float>(mLatencySum / mLatencyFrames);
+	if (mLatencyFrames % 300 == 0) {
+		LOG(Renderer, 2, "%s: %s %.2f ms average, %.2f ms maximum\n", __FUNCTION__,
+			mFrameLatency.presentMeasured ? "input-to-present" : "CPU submit latency",
+			mFrameLatency.averageMilliseconds, mFrameLatency.maximumMilliseconds);
+	}
+}
+
+VkFrameLatency VkRenderer::getFrameLatency() {
+	return mFrameLatency;
+}
+
+void VkRenderer::cleanup() {
+	// A reload job may still be building a pipeline
+	JobSystem::wait(mReloadCounter);
+	mShaderWatcher.cleanup();
+	// Waits on the swapchain, stopped before it is destroyed
+	PresentWait::cleanup(mRenderData);
+	vkDeviceWaitIdle(mRenderData.rdVkbDevice.device);
+	vkDestroyPipeline(mRenderData.rdVkbDevice.device, mReloadedPipeline, nullptr);
+	// Moves the copies of the last pass into their owners before the buffers are destroyed
+	MemoryManager::cleanup(mRenderData);
+	DeletionQueue::cleanup(mRenderData);
+	QueryPool::cleanup(mRenderData);
+	TextureStreaming::cleanup(mRenderData);
+	BindlessTextures::cleanup(mRenderData);
+	GpuCulling::cleanup(mRenderData);
+	DescriptorAllocator::cleanup(mRenderData);
+	SyncObjects::cleanup(mRenderData);
+	CommandPool::cleanup(mRenderData);
+	mRenderGraph.cleanup(mRenderData);
+	ShaderPermutations::cleanup(mRenderData);
+	Pipeline::cleanup(mRenderData);
+	PipelineCache::cleanup(mRenderData, mPipelineCacheFileName);
+	LayoutCache::cleanup(mRenderData);
+	if (mVertexBuffer != VK_NULL_HANDLE) {
+		vmaDestroyBuffer(mRenderData.rdAllocator, mVertexBuffer, mVertexBufferAlloc);
+	}
+	if (mIndexBuffer != VK_NULL_HANDLE) {
+		vmaDestroyBuffer(mRenderData.rdAllocator, mIndexBuffer, mIndexBufferAlloc);
+	}
+	OffscreenTarget::cleanup(mRenderData);
+	vmaDestroyAllocator(mRenderData.rdAllocator);
+	mRenderData.rdVkbSwapchain.destroy_image_views(mRenderData.rdSwapchainImageViews);
+	vkb::destroy_swapchain(mRenderData.rdVkbSwapchain);
+	vkb::destroy_device(mRenderData.rdVkbDevice);
+	vkb::destroy_surface(mRenderData.rdVkbInstance.instance, mSurface);
+	vkb::destroy_instance(mRenderData.rdVkbInstance);
+	if (mLatencyFrames > 0) {
+		LOG(Renderer, 1, "%s: %s over %llu frames: %.2f ms average, %.2f ms maximum (%s)\n", __FUNCTION__,
+			mFrameLatency.presentMeasured ? "input-to-present" : "CPU submit latency", static_cast<unsigned long long>(mLatencyFrames),
+			mFrameLatency.averageMilliseconds, mFrameLatency.maximumMilliseconds,
+			mRenderData.rdHeadless ? "headless" : PresentMode::getName(mRenderData.rdPresentMode));
+	}
+	LOG(Renderer, 1, "%s: Vulkan renderer destroyed\n", __FUNCTION__);
 }
\ No newline at end of file
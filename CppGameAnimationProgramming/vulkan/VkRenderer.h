@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <atomic>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
@@ -9,42 +10,172 @@
 
 #include "VkRenderData.h"
 
-#include "Renderpass.h"
 #include "Pipeline.h"
-//#include "Framebuffer.h"
 #include "CommandPool.h"
 #include "CommandBuffer.h"
-//#include "SyncObjects.h"
+#include "SyncObjects.h"
 #include "Texture.h"
+#include "TextureStreaming.h"
+#include "BindlessTextures.h"
+#include "GpuCulling.h"
+#include "QueryPool.h"
+#include "PipelineCache.h"
+#include "LayoutCache.h"
+#include "Shader.h"
+#include "ShaderPermutations.h"
+#include "OffscreenTarget.h"
+#include "PresentMode.h"
+#include "PresentWait.h"
+#include "FrameLimiter.h"
+#include "DeletionQueue.h"
+#include "MemoryManager.h"
+#include "RenderGraph.h"
+#include "DescriptorAllocator.h"
+#include "FileWatcher.h"
+#include "JobSystem.h"
+#include "TaskGraph.h"
+#include "Bvh.h"
+#include "Frustum.h"
 
 class VkRenderer {
 public:
+	/* without a window the renderer runs headless into an offscreen image */
 	VkRenderer(GLFWwindow* window);
+	/* call before init; frameRateLimit 0 only paces FIFO modes to the display refresh */
+	void setPresentPolicy(VkPresentPolicy policy, float frameRateLimit = 0.0f);
+	/* call before init, pipelines and uploaded meshes use this vertex buffer layout */
+	void setVertexFormat(VkVertexFormat format);
 	bool init(unsigned int width, unsigned int height);
+	/* runs the init steps with empty bodies, false if a step depends on one that is not declared before it */
+	static bool checkInitGraph();
+	/* framebuffer size in pixels, the swapchain is rebuilt once the size settles */
 	void setSize(unsigned int width, unsigned int height);
+	/* the mesh becomes mesh 0, drawn once at the origin unless instances were set */
 	bool uploadData(VkMesh vertexData);
+	/* static world space mesh drawn once, culled per meshlet on the GPU; replaces the previous one */
+	bool uploadEnvironment(VkMesh mesh);
+	/* every instance is culled on the GPU, the visible ones are drawn with one indirect call */
+	void setInstances(std::vector<VkInstanceData> instances);
+	void setViewProjection(const glm::mat4& viewProjection);
+	/* instances switch to a coarser LOD while its error stays below this many pixels */
+	void setLodErrorThreshold(float pixels);
+	/* frame limiter sleep, its end is the frame start of the latency; input has to be sampled between this and draw() */
+	void waitForFrameStart();
 	bool draw();
 	void cleanup();
+	/* GPU time per pass, a few frames old */
+	std::vector<VkGpuPassTiming> getGpuPassTimings();
+	/* usage and budget per memory heap, read at the start of the last frame */
+	std::vector<VkHeapBudget> getMemoryBudgets();
+	/* RGBA8 pixels of the last frame, headless mode only */
+	bool readPixels(std::vector<unsigned char>& pixels, unsigned int& width, unsigned int& height);
+	VkFrameLatency getFrameLatency();
+	/* instances are culled with a BVH on the CPU and drawn one by one, recorded in parallel on the job system
+	 * instead of the GPU culling pass; meshlet culling of the environment is not affected */
+	void setCpuDrawList(bool enabled);
+	/* call before init; streamed texture mips above the coarse ones stay within this many bytes */
+	void setTextureBudget(VkDeviceSize bytes);
+	/* VkShaderFeatures of the drawn mesh, the default pipeline is used until the variant is built */
+	void setShaderFeatures(uint32_t features);
 private:
 	VkRenderData mRenderData{};
-	int mTriangleCount = 0;
 	GLFWwindow* mWindow = nullptr;
+	unsigned int mWidth = 0;
+	unsigned int mHeight = 0;
+	// Resize events are collected and applied together at the start of a frame
+	static constexpr uint64_t RESIZE_DEBOUNCE_TIME = 30000000;
+	bool mResizePending = false;
+	unsigned int mPendingWidth = 0;
+	unsigned int mPendingHeight = 0;
+	uint64_t mResizeRequestTime = 0;
 	VkSurfaceKHR mSurface = VK_NULL_HANDLE;
 	vkb::PhysicalDevice mPhysDevice;
-	VkBuffer mVertexBuffer;
-	VmaAllocation mVertexBufferAlloc;
+	VkBuffer mVertexBuffer = VK_NULL_HANDLE;
+	VmaAllocation mVertexBufferAlloc = VK_NULL_HANDLE;
+	VkBuffer mIndexBuffer = VK_NULL_HANDLE;
+	VmaAllocation mIndexBufferAlloc = VK_NULL_HANDLE;
+	glm::vec4 mPositionDequantization = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	// Copied to the culling buffers after the next fence wait
+	std::vector<VkMeshDrawData> mMeshes;
+	std::vector<VkInstanceData> mInstances;
+	bool mInstancesSet = false;
+	bool mSceneChanged = false;
+	// CPU draw list, recorded into secondary command buffers of DRAWS_PER_CHUNK draws each
+	static constexpr size_t DRAWS_PER_CHUNK = 256;
+	bool mCpuDrawList = false;
+	Bvh mSceneBvh;
+	std::vector<uint32_t> mVisibleInstances;
+	std::vector<VkCommandBuffer> mSecondaryBuffers;
+	// Declared again every frame, keeps the transient attachments between frames
+	RenderGraph mRenderGraph;
+	glm::mat4 mViewProjection = glm::mat4(1.0f);
+	// World space bounding sphere of the environment mesh, radius 0 without one
+	glm::vec4 mEnvironmentSphere = glm::vec4(0.0f);
+	// Handed between init steps
+	VkTextureData mTextureData{};
+	VkShaderStage mVertexShader{};
+	VkShaderStage mFragmentShader{};
+	std::string mPipelineCacheFileName = "pipeline_cache.bin";
+	std::string mShaderVariantFileName = "shader_variants.txt";
+	uint32_t mShaderFeatures = 0;
+	bool mFirstFramePresented = false;
+	// Shader hot reload: changed sources are compiled and built on a worker, swapped in at the start of a frame
+	std::string mVertexShaderFileName = "shader/basic.vert";
+	std::string mFragmentShaderFileName = "shader/basic.frag";
+	std::string mCullShaderFileName = "shader/cull.comp";
+	std::string mClusterCullShaderFileName = "shader/cluster_cull.comp";
+	FileWatcher mShaderWatcher;
+	JobCounter mReloadCounter;
+	bool mReloadRequested = false;
+	std::atomic<bool> mReloadReady{ false };
+	VkPipeline mReloadedPipeline = VK_NULL_HANDLE;
+	// Only touched by the reload job once init is done
+	uint64_t mVertexShaderKey = 0;
+	uint64_t mFragmentShaderKey = 0;
+	// Frame pacing and input-to-present latency
+	FrameLimiter mFrameLimiter;
+	float mFrameRateLimit = 0.0f;
+	int mRefreshRate = 0;
+	VkFrameLatency mFrameLatency{};
+	double mLatencySum = 0.0;
+	uint64_t mLatencyFrames = 0;
+	// End of waitForFrameStart, the input is polled right after
+	uint64_t mInputTime = 0;
 	
+	/* dryRun declares the same steps but none of them runs */
+	void addInitTasks(TaskGraph& initGraph, bool dryRun);
 	bool deviceInit();
 	bool getQueue();
-	bool createDepthBuffer();
+	bool createRenderTarget();
 	bool createSwapchain();
-	bool createRenderPass();
 	bool createPipeline();
-	bool createFramebuffer();
+	bool createPipelineCache();
+	bool loadShader(std::string shaderFileName, VkShaderStage& shader);
 	bool createCommandPool();
-	bool createCommandBuffer();
 	bool createSyncObjects();
-	bool loadTexture();
+	bool createQueryPool();
+	bool createPresentWait();
+	bool decodeTexture();
+	bool createBindlessTextures();
+	bool createGpuCulling();
+	bool createHostBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& bufferAlloc);
+	void retireBuffer(VkBuffer& buffer, VmaAllocation& bufferAlloc);
+	bool createDescriptorAllocator();
+	bool uploadTexture();
 	bool initVma();
+	bool createMemoryManager();
+	bool createTextureStreaming();
 	bool recreateSwapchain();
+	void configureFrameLimiter();
+	void initShaderReload();
+	void addLatencySample(float milliseconds);
+	void updateShaderReload();
+	void reloadShaders();
+	/* culling and main pass of the frame into the swapchain image or the offscreen target */
+	bool buildRenderGraph(uint32_t imageIndex);
+	/* records the main pass into mSecondaryBuffers, chunks are recorded on the job system */
+	bool recordMainPass(VkFormat colorFormat, VkFormat depthFormat);
+	void buildSceneBvh();
+	/* screen size of the textured instances and the environment, the streaming picks the mips from it */
+	void requestTextureMips();
 };
@@ -1,17 +1,39 @@
 #include "Window.h"
 #include "Logger.h"
+#include "Profiler.h"
+#include "PngWriter.h"
+#include "MeshOptimizer.h"
 #include <vector>
+#include <cmath>
 #include <stdexcept>
 #include <iostream>
 
-bool Window::init(unsigned int width, unsigned int height, std::string title) {
+bool Window::init(unsigned int width, unsigned int height, std::string title, bool headless) {
+	PROFILE_FUNCTION();
+	mHeadless = headless;
+	if (mHeadless) {
+		mRenderer = std::make_unique<VkRenderer>(nullptr);
+		mRenderer->setPresentPolicy(mPresentPolicy, mFrameRateLimit);
+		mRenderer->setShaderFeatures(mShaderFeatures);
+		mRenderer->setVertexFormat(mVertexFormat);
+		mRenderer->setCpuDrawList(mCpuDrawList);
+		mRenderer->setTextureBudget(mTextureBudget);
+		if (!mRenderer->init(width, height)) {
+			LOG(General, 1, "%s error: Could not init headless renderer\n", __FUNCTION__);
+			return false;
+		}
+		mModel = std::make_unique<Model>();
+		mModel->init();
+		LOG(General, 1, "%s: headless %ux%u renderer initialized\n", __FUNCTION__, width, height);
+		return true;
+	}
 	if (!glfwInit()) {
-		Logger::log(1, "%s: glfwInit() error\n", __FUNCTION__);
+		LOG(General, 1, "%s: glfwInit() error\n", __FUNCTION__);
 		return false;
 	}	
 	if (!glfwVulkanSupported()) {
 		glfwTerminate();
-		Logger::log(1, "%s: Vulkan is not supported\n", __FUNCTION__);
+		LOG(General, 1, "%s: Vulkan is not supported\n", __FUNCTION__);
 		return false;
 	}
 	//glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -23,10 +45,15 @@ bool Window::init(unsigned int width, unsigned int height, std::string title) {
 	mWindow = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
 	if (!mWindow) {
 		glfwTerminate();
-		Logger::log(1, "%s: Could not create window\n", __FUNCTION__);
+		LOG(General, 1, "%s: Could not create window\n", __FUNCTION__);
 		return false;
 	}
 	mRenderer = std::make_unique<VkRenderer>(mWindow);
+	mRenderer->setPresentPolicy(mPresentPolicy, mFrameRateLimit);
+	mRenderer->setShaderFeatures(mShaderFeatures);
+	mRenderer->setVertexFormat(mVertexFormat);
+	mRenderer->setCpuDrawList(mCpuDrawList);
+	mRenderer->setTextureBudget(mTextureBudget);
 	/*
 	// Save user pointer
 	glfwSetWindowUserPointer(mWindow, this);
@@ -53,30 +80,60 @@ bool Window::init(unsigned int width, unsigned int height, std::string title) {
 	
 	if (!mRenderer->init(width, height)) {
 		glfwTerminate();
-		Logger::log(1, "%s error: Could not init OpenGL\n", __FUNCTION__);
+		LOG(General, 1, "%s error: Could not init OpenGL\n", __FUNCTION__);
 		return false;
 	}
 
 
 	/*
 	if (!initVulkan()) {
-		Logger::log(1, "%s: Could not init Vulkan\n", __FUNCTION__);
+		LOG(General, 1, "%s: Could not init Vulkan\n", __FUNCTION__);
 		glfwTerminate();
 		return false;
 	}*/
 	glfwSetWindowUserPointer(mWindow, mRenderer.get());
-	glfwSetWindowSizeCallback(mWindow, [](GLFWwindow* win, int width, int height) {
+	// The swapchain is sized in pixels, not in screen coordinates
+	glfwSetFramebufferSizeCallback(mWindow, [](GLFWwindow* win, int width, int height) {
 		//auto renderer = static_cast<OGLRenderer*>(glfwGetWindowUserPointer(win));
 		auto renderer = static_cast<VkRenderer*>(glfwGetWindowUserPointer(win));
 		renderer->setSize(width, height);
 		});
 	mModel = std::make_unique<Model>();
 	mModel->init();
-	Logger::log(1, "%s: mockup model data loaded\n", __FUNCTION__);
-	Logger::log(1, "%s: Window with OpenGL 4.6 successfully initialized\n", __FUNCTION__);
+	LOG(General, 1, "%s: mockup model data loaded\n", __FUNCTION__);
+	LOG(General, 1, "%s: Window with OpenGL 4.6 successfully initialized\n", __FUNCTION__);
 	return true;
 }
 
+void Window::setPresentPolicy(VkPresentPolicy policy, float frameRateLimit) {
+	mPresentPolicy = policy;
+	mFrameRateLimit = frameRateLimit;
+}
+
+void Window::setShaderFeatures(uint32_t features) {
+	mShaderFeatures = features;
+}
+
+void Window::setVertexFormat(VkVertexFormat format) {
+	mVertexFormat = format;
+}
+
+void Window::setCpuDrawList(bool enabled) {
+	mCpuDrawList = enabled;
+}
+
+void Window::setTextureBudget(VkDeviceSize bytes) {
+	mTextureBudget = bytes;
+}
+
+void Window::setInstanceCount(unsigned int instanceCount) {
+	mInstanceCount = instanceCount;
+}
+
+void Window::setEnvironmentSize(unsigned int quadsPerSide) {
+	mEnvironmentSize = quadsPerSide;
+}
+
 /*
 bool Window::initVulkan() {
 	VkResult result = VK_ERROR_UNKNOWN;
@@ -98,12 +155,12 @@ bool Window::initVulkan() {
 	const char** glfwExtensions;
 	glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
 	if (extensionCount == 0) {
-		Logger::log(1, "%s error: no Vulkan extensions found, need at least 'VK_KHR_SURFACE'\n", __FUNCTION__);
+		LOG(General, 1, "%s error: no Vulkan extensions found, need at least 'VK_KHR_SURFACE'\n", __FUNCTION__);
 		return false;
 	}
-	Logger::log(1, "%s: Found %u Vulkan extensions\n", __FUNCTION__, extensionCount);
+	LOG(General, 1, "%s: Found %u Vulkan extensions\n", __FUNCTION__, extensionCount);
 	for (int i = 0; i < extensionCount; ++i) {
-		Logger::log(1, "%s: %s\n", __FUNCTION__, std::string(glfwExtensions[i]).c_str());
+		LOG(General, 1, "%s: %s\n", __FUNCTION__, std::string(glfwExtensions[i]).c_str());
 	}
 
 	mCreateInfo.enabledExtensionCount = extensionCount;
@@ -112,7 +169,7 @@ bool Window::initVulkan() {
 
 	result = vkCreateInstance(&mCreateInfo, nullptr, &mInstance);
 	if (result != VK_SUCCESS) {
-		Logger::log(1, "%s: Could not create Vulkan instance (%i)\n", __FUNCTION__, result);
+		LOG(General, 1, "%s: Could not create Vulkan instance (%i)\n", __FUNCTION__, result);
 		return false;
 	}
 
@@ -120,7 +177,7 @@ bool Window::initVulkan() {
 	uint32_t physicalDeviceCount = 0;
 	vkEnumeratePhysicalDevices(mInstance, &physicalDeviceCount, nullptr);
 	if (physicalDeviceCount == 0) {
-		Logger::log(1, "%s: No Vulkan capable GPU found\n", __FUNCTION__);
+		LOG(General, 1, "%s: No Vulkan capable GPU found\n", __FUNCTION__);
 		return false;
 	}
 	// fill with data about GPU
@@ -130,14 +187,14 @@ bool Window::initVulkan() {
 	// create surface
 	result = glfwCreateWindowSurface(mInstance, mWindow, nullptr, &mSurface);
 	if (result != VK_SUCCESS) {
-		Logger::log(1, "%s: Could not create Vulkan surface\n", __FUNCTION__);
+		LOG(General, 1, "%s: Could not create Vulkan surface\n", __FUNCTION__);
 		return false;
 	}
 	return true;
 }
 
 void Window::handleWindowCloseEvents() {
-	Logger::log(1, "%s: Window got close event...bye!\n", __FUNCTION__);
+	LOG(General, 1, "%s: Window got close event...bye!\n", __FUNCTION__);
 }
 
 void Window::handleKeyEvents(int key, int scancode, int action, int mods) {
@@ -157,7 +214,7 @@ void Window::handleKeyEvents(int key, int scancode, int action, int mods) {
 		break;
 	}
 	const char* keyName = glfwGetKeyName(key, 0);
-	Logger::log(1, "%s: key %s (key %i, scancode %i) %s\n", __FUNCTION__, keyName, key, scancode, actionName.c_str());
+	LOG(General, 1, "%s: key %s (key %i, scancode %i) %s\n", __FUNCTION__, keyName, key, scancode, actionName.c_str());
 }
 
 void Window::handleMouseButtonEvents(int button, int action, int mods) {
@@ -189,32 +246,94 @@ void Window::handleMouseButtonEvents(int button, int action, int mods) {
 		mouseButtonName = "other";
 		break;
 	}
-	Logger::log(1, "%s: %s mouse button (%i) %s\n", __FUNCTION__, mouseButtonName.c_str(), button, actionName.c_str());
+	LOG(General, 1, "%s: %s mouse button (%i) %s\n", __FUNCTION__, mouseButtonName.c_str(), button, actionName.c_str());
 }
 */
 
-void Window::mainLoop() {
+void Window::mainLoop(unsigned int frameCount) {
 	//glfwSwapInterval(1);
 	mRenderer->uploadData(mModel->getVertexData());
-	while (!glfwWindowShouldClose(mWindow)) {
+	if (mInstanceCount > 0) {
+		// Square grid over the whole view, the model quad is one unit wide
+		unsigned int side = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(mInstanceCount))));
+		float spacing = 2.0f / side;
+		std::vector<VkInstanceData> instances(mInstanceCount);
+		for (unsigned int i = 0; i < mInstanceCount; ++i) {
+			glm::vec2 position = glm::vec2(i % side + 0.5f, i / side + 0.5f) * spacing - 1.0f;
+			instances.at(i).positionScale = glm::vec4(position, 0.0f, spacing * 0.9f);
+		}
+		mRenderer->setInstances(instances);
+	}
+	if (mEnvironmentSize > 0) {
+		// Shared vertices over the whole view, behind the model quads
+		unsigned int side = mEnvironmentSize + 1;
+		VkMesh environment;
+		environment.vertices.resize(side * side);
+		for (unsigned int i = 0; i < side * side; ++i) {
+			glm::vec2 uv = glm::vec2(i % side, i / side) / static_cast<float>(mEnvironmentSize);
+			environment.vertices.at(i) = { glm::vec3(uv * 2.0f - 1.0f, 0.75f), uv };
+		}
+		environment.indices.reserve(mEnvironmentSize * mEnvironmentSize * 6);
+		for (unsigned int y = 0; y < mEnvironmentSize; ++y) {
+			for (unsigned int x = 0; x < mEnvironmentSize; ++x) {
+				uint32_t corner = y * side + x;
+				// Same winding as the model quad
+				environment.indices.insert(environment.indices.end(), { corner, corner + side + 1, corner + side,
+					corner, corner + 1, corner + side + 1 });
+			}
+		}
+		// Meshlets are built in index order, cache friendly triangles share more vertices per meshlet
+		MeshOptimizer::optimize(environment, false);
+		mRenderer->uploadEnvironment(environment);
+	}
+	if (mHeadless && frameCount == 0) {
+		frameCount = 1;
+	}
+	for (unsigned int frame = 0; frameCount == 0 || frame < frameCount; ++frame) {
+		if (!mHeadless && glfwWindowShouldClose(mWindow)) {
+			break;
+		}
 		/*
 		mRenderer->draw();
 		glfwSwapBuffers(mWindow);
 		glfwPollEvents();
 		*/
-		if (!mRenderer->draw()) {
-			break;
+		PROFILE_FRAME();
+		// Ends with the frame start time, the latency includes the event processing below
+		mRenderer->waitForFrameStart();
+		// Poll right before drawing so the frame shows the newest input
+		if (!mHeadless) {
+			PROFILE_ZONE("glfwPollEvents");
+			glfwPollEvents();
 		}
-		glfwPollEvents();
+		{
+			PROFILE_ZONE("draw");
+			if (!mRenderer->draw()) {
+				break;
+			}
+		}
+	}
+}
+
+bool Window::saveScreenshot(std::string fileName) {
+	std::vector<unsigned char> pixels;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	if (!mRenderer->readPixels(pixels, width, height)) {
+		LOG(General, 1, "%s error: could not read back frame\n", __FUNCTION__);
+		return false;
 	}
+	return PngWriter::write(fileName, width, height, pixels);
 }
 
 void Window::cleanup() {
 	mRenderer->cleanup();
 	//vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
 	//vkDestroyInstance(mInstance, nullptr);
-	glfwDestroyWindow(mWindow);
-	glfwTerminate();
-	Logger::log(1, "%s: Terminating Window\n", __FUNCTION__);
+	if (!mHeadless) {
+		glfwDestroyWindow(mWindow);
+		glfwTerminate();
+	}
+	LOG(General, 1, "%s: Terminating Window\n", __FUNCTION__);
 }
 
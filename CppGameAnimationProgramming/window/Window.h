@@ -11,12 +11,39 @@
 
 class Window {
 public:
-	bool init(unsigned int width, unsigned int height, std::string title);
-	void mainLoop();
+	/* headless skips GLFW completely and renders into an offscreen image */
+	bool init(unsigned int width, unsigned int height, std::string title, bool headless = false);
+	/* call before init, see VkRenderer::setPresentPolicy */
+	void setPresentPolicy(VkPresentPolicy policy, float frameRateLimit = 0.0f);
+	/* call before init, see VkRenderer::setShaderFeatures */
+	void setShaderFeatures(uint32_t features);
+	/* call before init, see VkRenderer::setVertexFormat */
+	void setVertexFormat(VkVertexFormat format);
+	/* call before init, see VkRenderer::setCpuDrawList */
+	void setCpuDrawList(bool enabled);
+	/* call before init, see VkRenderer::setTextureBudget */
+	void setTextureBudget(VkDeviceSize bytes);
+	/* 0 draws the model once, otherwise as a grid of instances filling the view */
+	void setInstanceCount(unsigned int instanceCount);
+	/* 0 disables, otherwise a background grid of quadsPerSide^2 quads culled per meshlet */
+	void setEnvironmentSize(unsigned int quadsPerSide);
+	/* frameCount 0 runs until the window is closed, headless mode needs a frame count */
+	void mainLoop(unsigned int frameCount = 0);
+	/* writes the last rendered frame as PNG, headless mode only */
+	bool saveScreenshot(std::string fileName);
 	void cleanup();
 	//bool initVulkan();
 private:
 	GLFWwindow* mWindow = nullptr;
+	bool mHeadless = false;
+	VkPresentPolicy mPresentPolicy = VkPresentPolicy::LowLatency;
+	float mFrameRateLimit = 0.0f;
+	uint32_t mShaderFeatures = 0;
+	VkVertexFormat mVertexFormat = VkVertexFormat::Quantized;
+	bool mCpuDrawList = false;
+	VkDeviceSize mTextureBudget = VkTextureStreamingData::DEFAULT_BUDGET;
+	unsigned int mInstanceCount = 0;
+	unsigned int mEnvironmentSize = 0;
 	std::unique_ptr<VkRenderer> mRenderer;
 	std::unique_ptr<Model> mModel;
 